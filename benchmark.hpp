@@ -0,0 +1,327 @@
+/*
+ * BSD 2-Clause License
+ *
+ * Copyright (c) 2021, Felix Brendel
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <math.h>
+#include "core.hpp"
+#include "profiler.hpp"
+
+// NOTE(Felix): A small micro benchmark harness. Every benchmark is a function
+//   that gets a Benchmark_State and runs its measured code
+//   `state->iterations` times. It is first run repeatedly to warm up while the
+//   iteration count is grown until one run takes at least `sample_seconds`,
+//   then `sample_count` runs are timed. The results are reported per
+//   iteration as median and median absolute deviation (both robust against
+//   the odd preempted sample) with a distribution free 95% confidence interval
+//   of the median, and can be written out as JSON to compare between
+//   versions. Setup inside of the function can be excluded with
+//   `state->pause()` and `state->resume()`.
+//
+//   The timestamps come from the profiler (profiler_ticks), so the
+//   translation unit with FTB_BENCHMARK_IMPL also needs FTB_PROFILER_IMPL.
+
+#ifdef _MSC_VER
+#  include <intrin.h>
+// NOTE(Felix): no inline asm on x64, storing the address into a volatile and a
+//   compiler barrier come closest
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    static const void* volatile sink;
+    sink = &value;
+    _ReadWriteBarrier();
+}
+
+inline void clobber_memory() {
+    _ReadWriteBarrier();
+}
+#else
+// NOTE(Felix): Pretends to read `value` (from a register or memory) and to
+//   touch all of memory, so the computation of `value` can't be dropped.
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// NOTE(Felix): Pretends to read and write all of memory, so pending stores
+//   have to happen before it.
+inline void clobber_memory() {
+    asm volatile("" : : : "memory");
+}
+#endif
+
+struct Benchmark_Config {
+    f64         warmup_seconds = 0.05;
+    f64         sample_seconds = 0.01;    // minimal duration of one sample
+    u32         sample_count   = 25;
+    u64         max_iterations = 1ull << 32; // per sample, for bodies that take no time at all
+    const char* filter         = nullptr; // only run benchmarks with this in their name
+};
+
+struct Benchmark_State {
+    u64 iterations;
+    u64 parameter;    // from the parameter list, 0 without one
+    u64 paused_ticks;
+    u64 pause_start;
+
+    void pause() {
+        pause_start = profiler_ticks();
+    }
+    void resume() {
+        paused_ticks += profiler_ticks() - pause_start;
+    }
+};
+
+// NOTE(Felix): All times are per iteration, in nano-seconds
+struct Benchmark_Result {
+    const char* name;
+    u64         parameter;
+    bool        has_parameter;
+    u64         iterations; // per sample
+    u32         samples;
+
+    f64 median;
+    f64 mad;
+    f64 mean;
+    f64 min;
+    f64 max;
+    f64 ci_low;
+    f64 ci_high;
+};
+
+auto benchmark_summarize(f64* samples, u32 count, Benchmark_Result* result) -> void;
+auto benchmark_print_result(Benchmark_Result* result) -> void;
+auto benchmark_name_matches(const char* filter, const char* name) -> bool;
+auto benchmark_next_iterations(u64 iterations, u64 nanos, u64 target_nanos, u64 max_iterations) -> u64;
+
+struct Benchmark_Suite {
+    Benchmark_Config             config;
+    Array_List<Benchmark_Result> results;
+
+    void init(Benchmark_Config p_config = {}) {
+        config = p_config;
+        results.init();
+    }
+
+    void deinit() {
+        results.deinit();
+    }
+
+    template <typename Body>
+    void run(const char* name, Body&& body) {
+        run_one(name, 0, false, body);
+    }
+
+    // NOTE(Felix): runs the benchmark once per parameter, e.g. input sizes
+    template <typename Body>
+    void run(const char* name, std::initializer_list<u64> parameters, Body&& body) {
+        for (u64 parameter : parameters)
+            run_one(name, parameter, true, body);
+    }
+
+    auto write_json(const char* path) -> bool;
+
+    template <typename Body>
+    void run_one(const char* name, u64 parameter, bool has_parameter, Body& body) {
+        if (!benchmark_name_matches(config.filter, name))
+            return;
+
+        auto measure = [&](u64 iterations) -> u64 {
+            Benchmark_State state {};
+            state.iterations = iterations;
+            state.parameter  = parameter;
+
+            u64 start = profiler_ticks();
+            body(&state);
+            u64 end   = profiler_ticks();
+            return profiler_ticks_to_nanos(end - start - state.paused_ticks);
+        };
+
+        // NOTE(Felix): warm up while growing the iterations until one sample
+        //   takes long enough or they hit the cap. If the body's time does
+        //   not grow with the iterations, the growing is cut off after at
+        //   most 100 target sample durations past the warmup.
+        u64 max_iterations = MAX(config.max_iterations, 1llu);
+        u64 target_nanos   = (u64)(config.sample_seconds * 1.0e9);
+        u64 warmup_end     = profiler_timestamp() + (u64)(config.warmup_seconds * 1.0e9);
+        u64 warmup_limit   = warmup_end + 100 * target_nanos;
+        u64 iterations     = 1;
+        while (true) {
+            u64 nanos = measure(iterations);
+            bool long_enough = nanos >= target_nanos || iterations >= max_iterations;
+            u64 now = profiler_timestamp();
+            if (now >= warmup_limit || (long_enough && now >= warmup_end))
+                break;
+            if (!long_enough)
+                iterations = benchmark_next_iterations(iterations, nanos, target_nanos, max_iterations);
+        }
+
+        u32 count = MAX(config.sample_count, 1u);
+        f64* samples = libc_allocator->allocate<f64>(count);
+        defer { libc_allocator->deallocate(samples); };
+        for (u32 i = 0; i < count; ++i)
+            samples[i] = (f64)measure(iterations) / iterations;
+
+        Benchmark_Result result {};
+        result.name          = name;
+        result.parameter     = parameter;
+        result.has_parameter = has_parameter;
+        result.iterations    = iterations;
+        benchmark_summarize(samples, count, &result);
+
+        benchmark_print_result(&result);
+        results.append(result);
+    }
+};
+
+#ifdef FTB_BENCHMARK_IMPL
+
+auto benchmark_name_matches(const char* filter, const char* name) -> bool {
+    return !filter || strstr(name, filter) != nullptr;
+}
+
+auto benchmark_next_iterations(u64 iterations, u64 nanos, u64 target_nanos, u64 max_iterations) -> u64 {
+    // NOTE(Felix): aim a bit above the target, but grow at most 100x at once,
+    //   since a very short first run says little
+    f64 factor = nanos ? 1.4 * target_nanos / nanos : 100.0;
+    factor = MAX(2.0, MIN(100.0, factor));
+
+    // NOTE(Felix): compare before converting, a too big f64 does not fit a u64
+    f64 next = (f64)iterations * factor;
+    if (next >= (f64)max_iterations)
+        return max_iterations;
+    return MAX((u64)next, 1llu);
+}
+
+auto benchmark_compare_f64(const void* a, const void* b) -> s32 {
+    f64 fa = *(const f64*)a;
+    f64 fb = *(const f64*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+auto benchmark_median_of_sorted(f64* sorted, u32 count) -> f64 {
+    if (count % 2)
+        return sorted[count / 2];
+    return (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+}
+
+// NOTE(Felix): Sorts (and then overwrites) `samples`. The confidence interval
+//   of the median comes from the order statistics: the median is below the
+//   k-th smallest sample with binomial(n, 1/2) probability, which is
+//   approximated with the normal distribution.
+auto benchmark_summarize(f64* samples, u32 count, Benchmark_Result* result) -> void {
+    result->samples = count;
+    if (!count)
+        return;
+
+    qsort(samples, count, sizeof(samples[0]), benchmark_compare_f64);
+
+    f64 sum = 0;
+    for (u32 i = 0; i < count; ++i)
+        sum += samples[i];
+
+    result->min    = samples[0];
+    result->max    = samples[count - 1];
+    result->mean   = sum / count;
+    result->median = benchmark_median_of_sorted(samples, count);
+
+    s64 k = (s64)floor((count - 1.96 * sqrt((f64)count)) / 2.0);
+    k = MAX(k, (s64)0);
+    result->ci_low  = samples[k];
+    result->ci_high = samples[count - 1 - k];
+
+    for (u32 i = 0; i < count; ++i)
+        samples[i] = fabs(samples[i] - result->median);
+    qsort(samples, count, sizeof(samples[0]), benchmark_compare_f64);
+    result->mad = benchmark_median_of_sorted(samples, count);
+}
+
+auto benchmark_time_unit(f64 nanos, f64* scaled) -> const char* {
+    if (nanos >= 1.0e9) { *scaled = nanos / 1.0e9; return "s "; }
+    if (nanos >= 1.0e6) { *scaled = nanos / 1.0e6; return "ms"; }
+    if (nanos >= 1.0e3) { *scaled = nanos / 1.0e3; return "us"; }
+    *scaled = nanos;
+    return "ns";
+}
+
+auto benchmark_print_result(Benchmark_Result* result) -> void {
+    char name[128];
+    if (result->has_parameter)
+        snprintf(name, sizeof(name), "%s/%llu", result->name, (unsigned long long)result->parameter);
+    else
+        snprintf(name, sizeof(name), "%s", result->name);
+
+    // NOTE(Felix): all in the unit of the median, so they line up
+    f64 median;
+    const char* unit = benchmark_time_unit(result->median, &median);
+    f64 scale = result->median ? median / result->median : 1.0;
+
+    println("%-40s %{color<}%9.3f %s%{>color} +- %8.3f  [%9.3f .. %9.3f]  %10llu x %u",
+            name, console_green_bold, median, unit,
+            result->mad * scale, result->ci_low * scale, result->ci_high * scale,
+            result->iterations, result->samples);
+}
+
+auto Benchmark_Suite::write_json(const char* path) -> bool {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        log_error("benchmark: could not open '%s' for writing the results", path);
+        return false;
+    }
+    defer { fclose(file); };
+
+    char buffer[4096];
+    Print_Sink sink;
+    sink.init_file(file, buffer, sizeof(buffer));
+
+    print_to_sink(&sink, "{\"clock\":\"%s\",\"benchmarks\":[",
+                  profiler_uses_tsc() ? "tsc" : "os");
+    for (u32 i = 0; i < results.count; ++i) {
+        Benchmark_Result* result = &results[i];
+        sink.write(i ? ",\n{\"name\":\"" : "\n{\"name\":\"", i ? 11 : 10);
+        trace_write_json_string(&sink, result->name);
+        sink.put('"');
+        if (result->has_parameter)
+            print_to_sink(&sink, ",\"parameter\":%llu", result->parameter);
+        print_to_sink(&sink,
+                      ",\"iterations\":%llu,\"samples\":%u,\"median_ns\":%.3f,\"mad_ns\":%.3f,"
+                      "\"mean_ns\":%.3f,\"min_ns\":%.3f,\"max_ns\":%.3f,"
+                      "\"ci_low_ns\":%.3f,\"ci_high_ns\":%.3f}",
+                      result->iterations, result->samples, result->median, result->mad,
+                      result->mean, result->min, result->max, result->ci_low, result->ci_high);
+    }
+    sink.write("\n]}\n", 4);
+    sink.flush();
+
+    if (ferror(file)) {
+        log_error("benchmark: could not write the results to '%s'", path);
+        return false;
+    }
+    return true;
+}
+
+#endif // FTB_BENCHMARK_IMPL
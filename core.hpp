@@ -64,7 +64,9 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <malloc.h>
+#include <atomic>
 #include <initializer_list>
+#include <type_traits>
 
 // ----------------------------------------------------------------------------
 //                                  platform
@@ -281,14 +283,46 @@ template <class F> deferrer<F> operator*(defer_dummy, F f) { return {f}; }
 #endif
 
 
-#ifdef FTB_DEBUG
-#  define log_debug(...)   one_statement(::print("%{color<}[ DEBUG ] ", console_cyan_dim); ::raw_print(__VA_ARGS__); ::raw_println("%{>color}");)
+// NOTE(Felix): Log calls below FTB_LOG_LEVEL are compiled out. By default
+//   that is only log_debug and only in non debug builds.
+#define FTB_LOG_LEVEL_DEBUG   0
+#define FTB_LOG_LEVEL_INFO    1
+#define FTB_LOG_LEVEL_WARNING 2
+#define FTB_LOG_LEVEL_ERROR   3
+#ifndef FTB_LOG_LEVEL
+#  ifdef FTB_DEBUG
+#    define FTB_LOG_LEVEL FTB_LOG_LEVEL_DEBUG
+#  else
+#    define FTB_LOG_LEVEL FTB_LOG_LEVEL_INFO
+#  endif
+#endif
+
+#ifdef FTB_ASYNC_LOG
+#  define ftb_log(color, label, format, ...) async_log("%{color<}" label format "%{>color}\n", color, ##__VA_ARGS__)
+#else
+#  define ftb_log(color, label, ...) ::print_log_line(color, label, __VA_ARGS__)
+#endif
+
+#if FTB_LOG_LEVEL <= FTB_LOG_LEVEL_DEBUG
+#  define log_debug(...)   ftb_log(console_cyan_dim, "[ DEBUG ] ", __VA_ARGS__)
 #else
 #  define log_debug(...)
 #endif
-#define log_info(...)    one_statement(::print("%{color<}[  INFO ] ", console_green);    ::raw_print(__VA_ARGS__); ::raw_println("%{>color}");)
-#define log_warning(...) one_statement(::print("%{color<}[WARNING] ", console_yellow);   ::raw_print(__VA_ARGS__); ::raw_println("%{>color}");)
-#define log_error(...)   one_statement(::print("%{color<}[ ERROR ] ", console_red_bold); ::raw_print(__VA_ARGS__); ::raw_println("%{>color}");)
+#if FTB_LOG_LEVEL <= FTB_LOG_LEVEL_INFO
+#  define log_info(...)    ftb_log(console_green,    "[  INFO ] ", __VA_ARGS__)
+#else
+#  define log_info(...)
+#endif
+#if FTB_LOG_LEVEL <= FTB_LOG_LEVEL_WARNING
+#  define log_warning(...) ftb_log(console_yellow,   "[WARNING] ", __VA_ARGS__)
+#else
+#  define log_warning(...)
+#endif
+#if FTB_LOG_LEVEL <= FTB_LOG_LEVEL_ERROR
+#  define log_error(...)   ftb_log(console_red_bold, "[ ERROR ] ", __VA_ARGS__)
+#else
+#  define log_error(...)
+#endif
 #define log_trace()      ::println("%{color<}[ TRACE ] %s (%s:%d)%{>color}", console_cyan_dim ,__func__, __FILE__, __LINE__)
 
 #define log_error_and_stacktrace(...)                                   \
@@ -400,6 +434,7 @@ inline Type* resize(void* old, u64 amount) {
     ALLOCATOR(Bookkeeping_Allocator)            \
     ALLOCATOR(Resettable_Allocator)             \
     ALLOCATOR(Leak_Detecting_Allocator)         \
+    ALLOCATOR(Locking_Allocator)                \
 
 const int _initial_counter_ = __COUNTER__;
 enum struct Allocator_Type : byte {
@@ -501,9 +536,9 @@ inline void deallocate_with_preamble(u64 size_of_preamble, u64 align_of_data,
 struct Perf_Counter {
 #ifdef FTB_WINDOWS
     s64 last_counter;
-    f32 one_over_perf_frequency;
+    f64 seconds_per_count;
 #else
-    struct timespec last_timespec;
+    u64 last_nanos;
 #endif
 };
 
@@ -687,11 +722,46 @@ extern FILE* ftb_stdout;
 
 
 typedef const char* static_string;
-typedef int (*printer_function_32b)(FILE*, u32);
-typedef int (*printer_function_64b)(FILE*, u64);
-typedef int (*printer_function_flt)(FILE*, double);
-typedef int (*printer_function_ptr)(FILE*, void*);
-typedef int (*printer_function_void)(FILE*);
+
+// NOTE(Felix): Everything the printer writes goes through a Print_Sink. A file
+//   sink forwards to a FILE*, a string sink appends to a growable buffer that
+//   starts out in (optional) caller provided memory, usually on the stack, so
+//   printing to a string does not touch the file system and allocates only
+//   once the output outgrows that memory. A file sink given a buffer collects
+//   the output there and hands it to the FILE* in one fwrite per flush (or
+//   whenever the buffer is full), so a whole message is a single write.
+//   With FTB_PRINT_UNBUFFERED defined, file sinks ignore their buffer and
+//   format strings are copied char by char, like the printer did before;
+//   that is only meant for comparing the two in tests/print_bench.cpp.
+struct Print_Sink {
+    FILE*           file; // nullptr for string sinks
+    char*           data;
+    u64             count;
+    u64             allocated;
+    char*           initial_buffer;
+    Allocator_Base* allocator;
+
+    void init_file(FILE* file, char* buffer = nullptr, u64 buffer_size = 0);
+    void init_string(Allocator_Base* allocator = nullptr,
+                     char* initial_buffer = nullptr, u64 initial_buffer_size = 0);
+    void deinit();
+
+    void reserve(u64 additional); // string sinks only
+    void write(const char* bytes, u64 length);
+    void put(char c);
+    void rewind_to(u64 position); // string sinks only
+    void flush();                 // file sinks only
+
+    // NOTE(Felix): Hands out the written string (zero terminated, the length
+    //   excludes the terminator) allocated in `target` and deinits the sink.
+    auto finish(Allocator_Base* target = nullptr) -> String;
+};
+
+typedef int (*printer_function_32b)(Print_Sink*, u32);
+typedef int (*printer_function_64b)(Print_Sink*, u64);
+typedef int (*printer_function_flt)(Print_Sink*, double);
+typedef int (*printer_function_ptr)(Print_Sink*, void*);
+typedef int (*printer_function_void)(Print_Sink*);
 
 enum struct Printer_Function_Type {
     unknown,
@@ -703,9 +773,24 @@ enum struct Printer_Function_Type {
 };
 
 #define register_printer(spec, fun, type)                       \
-    register_printer_ptr(spec, (printer_function_ptr)fun, type)
+    register_printer_checked(spec, +(fun), type)
 
 auto register_printer_ptr(const char* spec, printer_function_ptr fun, Printer_Function_Type type) -> void;
+
+// NOTE(Felix): The printer is stored type erased, so this checks its
+//   signature at compile time. Printers used to take a FILE*, which would
+//   still convert silently and crash when called.
+template <typename Ret, typename Sink, typename... Arg>
+auto register_printer_checked(const char* spec, Ret (*fun)(Sink, Arg...), Printer_Function_Type type) -> void {
+    static_assert(std::is_same<Sink, Print_Sink*>::value,
+                  "printers take a Print_Sink* as their first argument");
+    static_assert(sizeof...(Arg) <= 1,
+                  "printers take at most one argument besides the sink");
+    static_assert(std::is_integral<Ret>::value,
+                  "printers return the number of written characters");
+    register_printer_ptr(spec, (printer_function_ptr)fun, type);
+}
+auto print_va_args_to_sink(Print_Sink* sink, static_string format, va_list* arg_list) -> s32;
 auto print_va_args_to_file(FILE* file, static_string format, va_list* arg_list) -> s32;
 auto print_va_args_to_string(char** out, Allocator_Base* allocator, static_string format, va_list* arg_list)  -> s32;
 auto print_va_args_to_string(String* out, Allocator_Base* allocator, static_string format, va_list* arg_list)  -> s32;
@@ -713,11 +798,24 @@ auto print_va_args(static_string format, va_list* arg_list) -> s32;
 auto print_to_string(char** out, Allocator_Base* allocator, static_string format, ...) -> s32;
 auto print_to_string(String* out, Allocator_Base* allocator, static_string format, ...) -> s32;
 auto print_to_file(FILE* file, static_string format, ...) -> s32;
+auto print_to_sink(Print_Sink* sink, static_string format, ...) -> s32;
+
+// NOTE(Felix): Fast number formatting, write into `out` (which must hold at
+//   least 24 bytes), don't zero terminate, and return the number of chars
+//   written. format_f32 writes the shortest representation that reads back as
+//   exactly the same f32.
+auto format_u64(u64 value, char* out) -> u32;
+auto format_s64(s64 value, char* out) -> u32;
+auto format_f32(f32 value, char* out) -> u32;
 
 auto print(static_string format, ...) -> s32;
 auto println(static_string format, ...) -> s32;
 auto raw_print(static_string format, ...) -> s32;
 auto raw_println(static_string format, ...) -> s32;
+// NOTE(Felix): what the log_* macros print: prefixes, the colored label and
+//   message, and a newline, written while holding the file lock, so lines
+//   of different threads don't interleave
+auto print_log_line(static_string color, static_string label, static_string format, ...) -> s32;
 
 auto print_str_lines(static_string str, u32 max_lines) -> s32;
 
@@ -735,6 +833,528 @@ auto hex_dump(void* ptr, s64 count, u32 bytes_per_line = 16) -> void;
     MPP_BEFORE(1, push_print_prefix(pfx);)      \
     MPP_DEFER(2,  pop_print_prefix();)
 
+// NOTE(Felix): Compile time checked printing. static_print(format, args...),
+//   static_println and static_print_to_sink print like their counterparts
+//   above, but the format has to be a string literal and is parsed while
+//   compiling: the argument count and the argument types are checked with
+//   static_asserts, and at runtime only the formatting itself is left to do.
+//   `%{...}` specs are looked up once per call site and cached. The types of
+//   the built in printers are known at compile time, printers registered by
+//   the user are checked when a call site first uses them (and have to take
+//   an argument).
+//
+//     static_println("%{color<}%s%{>color}: %6.2f (%{u32} items)",
+//                    console_green, name, seconds, count);
+enum struct Format_Arg : u8 {
+    Unsupported,
+    Int32,
+    Int64,
+    Float,
+    C_String,
+    Pointer,
+    Any, // for printers registered at runtime
+};
+
+enum struct Format_Segment_Type : u8 {
+    Literal,
+    Integer,  // %d %u %ld %llu ... without flags, width or precision
+    C_String, // plain %s
+    Printf,   // everything else printf understands
+    Custom,   // %{...}
+};
+
+enum struct Format_Repeat : u8 {
+    None,      // %{spec}
+    Inline,    // %{spec,n}: n arguments
+    Array,     // %{spec[n]}: a pointer to n elements
+    Array_Var, // %{spec[*]}: a pointer and the element count
+};
+
+struct Format_Segment {
+    Format_Segment_Type   type;
+    Format_Repeat         repeat;
+    Printer_Function_Type printer_type; // Custom: unknown if not built in
+    bool                  is_signed;    // Integer
+    u32                   start;        // Literal, Custom: text or spec in the format
+    u32                   length;
+    u32                   element_count;
+    u32                   first_arg;
+    u32                   arg_count;
+    char                  spec[16];     // Printf: zero terminated conversion
+};
+
+struct Format_Parse {
+    u32  segment_count;
+    u32  arg_count;
+    bool valid;
+};
+
+union Format_Value {
+    s64         integer;
+    f64         flt;
+    const void* pointer;
+};
+
+constexpr auto format_strings_equal(const char* a, u32 a_length, const char* b) -> bool {
+    for (u32 i = 0; i < a_length; ++i)
+        if (a[i] != b[i])
+            return false;
+    return b[a_length] == '\0';
+}
+
+// NOTE(Felix): has to be kept in sync with the printers init_printer registers
+constexpr auto format_builtin_printer_type(const char* spec, u32 length) -> Printer_Function_Type {
+    struct Builtin {
+        const char*           spec;
+        Printer_Function_Type type;
+    };
+    constexpr Builtin builtins[] = {
+        {"spaces",      Printer_Function_Type::_32b},
+        {"u32",         Printer_Function_Type::_32b},
+        {"u64",         Printer_Function_Type::_64b},
+        {"bool",        Printer_Function_Type::_32b},
+        {"s64",         Printer_Function_Type::_64b},
+        {"s32",         Printer_Function_Type::_32b},
+        {"f32",         Printer_Function_Type::_flt},
+        {"f64",         Printer_Function_Type::_flt},
+        {"->char",      Printer_Function_Type::_ptr},
+        {"->",          Printer_Function_Type::_ptr},
+        {"color<",      Printer_Function_Type::_ptr},
+        {">color",      Printer_Function_Type::_void},
+        {"->Str",       Printer_Function_Type::_ptr},
+        {"->char_line", Printer_Function_Type::_ptr},
+    };
+    for (const Builtin& builtin : builtins)
+        if (format_strings_equal(spec, length, builtin.spec))
+            return builtin.type;
+    return Printer_Function_Type::unknown;
+}
+
+constexpr auto format_arg_for_printer(Printer_Function_Type type) -> Format_Arg {
+    switch (type) {
+    case Printer_Function_Type::_32b: return Format_Arg::Int32;
+    case Printer_Function_Type::_64b: return Format_Arg::Int64;
+    case Printer_Function_Type::_flt: return Format_Arg::Float;
+    case Printer_Function_Type::_ptr: return Format_Arg::Pointer;
+    case Printer_Function_Type::_void: return Format_Arg::Unsupported;
+    default: return Format_Arg::Any;
+    }
+}
+
+// NOTE(Felix): whether an argument of type `given` can be printed where the
+//   format expects `expected`. Integers may be widened but not narrowed.
+constexpr auto format_arg_accepts(Format_Arg expected, Format_Arg given) -> bool {
+    switch (expected) {
+    case Format_Arg::Int32:    return given == Format_Arg::Int32;
+    case Format_Arg::Int64:    return given == Format_Arg::Int32 || given == Format_Arg::Int64;
+    case Format_Arg::Float:    return given == Format_Arg::Float;
+    case Format_Arg::C_String: return given == Format_Arg::C_String;
+    case Format_Arg::Pointer:  return given == Format_Arg::Pointer || given == Format_Arg::C_String;
+    case Format_Arg::Any:      return given != Format_Arg::Unsupported;
+    default:                   return false;
+    }
+}
+
+constexpr auto format_read_number(const char* format, u32* pos) -> u32 {
+    u32 number = 0;
+    while (format[*pos] >= '0' && format[*pos] <= '9') {
+        number = number * 10 + (format[*pos] - '0');
+        ++(*pos);
+    }
+    return number;
+}
+
+// NOTE(Felix): Parses `format` into `segments` and the expected argument
+//   types into `args`. With both being nullptr it only counts them, so the
+//   caller knows how much space to provide.
+constexpr auto parse_format(const char* format, Format_Segment* segments, Format_Arg* args) -> Format_Parse {
+    Format_Parse result { 0, 0, true };
+
+    auto add_segment = [&](Format_Segment segment) {
+        if (segments)
+            segments[result.segment_count] = segment;
+        ++result.segment_count;
+    };
+    auto add_arg = [&](Format_Arg arg) {
+        if (args)
+            args[result.arg_count] = arg;
+        ++result.arg_count;
+    };
+    auto fail = [&]() {
+        result.valid = false;
+        return result;
+    };
+
+    u32 pos = 0;
+    u32 literal_start = 0;
+    while (format[pos]) {
+        if (format[pos] != '%') {
+            ++pos;
+            continue;
+        }
+
+        if (pos > literal_start) {
+            Format_Segment literal {};
+            literal.type   = Format_Segment_Type::Literal;
+            literal.start  = literal_start;
+            literal.length = pos - literal_start;
+            add_segment(literal);
+        }
+
+        u32 conversion_start = pos++;
+        if (format[pos] == '%') {
+            // NOTE(Felix): the second '%' starts the next literal
+            literal_start = pos++;
+            continue;
+        }
+
+        Format_Segment segment {};
+        segment.first_arg = result.arg_count;
+
+        if (format[pos] == '{') {
+            u32 spec_start = ++pos;
+            while (format[pos] && format[pos] != '}' && format[pos] != ',' && format[pos] != '[')
+                ++pos;
+            if (!format[pos] || pos == spec_start)
+                return fail();
+
+            segment.type         = Format_Segment_Type::Custom;
+            segment.start        = spec_start;
+            segment.length       = pos - spec_start;
+            segment.printer_type = format_builtin_printer_type(format + spec_start, segment.length);
+
+            Format_Arg element = format_arg_for_printer(segment.printer_type);
+            bool takes_arg = segment.printer_type != Printer_Function_Type::_void;
+
+            if (format[pos] == ',') {
+                ++pos;
+                segment.repeat        = Format_Repeat::Inline;
+                segment.element_count = format_read_number(format, &pos);
+                if (takes_arg)
+                    for (u32 i = 0; i < segment.element_count; ++i)
+                        add_arg(element);
+            } else if (format[pos] == '[') {
+                ++pos;
+                if (!takes_arg)
+                    return fail();
+                add_arg(Format_Arg::Pointer);
+                if (format[pos] == '*') {
+                    ++pos;
+                    segment.repeat = Format_Repeat::Array_Var;
+                    add_arg(Format_Arg::Int32);
+                } else {
+                    segment.repeat        = Format_Repeat::Array;
+                    segment.element_count = format_read_number(format, &pos);
+                }
+                if (format[pos] != ']')
+                    return fail();
+                ++pos;
+            } else if (takes_arg) {
+                add_arg(element);
+            }
+
+            if (format[pos] != '}')
+                return fail();
+            ++pos;
+        } else {
+            // %[flags][width][.precision][length]specifier
+            bool plain = true;
+            while (format[pos] == '+' || format[pos] == '-' || format[pos] == ' ' ||
+                   format[pos] == '#' || format[pos] == '0')
+            {
+                plain = false;
+                ++pos;
+            }
+
+            if (format[pos] == '*') {
+                plain = false;
+                add_arg(Format_Arg::Int32);
+                ++pos;
+            } else if (format[pos] >= '0' && format[pos] <= '9') {
+                plain = false;
+                format_read_number(format, &pos);
+            }
+
+            if (format[pos] == '.') {
+                plain = false;
+                ++pos;
+                if (format[pos] == '*') {
+                    add_arg(Format_Arg::Int32);
+                    ++pos;
+                } else {
+                    format_read_number(format, &pos);
+                }
+            }
+
+            Format_Arg integer = Format_Arg::Int32;
+            bool has_length = true;
+            if (format[pos] == 'h') {
+                plain = false;
+                ++pos;
+                if (format[pos] == 'h')
+                    ++pos;
+            } else if (format[pos] == 'l') {
+                ++pos;
+                if (format[pos] == 'l') {
+                    ++pos;
+                    integer = Format_Arg::Int64;
+                } else {
+                    integer = sizeof(long) == 8 ? Format_Arg::Int64 : Format_Arg::Int32;
+                }
+            } else if (format[pos] == 'z' || format[pos] == 't') {
+                ++pos;
+                integer = sizeof(size_t) == 8 ? Format_Arg::Int64 : Format_Arg::Int32;
+            } else if (format[pos] == 'j') {
+                ++pos;
+                integer = Format_Arg::Int64;
+            } else {
+                has_length = false;
+            }
+
+            char c = format[pos++];
+            segment.type = Format_Segment_Type::Printf;
+            switch (c) {
+            case 'd': case 'i': case 'u': {
+                if (plain)
+                    segment.type = Format_Segment_Type::Integer;
+                segment.is_signed = c != 'u';
+                add_arg(integer);
+            } break;
+            case 'x': case 'X': case 'o': case 'c': {
+                add_arg(integer);
+            } break;
+            case 'f': case 'F': case 'e': case 'E':
+            case 'g': case 'G': case 'a': case 'A': {
+                add_arg(Format_Arg::Float);
+            } break;
+            case 's': {
+                if (has_length) // wide strings
+                    return fail();
+                if (plain)
+                    segment.type = Format_Segment_Type::C_String;
+                add_arg(Format_Arg::C_String);
+            } break;
+            case 'p': {
+                add_arg(Format_Arg::Pointer);
+            } break;
+            default: return fail();
+            }
+
+            u32 spec_length = pos - conversion_start;
+            if (spec_length >= sizeof(segment.spec))
+                return fail();
+            for (u32 i = 0; i < spec_length; ++i)
+                segment.spec[i] = format[conversion_start + i];
+        }
+
+        segment.arg_count = result.arg_count - segment.first_arg;
+        add_segment(segment);
+        literal_start = pos;
+    }
+
+    if (pos > literal_start) {
+        Format_Segment literal {};
+        literal.type   = Format_Segment_Type::Literal;
+        literal.start  = literal_start;
+        literal.length = pos - literal_start;
+        add_segment(literal);
+    }
+
+    return result;
+}
+
+template <u32 segment_count, u32 arg_count>
+struct Compiled_Format {
+    Format_Segment segments[segment_count ? segment_count : 1];
+    Format_Arg     args[arg_count ? arg_count : 1];
+};
+
+template <u32 segment_count, u32 arg_count>
+constexpr auto compile_format(const char* format) -> Compiled_Format<segment_count, arg_count> {
+    Compiled_Format<segment_count, arg_count> result {};
+    parse_format(format, result.segments, result.args);
+    return result;
+}
+
+template <typename type>
+constexpr auto format_arg_of() -> Format_Arg {
+    if constexpr (std::is_same_v<type, char*> || std::is_same_v<type, const char*>)
+        return Format_Arg::C_String;
+    else if constexpr (std::is_pointer_v<type> || std::is_null_pointer_v<type>)
+        return Format_Arg::Pointer;
+    else if constexpr (std::is_integral_v<type> || std::is_enum_v<type>)
+        return sizeof(type) <= 4 ? Format_Arg::Int32 : Format_Arg::Int64;
+    else if constexpr (std::is_floating_point_v<type>)
+        return sizeof(type) <= 8 ? Format_Arg::Float : Format_Arg::Unsupported;
+    else
+        return Format_Arg::Unsupported;
+}
+
+template <typename... types>
+struct Format_Arg_Types {
+    static constexpr u32        count = sizeof...(types);
+    static constexpr Format_Arg args[count ? count : 1] = { format_arg_of<types>()... };
+};
+
+// NOTE(Felix): only used in decltype
+template <typename... types>
+auto format_arg_types(const types&...) -> Format_Arg_Types<std::decay_t<types>...>;
+
+template <u32 segment_count, u32 arg_count, typename... types>
+constexpr auto format_args_match(const Compiled_Format<segment_count, arg_count>& format,
+                                 Format_Arg_Types<types...>) -> bool
+{
+    if (sizeof...(types) != arg_count)
+        return false;
+    constexpr Format_Arg given[sizeof...(types) ? sizeof...(types) : 1] = { format_arg_of<types>()... };
+    for (u32 i = 0; i < arg_count; ++i)
+        if (!format_arg_accepts(format.args[i], given[i]))
+            return false;
+    return true;
+}
+
+template <typename type>
+auto format_value(type value) -> Format_Value {
+    Format_Value result {};
+    if constexpr (std::is_pointer_v<type>)
+        result.pointer = (const void*)value;
+    else if constexpr (std::is_floating_point_v<type>)
+        result.flt = (f64)value;
+    else if constexpr (std::is_integral_v<type> || std::is_enum_v<type>)
+        result.integer = (s64)value;
+    return result;
+}
+
+template <u32 count>
+struct Format_Values {
+    Format_Value values[count ? count : 1];
+};
+
+template <typename... types>
+auto format_values(types... values) -> Format_Values<sizeof...(types)> {
+    return { { format_value(values)... } };
+}
+
+struct Format_Call_Site {
+    const Format_Segment* segments;
+    u32                   segment_count;
+    const Format_Arg*     expected_args;
+    const Format_Arg*     given_args;
+    std::atomic<u64>*     printer_cache; // per segment: printer generation and id+1
+};
+
+enum struct Static_Print_Mode : u8 {
+    To_Sink,
+    Print,    // with prefixes to stdout
+    Println,
+};
+
+auto print_compiled_format(Static_Print_Mode mode, Print_Sink* sink, const char* format,
+                           Format_Call_Site call_site, const Format_Value* values) -> s32;
+
+// NOTE(Felix): declares the compiled format and the call site of one
+//   static_print or async_log invocation, with the compile time checks
+#define ftb_compiled_format(format, ...)                                        \
+    constexpr Format_Parse ftb_parse = parse_format(format, nullptr, nullptr);  \
+    static_assert(ftb_parse.valid, "invalid format string");                    \
+    static constexpr auto ftb_format =                                          \
+        compile_format<ftb_parse.segment_count, ftb_parse.arg_count>(format);   \
+    using ftb_types = decltype(format_arg_types(__VA_ARGS__));                  \
+    static_assert(ftb_types::count == ftb_parse.arg_count,                      \
+                  "wrong number of arguments for the format string");          \
+    static_assert(format_args_match(ftb_format, ftb_types{}),                   \
+                  "argument types do not match the format string");           \
+    static std::atomic<u64> ftb_printer_cache[ftb_parse.segment_count ? ftb_parse.segment_count : 1]; \
+    static const Format_Call_Site ftb_call_site = {                             \
+        ftb_format.segments, ftb_parse.segment_count,                           \
+        ftb_format.args, ftb_types::args, ftb_printer_cache,                    \
+    }
+
+#define ftb_static_print(mode, sink, format, ...)                               \
+    [&]() -> s32 {                                                              \
+        ftb_compiled_format(format, __VA_ARGS__);                               \
+        auto ftb_values = format_values(__VA_ARGS__);                           \
+        return print_compiled_format(mode, sink, format, ftb_call_site, ftb_values.values); \
+    }()
+
+#define static_print(format, ...)               ftb_static_print(Static_Print_Mode::Print,   nullptr, format, __VA_ARGS__)
+#define static_println(format, ...)             ftb_static_print(Static_Print_Mode::Println, nullptr, format, __VA_ARGS__)
+#define static_print_to_sink(sink, format, ...) ftb_static_print(Static_Print_Mode::To_Sink, sink,    format, __VA_ARGS__)
+
+// NOTE(Felix): Asynchronous logging. async_log(format, args...) checks its
+//   format like static_print, but only copies the arguments (and the C
+//   strings printed with %s) into a lock free ring buffer of the calling
+//   thread. A background thread started with start_async_log formats the
+//   records and writes them in batches. Records with pointers a printer
+//   would follow later (like %{->Str}) are formatted by the caller instead.
+//   If the background thread is not running, async_log prints right away.
+//   With FTB_ASYNC_LOG defined, log_info and friends go through async_log.
+struct Async_Log_Site {
+    const char*      format;
+    Format_Call_Site call_site;
+    u32              arg_count;
+    const bool*      copy_string; // per argument
+    bool             deferrable;
+};
+
+template <u32 arg_count>
+struct Async_Log_Plan {
+    bool copy_string[arg_count ? arg_count : 1];
+    bool deferrable;
+};
+
+template <u32 segment_count, u32 arg_count, typename... types>
+constexpr auto async_log_plan(const Compiled_Format<segment_count, arg_count>& format,
+                              Format_Arg_Types<types...>) -> Async_Log_Plan<arg_count>
+{
+    Async_Log_Plan<arg_count> plan {};
+    plan.deferrable = true;
+    if (sizeof...(types) != arg_count)
+        return plan;
+
+    constexpr Format_Arg given[sizeof...(types) ? sizeof...(types) : 1] = { format_arg_of<types>()... };
+    for (u32 s = 0; s < segment_count; ++s) {
+        const Format_Segment& segment = format.segments[s];
+        for (u32 i = segment.first_arg; i < segment.first_arg + segment.arg_count; ++i) {
+            bool prints_address = segment.type == Format_Segment_Type::Printf &&
+                format.args[i] == Format_Arg::Pointer;
+            if (given[i] == Format_Arg::C_String && !prints_address)
+                plan.copy_string[i] = true;
+
+            if (segment.type == Format_Segment_Type::Custom &&
+                (given[i] == Format_Arg::Pointer ||
+                 segment.repeat == Format_Repeat::Array ||
+                 segment.repeat == Format_Repeat::Array_Var))
+            {
+                plan.deferrable = false;
+            }
+        }
+    }
+    return plan;
+}
+
+auto async_log_write(const Async_Log_Site* site, const Format_Value* values) -> void;
+
+// NOTE(Felix): `buffer_size` is the size of each thread's ring buffer
+auto start_async_log(FILE* file = nullptr, u32 buffer_size = 256 * 1024) -> void;
+// NOTE(Felix): writes everything still queued. Messages logged afterwards are
+//   printed right away, still to `file`, so only close it once no thread
+//   logs anymore.
+auto stop_async_log() -> void;
+auto flush_async_log() -> void; // waits until this thread's messages are written
+
+#define async_log(format, ...)                                                  \
+    [&]() -> void {                                                             \
+        ftb_compiled_format(format, __VA_ARGS__);                               \
+        static constexpr auto ftb_plan = async_log_plan(ftb_format, ftb_types{}); \
+        static const Async_Log_Site ftb_site = {                                \
+            format, ftb_call_site, ftb_parse.arg_count,                         \
+            ftb_plan.copy_string, ftb_plan.deferrable,                          \
+        };                                                                      \
+        auto ftb_values = format_values(__VA_ARGS__);                           \
+        async_log_write(&ftb_site, ftb_values.values);                          \
+    }()
+
 // ----------------------------------------------------------------------------
 //                               Array lists
 // ----------------------------------------------------------------------------
@@ -1445,6 +2065,74 @@ struct Path_Info {
 
 auto read_entire_file(const char* filename, Allocator_Base* allocator = nullptr) -> File_Read;
 
+// NOTE(Felix): Maps the file read only instead of copying it into the heap,
+//   pages are read in by the OS as they are touched. `contents` is always
+//   followed by a NUL byte (like with read_entire_file), so it can be passed to
+//   the parsers directly. Has to be released with unmap_file. On Windows the
+//   file is read into memory instead.
+struct Mapped_File {
+    bool   success;
+    String contents;
+    void*  mapping;
+    u64    mapping_size;
+};
+
+auto map_entire_file(const char* filename) -> Mapped_File;
+auto unmap_file(Mapped_File* file) -> void;
+
+// NOTE(Felix): Asynchronous, batched reading and writing of whole files.
+//   Requests are submitted to an IO_Queue and their callbacks are called on
+//   the thread that calls poll or wait_all, so the callbacks don't have to be
+//   thread safe. On Linux the queue uses io_uring (open, read/write and close
+//   all go through the ring, so many files are in flight at once); if that is
+//   not available, and on Windows, a small thread pool does the blocking calls
+//   instead. A request must stay valid (and unmoved) until its callback ran.
+//   Read contents are allocated from the queue's allocator; the thread pool
+//   allocates from its worker threads, so it has to be thread safe (the
+//   default, libc_allocator, is).
+enum struct IO_Op : u8 {
+    Read_File,
+    Write_File,
+};
+
+struct IO_Request;
+typedef void (*io_callback)(IO_Request* request);
+
+struct IO_Request {
+    IO_Op       op;
+    const char* path;
+    String      data;      // Write_File: the bytes to write
+    io_callback callback;  // optional
+    void*       user_data;
+
+    // results
+    bool             success;
+    Allocated_String contents; // Read_File: NUL terminated, owned by the caller
+
+    // internal
+    IO_Request* next;
+    s32         fd;
+    u8          stage;
+    u64         size;
+    u64         done_bytes;
+};
+
+struct IO_Queue_Internal;
+
+struct IO_Queue {
+    Allocator_Base*    allocator;
+    IO_Queue_Internal* internal;
+    u32                outstanding; // submitted, but callback not run yet
+
+    void init(Allocator_Base* allocator = nullptr, bool force_thread_pool = false);
+    void deinit(); // waits for all outstanding requests
+
+    void submit(IO_Request* request);
+    u32  poll();     // never blocks, returns the number of callbacks run
+    void wait_all(); // blocks until every submitted request is completed
+    bool uses_io_uring();
+};
+
 auto move_file(const char* old_name, const char* new_name) -> bool;
 auto delete_file(const char* path) -> bool;
 // auto copy_file(const char* src, const char* dest) -> bool;
@@ -1453,6 +2141,16 @@ struct File_Walk_Info {
     bool recursive;
     bool with_files;
     bool with_directories;
+
+    // NOTE(Felix): Linux only. With `skip_stat` the file_info of the entries
+    //   only has `exists` and `is_directory` set, which usually come for free
+    //   with the directory listing; size and modification time would cost a
+    //   stat per entry. With a `thread_count` above 1 the directories are
+    //   walked by that many threads, so the callback is called concurrently
+    //   and has to be thread safe; the order of the entries is not defined
+    //   then.
+    bool skip_stat;
+    u32  thread_count;
 };
 
 enum struct Walk_Status {
@@ -1563,6 +2261,16 @@ struct Panicking_Allocator {
     // NOTE(Felix): no special fields needed
 };
 
+// NOTE(Felix): Allocator that serializes all calls to the next allocator, so
+//   allocators that are not thread safe (like the linear allocator) can be
+//   shared between threads.
+struct Locking_Allocator {
+    Allocator_Base   base;
+    std::atomic_flag lock;
+
+    void init(Allocator_Base* next_allocator = nullptr);
+};
+
 struct Linear_Segment {
     Linear_Segment* prev_segment;
 
@@ -1595,6 +2303,52 @@ auto scratch_arena_start(Scratch_Arena previous) -> Scratch_Arena;
 auto scratch_arena_end(Scratch_Arena) -> void;
 
 
+// ----------------------------------------------------------------------------
+//                              String Interner
+// ----------------------------------------------------------------------------
+// NOTE(Felix): Maps byte spans to stable, densely packed u32 ids. The bytes of
+//   the interned strings live in a Linear_Allocator and never move, so the
+//   String returned by get_string stays valid until deinit. `lookup` and
+//   `get_string` don't take any lock and may run while another thread is in
+//   `intern`; calls to `intern` are serialized by a spinlock.
+typedef u32 Interned_Id;
+#define INTERNED_ID_INVALID ((Interned_Id)-1)
+
+struct Interned_Entry {
+    u64         hash;
+    String      string;
+    Interned_Id id;
+};
+
+struct Interner_Table {
+    Interner_Table*               prev_table; // retired tables, freed on deinit
+    u64                           capacity;   // always a power of 2
+    std::atomic<Interned_Entry*>* slots;
+};
+
+struct String_Interner {
+    Linear_Allocator             string_arena;
+    Allocator_Base*              allocator;
+    std::atomic<Interner_Table*> table;
+    // NOTE(Felix): chunk i holds 32<<i entries, so the id->entry mapping never
+    //   has to be reallocated and can be read without locking.
+    std::atomic<Interned_Entry*> chunks[27];
+    std::atomic<u32>             count;
+    std::atomic_flag             write_lock;
+
+    void init(u32 initial_capacity = 64, Allocator_Base* allocator = nullptr);
+    void deinit();
+
+    auto intern(const char* str, u64 length) -> Interned_Id;
+    auto intern(const char* str) -> Interned_Id;
+    // NOTE(Felix): returns INTERNED_ID_INVALID if str was never interned
+    auto lookup(const char* str, u64 length) -> Interned_Id;
+    auto get_string(Interned_Id id) -> String;
+};
+
+auto hash_bytes(const void* data, u64 length) -> u64;
+
+
 // ----------------------------------------------------------------------------
 //                              Errors
 // ----------------------------------------------------------------------------
@@ -1617,6 +2371,14 @@ struct Result {
 Result error(Error_Type);
 
 #ifdef FTB_CORE_IMPL
+
+// NOTE(Felix): only the implementation starts threads (the IO_Queue workers,
+//   the walk_directory helpers and the async log thread), so only it pulls in
+//   the threading headers
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 // ----------------------------------------------------------------------------
 //                              Perf_Counter
@@ -1625,14 +2387,24 @@ Result error(Error_Type);
 # include <time.h>
 #endif
 
+#ifndef FTB_WINDOWS
+inline auto perf_counter_nanos() -> u64 {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return (u64)now.tv_sec * 1'000'000'000 + (u64)now.tv_nsec;
+}
+#endif
+
+// NOTE(Felix): The differences are taken in integers and only the result is
+//   converted, so long running counters don't lose precision.
 void init(Perf_Counter* pc) {
 #ifdef FTB_WINDOWS
     QueryPerformanceCounter((LARGE_INTEGER*)&pc->last_counter);
     s64 freq;
     QueryPerformanceFrequency((LARGE_INTEGER*)&freq);
-    pc->one_over_perf_frequency = 1.0f / freq;
+    pc->seconds_per_count = 1.0 / freq;
 #else
-    clock_gettime(CLOCK_MONOTONIC_RAW, &pc->last_timespec);
+    pc->last_nanos = perf_counter_nanos();
 #endif
 }
 
@@ -1641,17 +2413,12 @@ f32 tick(Perf_Counter* pc) {
     s64 old = pc->last_counter;
     QueryPerformanceCounter((LARGE_INTEGER*)&pc->last_counter);
 
-    s64 diff = (pc->last_counter - old);
-    return diff * pc->one_over_perf_frequency;
+    return (f32)((pc->last_counter - old) * pc->seconds_per_count);
 #else
-    struct timespec old = pc->last_timespec;
-    clock_gettime(CLOCK_MONOTONIC_RAW, &pc->last_timespec);
-
-    f32 diff =
-        (pc->last_timespec.tv_sec - old.tv_sec) +
-        (pc->last_timespec.tv_nsec - old.tv_nsec) / 1e9;
+    u64 old = pc->last_nanos;
+    pc->last_nanos = perf_counter_nanos();
 
-    return diff;
+    return (f32)((pc->last_nanos - old) * 1e-9);
 #endif
 }
 
@@ -1685,10 +2452,10 @@ auto read_entire_file(const char* filename, Allocator_Base* allocator) -> File_R
             }
 
             /* Allocate our buffer to that size. */
-            ret.contents.string.data = allocator->allocate<char>((u32)ret.contents.string.length+1);
-        panic_if(!ret.contents.string.data,
-             "Could not allocate space for file contents (%u bytes) ",
-             ret.contents.string.length+1);
+            ret.contents.string.data = allocator->allocate<char>(ret.contents.string.length+1);
+            panic_if(!ret.contents.string.data,
+                     "Could not allocate space for file contents (%llu bytes) ",
+                     ret.contents.string.length+1);
 
             /* Read the entire file into memory. */
             ret.contents.string.length = fread(ret.contents.string.data, sizeof(char),
@@ -1707,90 +2474,783 @@ auto read_entire_file(const char* filename, Allocator_Base* allocator) -> File_R
     return ret;
 }
 
-#ifdef FTB_LINUX
-#  include <sys/stat.h>
-#  include <errno.h>
-#  include <dirent.h>
-auto move_file(const char* old_name, const char* new_name) -> bool {
-    return rename(old_name, new_name) == 0;
-}
+#ifdef FTB_WINDOWS
+auto map_entire_file(const char* filename) -> Mapped_File {
+    File_Read read = read_entire_file(filename, libc_allocator);
+    if (!read.success)
+        return {};
 
-auto delete_file(const char* path) -> bool {
-    return remove(path) == 0;
+    return {
+        .success  = true,
+        .contents = read.contents.string,
+        .mapping  = read.contents.string.data,
+    };
 }
 
-// auto copy_file(const char* src, const char* dest) -> bool {
-//     panic("NYI");
-//     return false;
-// }
-
-
-auto walk_files(const char* dir_name, File_Walk_Info walk_info, void (*callback)(Path_Info, Walk_Status*, void*), void* user_data) -> void {
-    Scratch_Arena work_list_scratch = scratch_arena_start();
-    defer { scratch_arena_end(work_list_scratch); };
-    Allocated_String dir_name_alloc_str = Allocated_String::from(dir_name, work_list_scratch.arena);
-
-    Array_List<Allocated_String> dirs_to_do {};
-    dirs_to_do.init();
-    dirs_to_do.append(dir_name_alloc_str);
-    defer { dirs_to_do.deinit(); };
-    bool first_dir = true;
-
-    while (dirs_to_do.count != 0) {
-        Scratch_Arena scratch = scratch_arena_start(work_list_scratch);
-        defer { scratch_arena_end(scratch); };
+auto unmap_file(Mapped_File* file) -> void {
+    if (file->mapping)
+        libc_allocator->deallocate(file->mapping);
+    *file = {};
+}
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+auto map_entire_file(const char* filename) -> Mapped_File {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return {};
+    defer { close(fd); };
 
-        Allocated_String dir = dirs_to_do.data[--dirs_to_do.count];
-        DIR* dir_handle = opendir(dir.string.data);
-        bool success = dir_handle != nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return {};
 
-        if (!success)
-            continue;
+    u64 file_size = (u64)st.st_size;
+    u64 page_size = (u64)sysconf(_SC_PAGESIZE);
 
-        defer { closedir(dir_handle); };
+    // NOTE(Felix): reserve one byte more than the file, rounded up to whole
+    //   pages, as zeroed anonymous memory and map the file over the start of
+    //   it. The byte behind the file is then always a readable 0, even if the
+    //   file size is a multiple of the page size.
+    u64 mapping_size = (file_size + 1 + page_size - 1) & ~(page_size - 1);
+    void* mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED)
+        return {};
 
-        while (true) {
-            Scratch_Arena scratch = scratch_arena_start(work_list_scratch);
-            defer { scratch_arena_end(scratch); };
+    if (file_size > 0) {
+        void* file_mapping = mmap(mapping, file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+        if (file_mapping == MAP_FAILED) {
+            munmap(mapping, mapping_size);
+            return {};
+        }
+        madvise(mapping, file_size, MADV_SEQUENTIAL);
+        madvise(mapping, file_size, MADV_WILLNEED);
+    }
 
-            struct dirent* dir_ent = readdir(dir_handle);
-            if (dir_ent == nullptr)
-                break;
+    return {
+        .success      = true,
+        .contents     = { (char*)mapping, file_size },
+        .mapping      = mapping,
+        .mapping_size = mapping_size,
+    };
+}
 
-            Path_Info pi {};
-            pi.full_path = join_paths(dir.string, String::over(dir_ent->d_name),
-                                      false, scratch.arena);
-            pi.file_info.exists = true;
-            pi.file_info = file_info(pi.full_path.string.data);
-            pi.recalculate_indices();
+auto unmap_file(Mapped_File* file) -> void {
+    if (file->mapping)
+        munmap(file->mapping, file->mapping_size);
+    *file = {};
+}
+#endif
 
-            // NOTE(Felix): Yes, '.' and '..' are returned from readdir
-            if (pi.get_local_name() == string_from_literal(".") ||
-                pi.get_local_name() == string_from_literal(".."))
-            {
-                continue;
-            }
+// ----------------------------------------------------------------------------
+//                              async IO impl
+// ----------------------------------------------------------------------------
+#ifdef FTB_LINUX
+#  include <linux/io_uring.h>
+#  include <sys/syscall.h>
+#endif
 
-            bool should_callback =
-                (pi.file_info.is_directory && walk_info.with_directories)
-                || (!pi.file_info.is_directory && walk_info.with_files);
+struct IO_Queue_Internal {
+    // completed requests, waiting for their callbacks
+    std::mutex  completed_lock;
+    IO_Request* completed_head;
+    IO_Request* completed_tail;
 
-            Walk_Status status = walk_info.recursive ? Walk_Status::Continue_Recurse : Walk_Status::Continue;
+    // requests not handed to the backend yet
+    IO_Request* pending_head;
+    IO_Request* pending_tail;
 
-            if (should_callback) {
-                callback(pi, &status, user_data);
+    // thread pool
+    std::thread*            workers;
+    u32                     worker_count;
+    std::mutex              work_lock;
+    std::condition_variable work_available;
+    std::condition_variable work_completed;
+    bool                    shutting_down;
 
-                if (status == Walk_Status::Done) {
-                    return;
-                }
+#ifdef FTB_LINUX
+    // io_uring
+    bool      uses_io_uring;
+    int       ring_fd;
+    u32       in_flight;
+    u32       sq_entries;
+    void*     sq_ring;
+    void*     cq_ring;
+    u64       sq_ring_size;
+    u64       cq_ring_size;
+    io_uring_sqe* sqes;
+    u32*      sq_head;
+    u32*      sq_tail;
+    u32*      sq_mask;
+    u32*      sq_array;
+    u32*      cq_head;
+    u32*      cq_tail;
+    u32*      cq_mask;
+    io_uring_cqe* cqes;
+#endif
+};
 
-            }
+void io_list_append(IO_Request** head, IO_Request** tail, IO_Request* request) {
+    request->next = nullptr;
+    if (*tail)
+        (*tail)->next = request;
+    else
+        *head = request;
+    *tail = request;
+}
 
-            if (pi.file_info.is_directory && status == Walk_Status::Continue_Recurse) {
-                Allocated_String inner_path = Allocated_String::from(pi.full_path.string, work_list_scratch.arena);
-                dirs_to_do.append(inner_path);
-            }
-        }
+IO_Request* io_list_pop(IO_Request** head, IO_Request** tail) {
+    IO_Request* request = *head;
+    if (request) {
+        *head = request->next;
+        if (!*head)
+            *tail = nullptr;
+    }
+    return request;
+}
+
+void io_complete(IO_Queue* queue, IO_Request* request) {
+    if (!request->success && request->contents.string.data) {
+        request->contents.free();
+        request->contents = {};
+    }
+    std::lock_guard<std::mutex> guard(queue->internal->completed_lock);
+    io_list_append(&queue->internal->completed_head, &queue->internal->completed_tail, request);
+}
+
+// ----------------------------------------------------------------------------
+//   thread pool backend
+// ----------------------------------------------------------------------------
+void io_execute_blocking(IO_Queue* queue, IO_Request* request) {
+    if (request->op == IO_Op::Read_File) {
+        File_Read read = read_entire_file(request->path, queue->allocator);
+        request->success = read.success;
+        if (read.success)
+            request->contents = read.contents;
+    } else {
+        FILE* file = fopen(request->path, "wb");
+        if (file) {
+            request->success =
+                fwrite(request->data.data, 1, request->data.length, file) == request->data.length;
+            request->success &= fclose(file) == 0;
+        }
+    }
+}
+
+void io_worker(IO_Queue* queue) {
+    IO_Queue_Internal* in = queue->internal;
+    while (true) {
+        IO_Request* request;
+        {
+            std::unique_lock<std::mutex> lock(in->work_lock);
+            in->work_available.wait(lock, [&]() {
+                return in->pending_head || in->shutting_down;
+            });
+            request = io_list_pop(&in->pending_head, &in->pending_tail);
+            if (!request)
+                return; // shutting down and nothing left to do
+        }
+
+        io_execute_blocking(queue, request);
+        io_complete(queue, request);
+
+        std::lock_guard<std::mutex> guard(in->work_lock);
+        in->work_completed.notify_all();
+    }
+}
+
+#ifdef FTB_LINUX
+// ----------------------------------------------------------------------------
+//   io_uring backend
+// ----------------------------------------------------------------------------
+enum struct IO_Stage : u8 {
+    Open,
+    Transfer,
+    Close,
+};
+
+bool io_uring_init(IO_Queue_Internal* in, u32 entries) {
+    io_uring_params params {};
+    int fd = (int)syscall(SYS_io_uring_setup, entries, &params);
+    if (fd < 0)
+        return false;
+
+    // NOTE(Felix): openat, read, write and close through the ring need 5.6,
+    //   which is also when IORING_FEAT_RW_CUR_POS came in
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) ||
+        !(params.features & IORING_FEAT_RW_CUR_POS))
+    {
+        close(fd);
+        return false;
+    }
+
+    in->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+    in->cq_ring_size = params.cq_off.cqes  + params.cq_entries * sizeof(io_uring_cqe);
+    in->sq_ring_size = MAX(in->sq_ring_size, in->cq_ring_size);
+    in->cq_ring_size = in->sq_ring_size;
+
+    void* ring = mmap(nullptr, in->sq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    void* sqes = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        munmap(ring, in->sq_ring_size);
+        close(fd);
+        return false;
+    }
+
+    in->uses_io_uring = true;
+    in->ring_fd    = fd;
+    in->sq_entries = params.sq_entries;
+    in->sq_ring    = ring;
+    in->cq_ring    = ring;
+    in->sqes       = (io_uring_sqe*)sqes;
+    in->sq_head    = (u32*)((u8*)ring + params.sq_off.head);
+    in->sq_tail    = (u32*)((u8*)ring + params.sq_off.tail);
+    in->sq_mask    = (u32*)((u8*)ring + params.sq_off.ring_mask);
+    in->sq_array   = (u32*)((u8*)ring + params.sq_off.array);
+    in->cq_head    = (u32*)((u8*)ring + params.cq_off.head);
+    in->cq_tail    = (u32*)((u8*)ring + params.cq_off.tail);
+    in->cq_mask    = (u32*)((u8*)ring + params.cq_off.ring_mask);
+    in->cqes       = (io_uring_cqe*)((u8*)ring + params.cq_off.cqes);
+    return true;
+}
+
+void io_uring_deinit(IO_Queue_Internal* in) {
+    munmap(in->sqes, in->sq_entries * sizeof(io_uring_sqe));
+    munmap(in->sq_ring, in->sq_ring_size);
+    close(in->ring_fd);
+}
+
+// NOTE(Felix): every request has at most one operation in the ring, and we
+//   never have more requests in flight than there are entries, so there is
+//   always a free sqe here
+void io_uring_push(IO_Queue_Internal* in, IO_Request* request) {
+    u32 tail  = *in->sq_tail;
+    u32 index = tail & *in->sq_mask;
+    io_uring_sqe* sqe = &in->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = (u64)request;
+
+    switch ((IO_Stage)request->stage) {
+        case IO_Stage::Open: {
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd     = AT_FDCWD;
+            sqe->addr   = (u64)request->path;
+            if (request->op == IO_Op::Read_File) {
+                sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            } else {
+                sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+                sqe->len        = 0644;
+            }
+        } break;
+        case IO_Stage::Transfer: {
+            sqe->fd  = request->fd;
+            sqe->off = request->done_bytes;
+            sqe->len = (u32)MIN(request->size - request->done_bytes, (u64)1 << 30);
+            if (request->op == IO_Op::Read_File) {
+                sqe->opcode = IORING_OP_READ;
+                sqe->addr   = (u64)(request->contents.string.data + request->done_bytes);
+            } else {
+                sqe->opcode = IORING_OP_WRITE;
+                sqe->addr   = (u64)(request->data.data + request->done_bytes);
+            }
+        } break;
+        case IO_Stage::Close: {
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd     = request->fd;
+        } break;
+    }
+
+    in->sq_array[index] = index;
+    __atomic_store_n(in->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+void io_uring_advance(IO_Queue* queue, IO_Request* request, s32 result) {
+    IO_Queue_Internal* in = queue->internal;
+
+    switch ((IO_Stage)request->stage) {
+        case IO_Stage::Open: {
+            if (result < 0) {
+                --in->in_flight;
+                io_complete(queue, request);
+                return;
+            }
+            request->fd         = result;
+            request->done_bytes = 0;
+            request->success    = true;
+
+            if (request->op == IO_Op::Read_File) {
+                // NOTE(Felix): the inode was just loaded by the open, so this
+                //   does not wait on the disk
+                struct stat st;
+                if (fstat(request->fd, &st) != 0) {
+                    request->success = false;
+                    request->stage   = (u8)IO_Stage::Close;
+                    break;
+                }
+                request->size = (u64)st.st_size;
+                request->contents.allocator   = queue->allocator;
+                request->contents.string.data = queue->allocator->allocate<char>(request->size+1);
+                request->contents.string.length = 0;
+                request->contents.string.data[0] = '\0';
+            } else {
+                request->size = request->data.length;
+            }
+
+            request->stage = request->size
+                ? (u8)IO_Stage::Transfer
+                : (u8)IO_Stage::Close;
+        } break;
+        case IO_Stage::Transfer: {
+            if (result < 0) {
+                request->success = false;
+                request->stage   = (u8)IO_Stage::Close;
+                break;
+            }
+            request->done_bytes += result;
+            if (request->op == IO_Op::Read_File) {
+                request->contents.string.length = request->done_bytes;
+                request->contents.string.data[request->done_bytes] = '\0';
+            }
+            if (result == 0) {
+                // NOTE(Felix): the file got shorter while reading (or the
+                //   disk is full when writing)
+                request->success &= request->op == IO_Op::Read_File;
+                request->stage = (u8)IO_Stage::Close;
+            } else if (request->done_bytes == request->size) {
+                request->stage = (u8)IO_Stage::Close;
+            }
+        } break;
+        case IO_Stage::Close: {
+            request->success &= result == 0;
+            --in->in_flight;
+            io_complete(queue, request);
+            return;
+        }
+    }
+
+    io_uring_push(in, request);
+}
+
+// NOTE(Felix): hands pending requests to the ring, submits everything and
+//   processes what completed, waiting for at least `wait_for` completions
+void io_uring_pump(IO_Queue* queue, u32 wait_for) {
+    IO_Queue_Internal* in = queue->internal;
+
+    while (in->pending_head && in->in_flight < in->sq_entries) {
+        IO_Request* request = io_list_pop(&in->pending_head, &in->pending_tail);
+        request->stage = (u8)IO_Stage::Open;
+        ++in->in_flight;
+        io_uring_push(in, request);
+    }
+
+    u32 to_submit = *in->sq_tail - __atomic_load_n(in->sq_head, __ATOMIC_ACQUIRE);
+    if (to_submit || wait_for) {
+        u32 flags = wait_for ? IORING_ENTER_GETEVENTS : 0;
+        syscall(SYS_io_uring_enter, in->ring_fd, to_submit, wait_for, flags, nullptr, 0);
+    }
+
+    u32 head = *in->cq_head;
+    u32 tail = __atomic_load_n(in->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        io_uring_cqe* cqe = &in->cqes[head & *in->cq_mask];
+        IO_Request* request = (IO_Request*)cqe->user_data;
+        s32 result = cqe->res;
+        ++head;
+        __atomic_store_n(in->cq_head, head, __ATOMIC_RELEASE);
+
+        io_uring_advance(queue, request, result);
+        tail = __atomic_load_n(in->cq_tail, __ATOMIC_ACQUIRE);
+    }
+}
+#endif
+
+// ----------------------------------------------------------------------------
+//   IO_Queue
+// ----------------------------------------------------------------------------
+void IO_Queue::init(Allocator_Base* in_allocator, bool force_thread_pool) {
+    allocator   = in_allocator ? in_allocator : libc_allocator;
+    outstanding = 0;
+    internal    = new (libc_allocator->allocate<IO_Queue_Internal>()) IO_Queue_Internal {};
+
+#ifdef FTB_LINUX
+    if (!force_thread_pool && io_uring_init(internal, 256))
+        return;
+#endif
+
+    internal->worker_count = MIN(MAX(std::thread::hardware_concurrency(), 2u), 8u);
+    internal->workers = libc_allocator->allocate<std::thread>(internal->worker_count);
+    for (u32 i = 0; i < internal->worker_count; ++i)
+        new (&internal->workers[i]) std::thread(io_worker, this);
+}
+
+void IO_Queue::deinit() {
+    wait_all();
+
+#ifdef FTB_LINUX
+    if (internal->uses_io_uring) {
+        io_uring_deinit(internal);
+    } else
+#endif
+    {
+        {
+            std::lock_guard<std::mutex> guard(internal->work_lock);
+            internal->shutting_down = true;
+        }
+        internal->work_available.notify_all();
+        for (u32 i = 0; i < internal->worker_count; ++i) {
+            internal->workers[i].join();
+            internal->workers[i].~thread();
+        }
+        libc_allocator->deallocate(internal->workers);
+    }
+
+    internal->~IO_Queue_Internal();
+    libc_allocator->deallocate(internal);
+    *this = {};
+}
+
+bool IO_Queue::uses_io_uring() {
+#ifdef FTB_LINUX
+    return internal->uses_io_uring;
+#else
+    return false;
+#endif
+}
+
+void IO_Queue::submit(IO_Request* request) {
+    request->success  = false;
+    request->contents = {};
+    request->fd       = -1;
+    ++outstanding;
+
+#ifdef FTB_LINUX
+    if (internal->uses_io_uring) {
+        // NOTE(Felix): collected here and submitted in one go on the next
+        //   poll or wait_all
+        io_list_append(&internal->pending_head, &internal->pending_tail, request);
+        return;
+    }
+#endif
+    {
+        std::lock_guard<std::mutex> guard(internal->work_lock);
+        io_list_append(&internal->pending_head, &internal->pending_tail, request);
+    }
+    internal->work_available.notify_one();
+}
+
+u32 IO_Queue::poll() {
+#ifdef FTB_LINUX
+    if (internal->uses_io_uring)
+        io_uring_pump(this, 0);
+#endif
+
+    IO_Request* completed;
+    {
+        std::lock_guard<std::mutex> guard(internal->completed_lock);
+        completed = internal->completed_head;
+        internal->completed_head = nullptr;
+        internal->completed_tail = nullptr;
+    }
+
+    u32 count = 0;
+    while (completed) {
+        IO_Request* next = completed->next;
+        --outstanding;
+        ++count;
+        if (completed->callback)
+            completed->callback(completed);
+        completed = next;
+    }
+    return count;
+}
+
+void IO_Queue::wait_all() {
+    while (outstanding) {
+        if (poll())
+            continue;
+
+#ifdef FTB_LINUX
+        if (internal->uses_io_uring) {
+            io_uring_pump(this, 1);
+            continue;
+        }
+#endif
+        std::unique_lock<std::mutex> lock(internal->work_lock);
+        internal->work_completed.wait(lock, [&]() {
+            std::lock_guard<std::mutex> guard(internal->completed_lock);
+            return internal->completed_head != nullptr;
+        });
+    }
+}
+
+#ifdef FTB_LINUX
+#  include <sys/stat.h>
+#  include <errno.h>
+#  include <dirent.h>
+auto move_file(const char* old_name, const char* new_name) -> bool {
+    return rename(old_name, new_name) == 0;
+}
+
+auto delete_file(const char* path) -> bool {
+    return remove(path) == 0;
+}
+
+// auto copy_file(const char* src, const char* dest) -> bool {
+//     panic("NYI");
+//     return false;
+// }
+
+
+struct Walk_Files_Context {
+    File_Walk_Info    walk_info;
+    void            (*callback)(Path_Info, Walk_Status*, void*);
+    void*             user_data;
+    std::atomic<bool> done;
+
+    // NOTE(Felix): every directory that was walked (open addressing, an
+    //   inode of 0 marks a free slot), guarded by `lock`
+    struct Dir_Id {
+        u64 device;
+        u64 inode;
+    };
+    Dir_Id*                 visited;
+    u32                     visited_count;
+    u32                     visited_capacity;
+
+    // NOTE(Felix): only used when walking on several threads
+    std::mutex              lock;
+    std::condition_variable work_available;
+    Array_List<char*>       dirs_to_do;
+    u32                     busy_threads;
+};
+
+// NOTE(Felix): Returns true only the first time a directory is seen. Links
+//   make directories reachable on several paths and can form cycles (like
+//   /usr/bin/X11 -> .), so every directory is only walked once, on whichever
+//   path reaches it first.
+auto walk_files_first_visit(Walk_Files_Context* ctx, u64 device, u64 inode) -> bool {
+    typedef Walk_Files_Context::Dir_Id Dir_Id;
+    auto slot_of = [](Dir_Id* table, u32 capacity, u64 device, u64 inode) -> Dir_Id* {
+        u64 hash = (inode ^ (device << 32 | device >> 32)) * 0x9E3779B97F4A7C15ull;
+        for (u32 i = (u32)(hash >> 32) & (capacity-1);; i = (i+1) & (capacity-1)) {
+            Dir_Id* slot = &table[i];
+            if (slot->inode == 0 || (slot->inode == inode && slot->device == device))
+                return slot;
+        }
+    };
+
+    std::lock_guard<std::mutex> guard(ctx->lock);
+    if ((ctx->visited_count + 1) * 2 > ctx->visited_capacity) {
+        u32 capacity = MAX(ctx->visited_capacity * 2, 64u);
+        Dir_Id* table = libc_allocator->allocate_0<Dir_Id>(capacity);
+        for (u32 i = 0; i < ctx->visited_capacity; ++i) {
+            Dir_Id id = ctx->visited[i];
+            if (id.inode != 0)
+                *slot_of(table, capacity, id.device, id.inode) = id;
+        }
+        libc_allocator->deallocate(ctx->visited);
+        ctx->visited          = table;
+        ctx->visited_capacity = capacity;
+    }
+
+    Dir_Id* slot = slot_of(ctx->visited, ctx->visited_capacity, device, inode);
+    if (slot->inode != 0)
+        return false;
+    *slot = { device, inode };
+    ++ctx->visited_count;
+    return true;
+}
+
+struct Linux_Dirent64 {
+    u64  d_ino;
+    s64  d_off;
+    u16  d_reclen;
+    u8   d_type;
+    char d_name[];
+};
+
+// NOTE(Felix): Lists one directory with getdents64 and calls the callback for
+//   its entries. The paths are built in one buffer per directory, so they are
+//   only valid during the callback. Subdirectories to recurse into are
+//   appended to `out_dirs` (allocated with libc_allocator).
+auto walk_directory(Walk_Files_Context* ctx, const char* dir, Array_List<char*>* out_dirs) -> void {
+    int dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0)
+        return;
+    defer { close(dir_fd); };
+
+    struct stat dir_stat;
+    if (fstat(dir_fd, &dir_stat) != 0 ||
+        !walk_files_first_visit(ctx, dir_stat.st_dev, dir_stat.st_ino))
+    {
+        return;
+    }
+
+    u64 dir_length = strlen(dir);
+    bool needs_separator = dir_length > 0 && dir[dir_length-1] != '/';
+    u64 name_start = dir_length + needs_separator;
+
+    // NOTE(Felix): names are at most 255 bytes
+    char* path = libc_allocator->allocate<char>(name_start + 256);
+    defer { libc_allocator->deallocate(path); };
+    memcpy(path, dir, dir_length);
+    if (needs_separator)
+        path[dir_length] = '/';
+
+    alignas(8) char buffer[32 * 1024];
+    while (!ctx->done.load(std::memory_order_relaxed)) {
+        long read = syscall(SYS_getdents64, dir_fd, buffer, sizeof(buffer));
+        if (read <= 0)
+            break;
+
+        for (long offset = 0; offset < read;) {
+            Linux_Dirent64* entry = (Linux_Dirent64*)(buffer + offset);
+            offset += entry->d_reclen;
+
+            const char* name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                continue;
+
+            u64 name_length = strlen(name);
+            memcpy(path + name_start, name, name_length+1);
+
+            Path_Info pi {};
+            pi.full_path.string = { path, name_start + name_length };
+
+            // NOTE(Felix): links are reported like stat sees them (so a link
+            //   to a directory is a directory and is recursed into, unless
+            //   it was walked already). Some file systems don't fill in
+            //   d_type.
+            bool is_link = entry->d_type == DT_LNK;
+            if (ctx->walk_info.skip_stat && entry->d_type != DT_UNKNOWN && !is_link) {
+                pi.file_info.exists       = true;
+                pi.file_info.is_directory = entry->d_type == DT_DIR;
+            } else {
+                struct stat stat_info;
+                bool ok = true;
+                if (entry->d_type == DT_UNKNOWN) {
+                    ok      = fstatat(dir_fd, name, &stat_info, AT_SYMLINK_NOFOLLOW) == 0;
+                    is_link = ok && S_ISLNK(stat_info.st_mode);
+                }
+                if (entry->d_type != DT_UNKNOWN || is_link)
+                    ok = fstatat(dir_fd, name, &stat_info, 0) == 0;
+
+                if (ok) {
+                    pi.file_info.exists            = true;
+                    pi.file_info.size              = stat_info.st_size;
+                    pi.file_info.modification_time = stat_info.st_mtime;
+                    pi.file_info.is_directory      = (stat_info.st_mode & S_IFMT) == S_IFDIR;
+                }
+            }
+            pi.recalculate_indices();
+
+            bool should_callback =
+                (pi.file_info.is_directory && ctx->walk_info.with_directories)
+                || (!pi.file_info.is_directory && ctx->walk_info.with_files);
+
+            Walk_Status status = ctx->walk_info.recursive ? Walk_Status::Continue_Recurse : Walk_Status::Continue;
+
+            if (should_callback) {
+                ctx->callback(pi, &status, ctx->user_data);
+
+                if (status == Walk_Status::Done) {
+                    ctx->done = true;
+                    return;
+                }
+            }
+
+            if (pi.file_info.is_directory && status == Walk_Status::Continue_Recurse) {
+                out_dirs->append(heap_copy_limited_c_string(path, (u32)pi.full_path.string.length, libc_allocator));
+            }
+        }
+    }
+}
+
+auto walk_files_worker(Walk_Files_Context* ctx) -> void {
+    Array_List<char*> found_dirs;
+    found_dirs.init(64, libc_allocator);
+    defer { found_dirs.deinit(); };
+
+    while (true) {
+        char* dir;
+        {
+            std::unique_lock<std::mutex> lock(ctx->lock);
+            ctx->work_available.wait(lock, [&]() {
+                return ctx->dirs_to_do.count != 0 || ctx->busy_threads == 0 || ctx->done;
+            });
+            // NOTE(Felix): nothing left to do and nobody who could find more
+            if (ctx->dirs_to_do.count == 0 || ctx->done)
+                break;
+            dir = ctx->dirs_to_do.data[--ctx->dirs_to_do.count];
+            ++ctx->busy_threads;
+        }
+
+        found_dirs.clear();
+        walk_directory(ctx, dir, &found_dirs);
+        libc_allocator->deallocate(dir);
+
+        std::lock_guard<std::mutex> guard(ctx->lock);
+        for (char* found : found_dirs)
+            ctx->dirs_to_do.append(found);
+        --ctx->busy_threads;
+        ctx->work_available.notify_all();
+    }
+    ctx->work_available.notify_all();
+}
+
+auto walk_files(const char* dir_name, File_Walk_Info walk_info, void (*callback)(Path_Info, Walk_Status*, void*), void* user_data) -> void {
+    Walk_Files_Context ctx {};
+    ctx.walk_info = walk_info;
+    ctx.callback  = callback;
+    ctx.user_data = user_data;
+    ctx.done      = false;
+
+    ctx.dirs_to_do.init(64, libc_allocator);
+    ctx.dirs_to_do.append(heap_copy_c_string(dir_name, libc_allocator));
+    defer {
+        // NOTE(Felix): leftovers if the walk was stopped early
+        for (char* dir : ctx.dirs_to_do)
+            libc_allocator->deallocate(dir);
+        ctx.dirs_to_do.deinit();
+        libc_allocator->deallocate(ctx.visited);
+    };
+
+    if (walk_info.thread_count <= 1) {
+        Array_List<char*> found_dirs;
+        found_dirs.init(64, libc_allocator);
+        defer { found_dirs.deinit(); };
+
+        while (ctx.dirs_to_do.count != 0 && !ctx.done) {
+            char* dir = ctx.dirs_to_do.data[--ctx.dirs_to_do.count];
+            found_dirs.clear();
+            walk_directory(&ctx, dir, &found_dirs);
+            libc_allocator->deallocate(dir);
+
+            for (char* found : found_dirs)
+                ctx.dirs_to_do.append(found);
+        }
+        return;
+    }
+
+    // NOTE(Felix): one thread of the pool is the calling one
+    ctx.busy_threads = 0;
+    std::thread* threads = libc_allocator->allocate<std::thread>(walk_info.thread_count-1);
+    defer { libc_allocator->deallocate(threads); };
+    for (u32 i = 0; i < walk_info.thread_count-1; ++i)
+        new (&threads[i]) std::thread(walk_files_worker, &ctx);
+
+    walk_files_worker(&ctx);
+
+    for (u32 i = 0; i < walk_info.thread_count-1; ++i) {
+        threads[i].join();
+        threads[i].~thread();
     }
 }
 
@@ -2321,7 +3781,7 @@ Allocator_Base* grab_current_allocator() {
 }
 
 void log_allocator(Allocator_Base* allocator) {
-    log_info("Allocator at %X", allocator);
+    log_info("Allocator at %p", allocator);
     if (allocator) {
         switch (allocator->type) {
 #         define ALLOCATOR(name) case Allocator_Type::name: log_info(" - Type: %s", #name); break;
@@ -2717,6 +4177,50 @@ void Bookkeeping_Allocator::print_statistics() {
     println("%{>color}");
 }
 
+//
+// Locking Allocator functions
+//
+struct Locking_Allocator_Guard {
+    Locking_Allocator* self;
+    Locking_Allocator_Guard(Allocator_Base* base) : self((Locking_Allocator*)base) {
+        while (self->lock.test_and_set(std::memory_order_acquire))
+            ; // spin, allocations are short
+    }
+    ~Locking_Allocator_Guard() {
+        self->lock.clear(std::memory_order_release);
+    }
+};
+
+void* Locking_Allocator_allocate(Allocator_Base* base, u64 size_in_bytes, u32 align) {
+    Locking_Allocator_Guard guard(base);
+    return base->next_allocator->allocate(size_in_bytes, align);
+}
+
+void* Locking_Allocator_allocate_0(Allocator_Base* base, u64 size_in_bytes, u32 align) {
+    Locking_Allocator_Guard guard(base);
+    return base->next_allocator->allocate_0(size_in_bytes, align);
+}
+
+void* Locking_Allocator_resize(Allocator_Base* base, void* old, u64 size_in_bytes, u32 align) {
+    Locking_Allocator_Guard guard(base);
+    return base->next_allocator->resize(old, size_in_bytes, align);
+}
+
+void Locking_Allocator_deallocate(Allocator_Base* base, void* data) {
+    Locking_Allocator_Guard guard(base);
+    base->next_allocator->deallocate(data);
+}
+
+void Locking_Allocator::init(Allocator_Base* next_allocator) {
+    base.type = Allocator_Type::Locking_Allocator;
+    if (next_allocator)
+        base.next_allocator = next_allocator;
+    else
+        base.next_allocator = grab_current_allocator();
+
+    lock.clear();
+}
+
 //
 // Linear Allocator functions
 //
@@ -2731,7 +4235,7 @@ void* Linear_Allocator_allocate(Allocator_Base* base, u64 amount, u32 align) {
     if (last_segment->count + effective_amount_to_allocate > last_segment->length) {
         // NOTE(Felix): Allocate new segment
         Linear_Segment* new_segment;
-        effective_amount_to_allocate = max(effective_amount_to_allocate, self->standard_segment_size);
+        effective_amount_to_allocate = MAX(effective_amount_to_allocate, self->standard_segment_size);
         void* new_data =
             allocate_with_preamble(sizeof(*new_segment), effective_amount_to_allocate,
                                    8, base->next_allocator, (void**)&new_segment);
@@ -2967,56 +4471,757 @@ Result error(Error_Type type) {
 }
 
 
-
 // ----------------------------------------------------------------------------
-//                              print impl
+//                            string interner impl
 // ----------------------------------------------------------------------------
+auto hash_bytes(const void* data, u64 length) -> u64 {
+    // NOTE(Felix): 64 bit FNV-1a
+    const u8* bytes = (const u8*)data;
+    u64 hash = 14695981039346656037llu;
+    for (u64 i = 0; i < length; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211llu;
+    }
+    return hash;
+}
 
-Allocator_Base* print_allocator;
-FILE* ftb_stdout = stdout;
+inline void interner_locate_entry(Interned_Id id, u32* out_chunk, u32* out_index_in_chunk) {
+    // NOTE(Felix): chunk c starts at id 32 * (2^c - 1)
+    u32 n     = id / 32 + 1;
+    u32 chunk = 0;
+    while (n >>= 1)
+        ++chunk;
 
-struct Custom_Printer {
-    const char*           invocation;
-    printer_function_ptr  fun;
-    Printer_Function_Type type;
-};
+    *out_chunk          = chunk;
+    *out_index_in_chunk = id - 32 * ((1u << chunk) - 1);
+}
 
-const char** prefix_stack;
-u32          prefix_stack_count;
-u32          prefix_stack_allocated;
+Interner_Table* interner_allocate_table(u64 capacity, Allocator_Base* allocator) {
+    Interner_Table* table = allocator->allocate<Interner_Table>();
+    table->prev_table = nullptr;
+    table->capacity   = capacity;
+    table->slots      = allocator->allocate_0<std::atomic<Interned_Entry*>>(capacity);
+    return table;
+}
 
-const char** color_stack;
-u32          color_stack_count;
-u32          color_stack_allocated;
+void interner_table_insert(Interner_Table* table, Interned_Entry* entry) {
+    u64 mask = table->capacity - 1;
+    u64 slot = entry->hash & mask;
+    while (table->slots[slot].load(std::memory_order_relaxed))
+        slot = (slot + 1) & mask;
+    table->slots[slot].store(entry, std::memory_order_release);
+}
 
-Custom_Printer* custom_printers;
-u32             custom_printers_count;
-u32             custom_printers_allocated;
+void String_Interner::init(u32 initial_capacity, Allocator_Base* allocator) {
+    if (!allocator)
+        allocator = grab_current_allocator();
+    this->allocator = allocator;
+
+    string_arena.init(4096, allocator);
+
+    // NOTE(Felix): keep the load factor at or below 0.5
+    u64 capacity = 16;
+    while (capacity < (u64)initial_capacity * 2)
+        capacity *= 2;
+
+    table.store(interner_allocate_table(capacity, allocator), std::memory_order_relaxed);
+    for (u32 i = 0; i < array_length(chunks); ++i)
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    write_lock.clear();
+}
+
+void String_Interner::deinit() {
+    Interner_Table* t = table.load(std::memory_order_relaxed);
+    while (t) {
+        Interner_Table* prev = t->prev_table;
+        allocator->deallocate(t->slots);
+        allocator->deallocate(t);
+        t = prev;
+    }
+    table.store(nullptr, std::memory_order_relaxed);
+
+    for (u32 i = 0; i < array_length(chunks); ++i) {
+        Interned_Entry* chunk = chunks[i].load(std::memory_order_relaxed);
+        if (chunk)
+            allocator->deallocate(chunk);
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+
+    string_arena.deinit();
+}
 
-Custom_Printer* find_custom_printer(const char *spec) {
-    for (u32 i = 0; i < custom_printers_count; ++i) {
-        if (strcmp(custom_printers[i].invocation, spec) == 0) {
-            return &custom_printers[i];
+auto String_Interner::lookup(const char* str, u64 length) -> Interned_Id {
+    u64 hash = hash_bytes(str, length);
+
+    Interner_Table* t = table.load(std::memory_order_acquire);
+    u64 mask = t->capacity - 1;
+    for (u64 slot = hash & mask;; slot = (slot + 1) & mask) {
+        Interned_Entry* entry = t->slots[slot].load(std::memory_order_acquire);
+        if (!entry)
+            return INTERNED_ID_INVALID;
+
+        if (entry->hash          == hash   &&
+            entry->string.length == length &&
+            memcmp(entry->string.data, str, length) == 0)
+        {
+            return entry->id;
         }
     }
-    return nullptr;
+}
+
+auto String_Interner::intern(const char* str, u64 length) -> Interned_Id {
+    Interned_Id id = lookup(str, length);
+    if (id != INTERNED_ID_INVALID)
+        return id;
+
+    while (write_lock.test_and_set(std::memory_order_acquire))
+        ; // spin
+    defer { write_lock.clear(std::memory_order_release); };
+
+    // NOTE(Felix): someone else might have interned it while we were waiting
+    //   for the lock
+    id = lookup(str, length);
+    if (id != INTERNED_ID_INVALID)
+        return id;
+
+    id = count.load(std::memory_order_relaxed);
+    panic_if(id == INTERNED_ID_INVALID, "String_Interner is full");
+
+    u32 chunk_idx, idx_in_chunk;
+    interner_locate_entry(id, &chunk_idx, &idx_in_chunk);
+    Interned_Entry* chunk = chunks[chunk_idx].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = allocator->allocate<Interned_Entry>(32llu << chunk_idx);
+        chunks[chunk_idx].store(chunk, std::memory_order_release);
+    }
+
+    char* bytes = string_arena.base.allocate<char>(length+1);
+    memcpy(bytes, str, length);
+    bytes[length] = '\0';
+
+    Interned_Entry* entry = &chunk[idx_in_chunk];
+    entry->hash   = hash_bytes(str, length);
+    entry->string = String{bytes, length};
+    entry->id     = id;
+
+    count.store(id+1, std::memory_order_release);
+
+    Interner_Table* t = table.load(std::memory_order_relaxed);
+    if ((u64)(id+1) * 2 > t->capacity) {
+        // NOTE(Felix): readers might still be probing the old table, so it is
+        //   only retired here and freed in deinit
+        Interner_Table* grown = interner_allocate_table(t->capacity * 2, allocator);
+        grown->prev_table = t;
+        for (Interned_Id i = 0; i <= id; ++i) {
+            u32 c, idx;
+            interner_locate_entry(i, &c, &idx);
+            interner_table_insert(grown, &chunks[c].load(std::memory_order_relaxed)[idx]);
+        }
+        table.store(grown, std::memory_order_release);
+    } else {
+        interner_table_insert(t, entry);
+    }
+
+    return id;
+}
+
+auto String_Interner::intern(const char* str) -> Interned_Id {
+    return intern(str, strlen(str));
+}
+
+auto String_Interner::get_string(Interned_Id id) -> String {
+    if (id >= count.load(std::memory_order_acquire))
+        return {};
+
+    u32 chunk_idx, idx_in_chunk;
+    interner_locate_entry(id, &chunk_idx, &idx_in_chunk);
+    return chunks[chunk_idx].load(std::memory_order_acquire)[idx_in_chunk].string;
+}
+
+
+
+// ----------------------------------------------------------------------------
+//                              number formatting
+// ----------------------------------------------------------------------------
+const char two_digit_lut[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+u32 decimal_length(u64 value) {
+    u32 length = 1;
+    while (value >= 10000) {
+        value  /= 10000;
+        length += 4;
+    }
+    if (value >= 1000) return length + 3;
+    if (value >= 100)  return length + 2;
+    if (value >= 10)   return length + 1;
+    return length;
+}
+
+// NOTE(Felix): writes exactly `length` digits of `value`, back to front, two
+//   at a time
+void write_decimal_digits(u64 value, char* out, u32 length) {
+    char* cursor = out + length;
+    while (value >= 100) {
+        u32 two_digits = (u32)(value % 100);
+        value /= 100;
+        cursor -= 2;
+        memcpy(cursor, two_digit_lut + 2*two_digits, 2);
+    }
+    if (value >= 10) {
+        cursor -= 2;
+        memcpy(cursor, two_digit_lut + 2*value, 2);
+    } else {
+        *(--cursor) = (char)('0' + value);
+    }
+}
+
+auto format_u64(u64 value, char* out) -> u32 {
+    u32 length = decimal_length(value);
+    write_decimal_digits(value, out, length);
+    return length;
+}
+
+auto format_s64(s64 value, char* out) -> u32 {
+    if (value < 0) {
+        *out = '-';
+        return 1 + format_u64(0 - (u64)value, out+1);
+    }
+    return format_u64((u64)value, out);
+}
+
+// NOTE(Felix): Ryu (Ulf Adams, 2018) for f32: finds the shortest decimal in
+//   the rounding interval of the float using two small tables of (inverse)
+//   powers of five.
+const s32 ryu_f32_pow5_inv_bitcount = 59;
+const s32 ryu_f32_pow5_bitcount     = 61;
+
+const u64 ryu_f32_pow5_inv_split[31] = {
+    576460752303423489llu, 461168601842738791llu, 368934881474191033llu,
+    295147905179352826llu, 472236648286964522llu, 377789318629571618llu,
+    302231454903657294llu, 483570327845851670llu, 386856262276681336llu,
+    309485009821345069llu, 495176015714152110llu, 396140812571321688llu,
+    316912650057057351llu, 507060240091291761llu, 405648192073033409llu,
+    324518553658426727llu, 519229685853482763llu, 415383748682786211llu,
+    332306998946228969llu, 531691198313966350llu, 425352958651173080llu,
+    340282366920938464llu, 544451787073501542llu, 435561429658801234llu,
+    348449143727040987llu, 557518629963265579llu, 446014903970612463llu,
+    356811923176489971llu, 570899077082383953llu, 456719261665907162llu,
+    365375409332725730llu,
+};
+
+const u64 ryu_f32_pow5_split[47] = {
+    1152921504606846976llu, 1441151880758558720llu, 1801439850948198400llu,
+    2251799813685248000llu, 1407374883553280000llu, 1759218604441600000llu,
+    2199023255552000000llu, 1374389534720000000llu, 1717986918400000000llu,
+    2147483648000000000llu, 1342177280000000000llu, 1677721600000000000llu,
+    2097152000000000000llu, 1310720000000000000llu, 1638400000000000000llu,
+    2048000000000000000llu, 1280000000000000000llu, 1600000000000000000llu,
+    2000000000000000000llu, 1250000000000000000llu, 1562500000000000000llu,
+    1953125000000000000llu, 1220703125000000000llu, 1525878906250000000llu,
+    1907348632812500000llu, 1192092895507812500llu, 1490116119384765625llu,
+    1862645149230957031llu, 1164153218269348144llu, 1455191522836685180llu,
+    1818989403545856475llu, 2273736754432320594llu, 1421085471520200371llu,
+    1776356839400250464llu, 2220446049250313080llu, 1387778780781445675llu,
+    1734723475976807094llu, 2168404344971008868llu, 1355252715606880542llu,
+    1694065894508600678llu, 2117582368135750847llu, 1323488980084844279llu,
+    1654361225106055349llu, 2067951531382569187llu, 1292469707114105741llu,
+    1615587133892632177llu, 2019483917365790221llu,
+};
+
+inline s32 ryu_pow5_bits(s32 e) {
+    return (s32)(((u32)e * 1217359) >> 19) + 1;
+}
+
+inline u32 ryu_log10_pow2(s32 e) {
+    return ((u32)e * 78913) >> 18;
+}
+
+inline u32 ryu_log10_pow5(s32 e) {
+    return ((u32)e * 732923) >> 20;
+}
+
+inline u32 ryu_pow5_factor(u32 value) {
+    u32 count = 0;
+    while (value % 5 == 0) {
+        value /= 5;
+        ++count;
+    }
+    return count;
+}
+
+inline bool ryu_multiple_of_power_of_5(u32 value, u32 p) {
+    return ryu_pow5_factor(value) >= p;
+}
+
+inline bool ryu_multiple_of_power_of_2(u32 value, u32 p) {
+    return (value & ((1u << p) - 1)) == 0;
+}
+
+inline u32 ryu_mul_shift(u32 m, u64 factor, s32 shift) {
+    u64 bits_0 = (u64)m * (u32)factor;
+    u64 bits_1 = (u64)m * (u32)(factor >> 32);
+    u64 sum    = (bits_0 >> 32) + bits_1;
+    return (u32)(sum >> (shift - 32));
+}
+
+// NOTE(Felix): returns the shortest digits and sets their decimal exponent,
+//   `bits` must be a finite, non zero float without sign
+u32 ryu_f32_shortest(u32 bits, s32* out_exponent) {
+    const u32 mantissa_bits = 23;
+    const s32 bias          = 127;
+
+    u32 ieee_mantissa = bits & ((1u << mantissa_bits) - 1);
+    u32 ieee_exponent = bits >> mantissa_bits;
+
+    s32 e2;
+    u32 m2;
+    if (ieee_exponent == 0) {
+        e2 = 1 - bias - (s32)mantissa_bits - 2;
+        m2 = ieee_mantissa;
+    } else {
+        e2 = (s32)ieee_exponent - bias - (s32)mantissa_bits - 2;
+        m2 = (1u << mantissa_bits) | ieee_mantissa;
+    }
+    bool accept_bounds = (m2 & 1) == 0;
+
+    // NOTE(Felix): the float and the boundaries of its rounding interval
+    u32 mv       = 4 * m2;
+    u32 mp       = 4 * m2 + 2;
+    u32 mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+    u32 mm       = 4 * m2 - 1 - mm_shift;
+
+    u32 vr, vp, vm;
+    s32 e10;
+    bool vm_is_trailing_zeros  = false;
+    bool vr_is_trailing_zeros  = false;
+    u8   last_removed_digit    = 0;
+
+    if (e2 >= 0) {
+        u32 q = ryu_log10_pow2(e2);
+        e10   = (s32)q;
+        s32 k = ryu_f32_pow5_inv_bitcount + ryu_pow5_bits((s32)q) - 1;
+        s32 i = -e2 + (s32)q + k;
+        vr = ryu_mul_shift(mv, ryu_f32_pow5_inv_split[q], i);
+        vp = ryu_mul_shift(mp, ryu_f32_pow5_inv_split[q], i);
+        vm = ryu_mul_shift(mm, ryu_f32_pow5_inv_split[q], i);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            s32 l = ryu_f32_pow5_inv_bitcount + ryu_pow5_bits((s32)(q - 1)) - 1;
+            last_removed_digit = (u8)(ryu_mul_shift(mv, ryu_f32_pow5_inv_split[q - 1], -e2 + (s32)q - 1 + l) % 10);
+        }
+        if (q <= 9) {
+            if (mv % 5 == 0)
+                vr_is_trailing_zeros = ryu_multiple_of_power_of_5(mv, q);
+            else if (accept_bounds)
+                vm_is_trailing_zeros = ryu_multiple_of_power_of_5(mm, q);
+            else
+                vp -= ryu_multiple_of_power_of_5(mp, q);
+        }
+    } else {
+        u32 q = ryu_log10_pow5(-e2);
+        e10   = (s32)q + e2;
+        s32 i = -e2 - (s32)q;
+        s32 k = ryu_pow5_bits(i) - ryu_f32_pow5_bitcount;
+        s32 j = (s32)q - k;
+        vr = ryu_mul_shift(mv, ryu_f32_pow5_split[i], j);
+        vp = ryu_mul_shift(mp, ryu_f32_pow5_split[i], j);
+        vm = ryu_mul_shift(mm, ryu_f32_pow5_split[i], j);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            j = (s32)q - 1 - (ryu_pow5_bits(i + 1) - ryu_f32_pow5_bitcount);
+            last_removed_digit = (u8)(ryu_mul_shift(mv, ryu_f32_pow5_split[i + 1], j) % 10);
+        }
+        if (q <= 1) {
+            vr_is_trailing_zeros = true;
+            if (accept_bounds)
+                vm_is_trailing_zeros = mm_shift == 1;
+            else
+                --vp;
+        } else if (q < 31) {
+            vr_is_trailing_zeros = ryu_multiple_of_power_of_2(mv, q - 1);
+        }
+    }
+
+    // NOTE(Felix): remove digits as long as the interval allows it
+    s32 removed = 0;
+    u32 output;
+    if (vm_is_trailing_zeros || vr_is_trailing_zeros) {
+        while (vp / 10 > vm / 10) {
+            vm_is_trailing_zeros &= vm % 10 == 0;
+            vr_is_trailing_zeros &= last_removed_digit == 0;
+            last_removed_digit = (u8)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+        if (vm_is_trailing_zeros) {
+            while (vm % 10 == 0) {
+                vr_is_trailing_zeros &= last_removed_digit == 0;
+                last_removed_digit = (u8)(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                ++removed;
+            }
+        }
+        if (vr_is_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0) {
+            // NOTE(Felix): exactly halfway, round to even
+            last_removed_digit = 4;
+        }
+        output = vr + ((vr == vm && (!accept_bounds || !vm_is_trailing_zeros)) || last_removed_digit >= 5);
+    } else {
+        while (vp / 10 > vm / 10) {
+            last_removed_digit = (u8)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+        output = vr + (vr == vm || last_removed_digit >= 5);
+    }
+
+    *out_exponent = e10 + removed;
+    return output;
+}
+
+auto format_f32(f32 value, char* out) -> u32 {
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    char* cursor = out;
+    if (bits >> 31)
+        *cursor++ = '-';
+    bits &= 0x7fffffff;
+
+    if (bits >= 0x7f800000) {
+        if (bits == 0x7f800000) {
+            memcpy(cursor, "inf", 3);
+        } else {
+            // NOTE(Felix): no sign for nan
+            cursor = out;
+            memcpy(cursor, "nan", 3);
+        }
+        return (u32)(cursor - out) + 3;
+    }
+
+    if (bits == 0) {
+        *cursor++ = '0';
+        return (u32)(cursor - out);
+    }
+
+    s32 exponent;
+    u32 digits = ryu_f32_shortest(bits, &exponent);
+    s32 length = (s32)decimal_length(digits);
+
+    // NOTE(Felix): position of the decimal point relative to the first digit,
+    //   value = 0.<digits> * 10^point. Plain notation for "reasonable" numbers,
+    //   scientific otherwise (like JavaScript does it)
+    s32 point = length + exponent;
+    if (exponent >= 0 && point <= 21) {
+        write_decimal_digits(digits, cursor, length);
+        cursor += length;
+        memset(cursor, '0', exponent);
+        cursor += exponent;
+    } else if (point > 0 && point <= 21) {
+        write_decimal_digits(digits, cursor + 1, length);
+        memmove(cursor, cursor + 1, point);
+        cursor[point] = '.';
+        cursor += length + 1;
+    } else if (point > -6 && point <= 0) {
+        cursor[0] = '0';
+        cursor[1] = '.';
+        memset(cursor + 2, '0', -point);
+        cursor += 2 - point;
+        write_decimal_digits(digits, cursor, length);
+        cursor += length;
+    } else {
+        write_decimal_digits(digits, cursor + 1, length);
+        cursor[0] = cursor[1];
+        if (length > 1) {
+            cursor[1] = '.';
+            cursor += length + 1;
+        } else {
+            cursor += 1;
+        }
+        *cursor++ = 'e';
+        s32 scientific_exponent = point - 1;
+        if (scientific_exponent < 0) {
+            *cursor++ = '-';
+            scientific_exponent = -scientific_exponent;
+        }
+        cursor += format_u64((u64)scientific_exponent, cursor);
+    }
+
+    return (u32)(cursor - out);
+}
+
+
+// ----------------------------------------------------------------------------
+//                              print impl
+// ----------------------------------------------------------------------------
+
+Allocator_Base* print_allocator;
+FILE* ftb_stdout = stdout;
+
+void Print_Sink::init_file(FILE* p_file, char* buffer, u64 buffer_size) {
+#ifdef FTB_PRINT_UNBUFFERED
+    buffer = nullptr;
+#endif
+    *this = {};
+    file      = p_file;
+    data      = buffer;
+    allocated = buffer ? buffer_size : 0;
+}
+
+void Print_Sink::init_string(Allocator_Base* p_allocator, char* p_initial_buffer, u64 initial_buffer_size) {
+    if (!p_allocator)
+        p_allocator = grab_current_allocator();
+
+    *this = {};
+    allocator      = p_allocator;
+    initial_buffer = p_initial_buffer;
+    data           = p_initial_buffer;
+    allocated      = p_initial_buffer ? initial_buffer_size : 0;
+}
+
+void Print_Sink::deinit() {
+    if (data && data != initial_buffer)
+        allocator->deallocate(data);
+    *this = {};
+}
+
+void Print_Sink::reserve(u64 additional) {
+    // NOTE(Felix): always keeps one byte spare for the zero terminator
+    if (count + additional < allocated)
+        return;
+
+    u64 new_allocated = MAX(allocated * 2, 256);
+    while (count + additional >= new_allocated)
+        new_allocated *= 2;
+
+    if (data == initial_buffer) {
+        char* new_data = allocator->allocate<char>(new_allocated);
+        if (count)
+            memcpy(new_data, data, count);
+        data = new_data;
+    } else {
+        data = allocator->resize<char>(data, new_allocated);
+    }
+    allocated = new_allocated;
+}
+
+void Print_Sink::write(const char* bytes, u64 length) {
+    if (file) {
+        if (count + length > allocated) {
+            flush();
+            if (length >= allocated) {
+                fwrite(bytes, 1, length, file);
+                return;
+            }
+        }
+        memcpy(data+count, bytes, length);
+        count += length;
+        return;
+    }
+    reserve(length);
+    memcpy(data+count, bytes, length);
+    count += length;
+}
+
+void Print_Sink::put(char c) {
+    if (file) {
+        if (!data) {
+            putc(c, file);
+            return;
+        }
+        if (count == allocated)
+            flush();
+        data[count++] = c;
+        return;
+    }
+    reserve(1);
+    data[count++] = c;
+}
+
+void Print_Sink::flush() {
+    panic_if(!file, "string sinks can't be flushed");
+    if (count)
+        fwrite(data, 1, count, file);
+    count = 0;
+}
+
+void Print_Sink::rewind_to(u64 position) {
+    panic_if(file, "file sinks can't be rewound");
+    if (position < count)
+        count = position;
+}
+
+auto Print_Sink::finish(Allocator_Base* target) -> String {
+    panic_if(file, "file sinks have no string to hand out");
+    if (!target)
+        target = allocator;
+
+    String result;
+    result.length = count;
+    if (data && data != initial_buffer && target == allocator) {
+        // NOTE(Felix): the buffer can be handed out as is
+        result.data = allocator->resize<char>(data, count+1);
+        data = nullptr;
+    } else {
+        result.data = target->allocate<char>(count+1);
+        if (count)
+            memcpy(result.data, data, count);
+    }
+    result.data[count] = '\0';
+
+    deinit();
+    return result;
+}
+
+// NOTE(Felix): vfprintf for sinks. Tries to format straight into the free
+//   space of a string sink and only grows it if that was too small.
+int sink_vprintf(Print_Sink* sink, const char* format, va_list args) {
+    if (sink->file && !sink->data)
+        return vfprintf(sink->file, format, args);
+
+    va_list args_copy;
+    va_copy(args_copy, args);
+    defer { va_end(args_copy); };
+
+    if (sink->file) {
+        // NOTE(Felix): into the buffer if it fits, otherwise flush and try
+        //   again, and only if that does not fit either write it directly
+        int length = vsnprintf(sink->data + sink->count, sink->allocated - sink->count, format, args);
+        if (length < 0 || (u64)length < sink->allocated - sink->count) {
+            sink->count += MAX(length, 0);
+            return length;
+        }
+        sink->flush();
+        if ((u64)length < sink->allocated) {
+            vsnprintf(sink->data, sink->allocated, format, args_copy);
+            sink->count = length;
+            return length;
+        }
+        return vfprintf(sink->file, format, args_copy);
+    }
+
+    sink->reserve(1);
+    int length = vsnprintf(sink->data + sink->count, sink->allocated - sink->count, format, args);
+    if (length < 0)
+        return length;
+
+    if ((u64)length >= sink->allocated - sink->count) {
+        sink->reserve(length);
+        vsnprintf(sink->data + sink->count, sink->allocated - sink->count, format, args_copy);
+    }
+    sink->count += length;
+    return length;
+}
+
+struct Custom_Printer {
+    printer_function_ptr  fun;
+    Printer_Function_Type type;
+};
+
+// NOTE(Felix): Every thread has its own prefix and color stack, so threads
+//   printing at the same time don't pick up each other's prefixes and colors.
+//   The first entries live in the stack itself, deeper ones on the heap.
+struct Print_Stack {
+    const char** entries;
+    u32          count;
+    u32          allocated;
+    const char*  inline_entries[16];
+
+    void push(const char* entry) {
+        if (!entries) {
+            entries   = inline_entries;
+            allocated = array_length(inline_entries);
+        }
+        if (count == allocated) {
+            allocated *= 2;
+            if (entries == inline_entries) {
+                entries = libc_allocator->allocate<const char*>(allocated);
+                memcpy(entries, inline_entries, sizeof(inline_entries));
+            } else {
+                entries = libc_allocator->resize<const char*>(entries, allocated);
+            }
+        }
+        entries[count++] = entry;
+    }
+
+    void pop() {
+#ifdef FTB_INTERNAL_DEBUG
+        if (count == 0)
+            fprintf(stderr, "ERROR: print stack already empty\n");
+#endif
+        if (count > 0)
+            --count;
+    }
+
+    ~Print_Stack() {
+        if (entries && entries != inline_entries)
+            libc_allocator->deallocate(entries);
+    }
+};
+
+thread_local Print_Stack prefix_stack;
+thread_local Print_Stack color_stack;
+
+// NOTE(Felix): Held while a message goes to a file, so messages from several
+//   threads never interleave, even when one is too long for the sink's
+//   buffer. Custom printers may print themselves, the locks are recursive.
+#ifdef FTB_WINDOWS
+#  define lock_print_file(file)   _lock_file(file)
+#  define unlock_print_file(file) _unlock_file(file)
+#else
+#  define lock_print_file(file)   flockfile(file)
+#  define unlock_print_file(file) funlockfile(file)
+#endif
+
+// NOTE(Felix): The interned id of a printer's spec is its index into
+//   custom_printers, so finding a printer is a single hash lookup.
+String_Interner printer_specs;
+Custom_Printer* custom_printers;
+u32             custom_printers_count;
+u32             custom_printers_allocated;
+// NOTE(Felix): bumped by init_printer, so ids cached by static_print call
+//   sites from an earlier init are not trusted anymore
+std::atomic<u32> printer_generation;
+
+Custom_Printer* find_custom_printer(const char* spec, u64 spec_length) {
+    Interned_Id id = printer_specs.lookup(spec, spec_length);
+    if (id == INTERNED_ID_INVALID)
+        return nullptr;
+    return &custom_printers[id];
 }
 
 void register_printer_ptr(const char* spec, printer_function_ptr fun, Printer_Function_Type type) {
-    if (custom_printers_count == custom_printers_allocated) {
+    // NOTE(Felix): registering a spec a second time replaces the old printer
+    Interned_Id id = printer_specs.intern(spec);
+    while (id >= custom_printers_allocated) {
         custom_printers_allocated *= 2;
         custom_printers = print_allocator->resize<Custom_Printer>(custom_printers, custom_printers_allocated);
     }
-    custom_printers[custom_printers_count] = {
-        .invocation = spec,
-        .fun        = fun,
-        .type       = type
+    custom_printers[id] = {
+        .fun  = fun,
+        .type = type
     };
 
-    ++custom_printers_count;
+    custom_printers_count = MAX(custom_printers_count, id+1);
 }
 
-int maybe_special_print(FILE* file, static_string format, int* pos, va_list* arg_list) {
+int maybe_special_print(Print_Sink* sink, static_string format, int* pos, va_list* arg_list) {
     if(format[*pos] != '{')
         return 0;
 
@@ -3030,16 +5235,12 @@ int maybe_special_print(FILE* file, static_string format, int* pos, va_list* arg
     if (format[end_pos] == 0)
         return 0;
 
-    char* spec = (char*)alloca(end_pos - (*pos));
-    strncpy(spec, format+(*pos)+1, end_pos - (*pos));
-    spec[end_pos - (*pos)-1] = '\0';
-
-    // u64 spec_hash = hm_hash(spec);
-    // Printer_Function_Type type = (Printer_Function_Type)type_map.get_object(spec, spec_hash);
+    const char* spec        = format+(*pos)+1;
+    u32         spec_length = end_pos - (*pos) - 1;
 
-    Custom_Printer* custom_printer = find_custom_printer(spec);
+    Custom_Printer* custom_printer = find_custom_printer(spec, spec_length);
     if (!custom_printer) {
-        fprintf(stderr, "ERROR: %s printer not found\n", spec);
+        fprintf(stderr, "ERROR: %.*s printer not found\n", spec_length, spec);
         return 0;
     }
 
@@ -3055,7 +5256,6 @@ int maybe_special_print(FILE* file, static_string format, int* pos, va_list* arg
 
     // just grab it, it will have the correct type
     printer.printer_ptr = custom_printer->fun;
-    // printer_map.get_object(spec, spec_hash);
 
     // if (type == Printer_Function_Type::unknown) {
     //     printf("ERROR: %s printer not found\n", spec);
@@ -3079,24 +5279,24 @@ int maybe_special_print(FILE* file, static_string format, int* pos, va_list* arg
         // both brackets already included:
         int written_length = 2;
 
-        fputs("[", file);
+        sink->put('[');
         for (int i = 0; i < element_count - 1; ++i) {
-            if      (type == Printer_Function_Type::_32b) written_length += printer.printer_32b(file, va_arg(*arg_list, u32));
-            else if (type == Printer_Function_Type::_64b) written_length += printer.printer_64b(file, va_arg(*arg_list, u64));
-            else if (type == Printer_Function_Type::_flt) written_length += printer.printer_flt(file, va_arg(*arg_list, double));
-            else if (type == Printer_Function_Type::_ptr) written_length += printer.printer_ptr(file, va_arg(*arg_list, void*));
-            else                                          written_length += printer.printer_void(file);
+            if      (type == Printer_Function_Type::_32b) written_length += printer.printer_32b(sink, va_arg(*arg_list, u32));
+            else if (type == Printer_Function_Type::_64b) written_length += printer.printer_64b(sink, va_arg(*arg_list, u64));
+            else if (type == Printer_Function_Type::_flt) written_length += printer.printer_flt(sink, va_arg(*arg_list, double));
+            else if (type == Printer_Function_Type::_ptr) written_length += printer.printer_ptr(sink, va_arg(*arg_list, void*));
+            else                                          written_length += printer.printer_void(sink);
             written_length += 2;
-            fputs(", ", file);
+            sink->write(", ", 2);
         }
         if (element_count > 0) {
-            if      (type == Printer_Function_Type::_32b) written_length += printer.printer_32b(file, va_arg(*arg_list, u32));
-            else if (type == Printer_Function_Type::_64b) written_length += printer.printer_64b(file, va_arg(*arg_list, u64));
-            else if (type == Printer_Function_Type::_flt) written_length += printer.printer_flt(file, va_arg(*arg_list, double));
-            else if (type == Printer_Function_Type::_ptr) written_length += printer.printer_ptr(file, va_arg(*arg_list, void*));
-            else                                          written_length += printer.printer_void(file);
+            if      (type == Printer_Function_Type::_32b) written_length += printer.printer_32b(sink, va_arg(*arg_list, u32));
+            else if (type == Printer_Function_Type::_64b) written_length += printer.printer_64b(sink, va_arg(*arg_list, u64));
+            else if (type == Printer_Function_Type::_flt) written_length += printer.printer_flt(sink, va_arg(*arg_list, double));
+            else if (type == Printer_Function_Type::_ptr) written_length += printer.printer_ptr(sink, va_arg(*arg_list, void*));
+            else                                          written_length += printer.printer_void(sink);
         }
-        fputs("]", file);
+        sink->put(']');
 
         *pos = end_pos;
         return written_length;
@@ -3139,40 +5339,40 @@ int maybe_special_print(FILE* file, static_string format, int* pos, va_list* arg
         // both brackets already included:
         int written_length = 2;
 
-        fputs("[", file);
+        sink->put('[');
         for (u32 i = 0; i < element_count - 1; ++i) {
-            if      (type == Printer_Function_Type::_32b) written_length += printer.printer_32b(file, arr.arr_32b[i]);
-            else if (type == Printer_Function_Type::_64b) written_length += printer.printer_64b(file, arr.arr_64b[i]);
-            else if (type == Printer_Function_Type::_flt) written_length += printer.printer_flt(file, arr.arr_flt[i]);
-            else if (type == Printer_Function_Type::_ptr) written_length += printer.printer_ptr(file, arr.arr_ptr[i]);
-            else                                          written_length += printer.printer_void(file);
+            if      (type == Printer_Function_Type::_32b) written_length += printer.printer_32b(sink, arr.arr_32b[i]);
+            else if (type == Printer_Function_Type::_64b) written_length += printer.printer_64b(sink, arr.arr_64b[i]);
+            else if (type == Printer_Function_Type::_flt) written_length += printer.printer_flt(sink, arr.arr_flt[i]);
+            else if (type == Printer_Function_Type::_ptr) written_length += printer.printer_ptr(sink, arr.arr_ptr[i]);
+            else                                          written_length += printer.printer_void(sink);
             written_length += 2;
-            fputs(", ", file);
+            sink->write(", ", 2);
         }
         if (element_count > 0) {
-            if      (type == Printer_Function_Type::_32b) written_length += printer.printer_32b(file, arr.arr_32b[element_count - 1]);
-            else if (type == Printer_Function_Type::_64b) written_length += printer.printer_64b(file, arr.arr_64b[element_count - 1]);
-            else if (type == Printer_Function_Type::_flt) written_length += printer.printer_flt(file, arr.arr_flt[element_count - 1]);
-            else if (type == Printer_Function_Type::_ptr) written_length += printer.printer_ptr(file, arr.arr_ptr[element_count - 1]);
-            else                                          written_length += printer.printer_void(file);
+            if      (type == Printer_Function_Type::_32b) written_length += printer.printer_32b(sink, arr.arr_32b[element_count - 1]);
+            else if (type == Printer_Function_Type::_64b) written_length += printer.printer_64b(sink, arr.arr_64b[element_count - 1]);
+            else if (type == Printer_Function_Type::_flt) written_length += printer.printer_flt(sink, arr.arr_flt[element_count - 1]);
+            else if (type == Printer_Function_Type::_ptr) written_length += printer.printer_ptr(sink, arr.arr_ptr[element_count - 1]);
+            else                                          written_length += printer.printer_void(sink);
         }
-        fputs("]", file);
+        sink->put(']');
 
         *pos = end_pos;
         return written_length;
     } else {
         *pos = end_pos;
-        if      (type == Printer_Function_Type::_32b) return printer.printer_32b(file, va_arg(*arg_list, u32));
-        else if (type == Printer_Function_Type::_64b) return printer.printer_64b(file, va_arg(*arg_list, u64));
-        else if (type == Printer_Function_Type::_flt) return printer.printer_flt(file, va_arg(*arg_list, double));
-        else if (type == Printer_Function_Type::_ptr) return printer.printer_ptr(file, va_arg(*arg_list, void*));
-        else                                          return printer.printer_void(file);
+        if      (type == Printer_Function_Type::_32b) return printer.printer_32b(sink, va_arg(*arg_list, u32));
+        else if (type == Printer_Function_Type::_64b) return printer.printer_64b(sink, va_arg(*arg_list, u64));
+        else if (type == Printer_Function_Type::_flt) return printer.printer_flt(sink, va_arg(*arg_list, double));
+        else if (type == Printer_Function_Type::_ptr) return printer.printer_ptr(sink, va_arg(*arg_list, void*));
+        else                                          return printer.printer_void(sink);
     }
     return 0;
 
 }
 
-int maybe_fprintf(FILE* file, static_string format, int* pos, va_list* arg_list) {
+int maybe_fprintf(Print_Sink* sink, static_string format, int* pos, va_list* arg_list) {
     // %[flags][width][.precision][length]specifier
     // flags     ::= [+- #0]
     // width     ::= [<number>+ \*]
@@ -3251,7 +5451,7 @@ int maybe_fprintf(FILE* file, static_string format, int* pos, va_list* arg_list)
         temp[written_len] = 0;
 
 
-        written_len = vfprintf(file, temp, arg_list_copy);
+        written_len = sink_vprintf(sink, temp, arg_list_copy);
 
         // TODO(Felix): todo overstep the correct ones by type
         if (format[end_pos] == 'f' || format[end_pos] == 'g' || format[end_pos] == 'G' ||
@@ -3269,33 +5469,58 @@ int maybe_fprintf(FILE* file, static_string format, int* pos, va_list* arg_list)
 }
 
 
-int print_va_args_to_file(FILE* file, static_string format, va_list* arg_list) {
+int print_va_args_to_sink(Print_Sink* sink, static_string format, va_list* arg_list) {
     int printed_chars = 0;
 
-    char c;
-    int pos = -1;
-    while ((c = format[++pos])) {
-        if (c != '%') {
-            putc(c, file);
+    int pos = 0;
+    while (format[pos]) {
+        if (format[pos] != '%') {
+#ifdef FTB_PRINT_UNBUFFERED
+            sink->put(format[pos++]);
             ++printed_chars;
-        } else {
-            c = format[++pos];
-            int move = maybe_special_print(file, format, &pos, arg_list);
-            if (move == 0) {
-                move = maybe_fprintf(file, format, &pos, arg_list);
-                if (move == -1) {
-                    fputc('%', file);
-                    fputc(c, file);
-                    move = 1;
-                }
+            continue;
+#endif
+            // NOTE(Felix): everything up to the next '%' in one write
+            const char* run     = format + pos;
+            const char* percent = strchr(run, '%');
+            int length = percent ? (int)(percent - run) : (int)strlen(run);
+            sink->write(run, length);
+            printed_chars += length;
+            pos += length;
+            continue;
+        }
+
+        char c = format[++pos];
+        if (!c)
+            break;
+
+        int move = maybe_special_print(sink, format, &pos, arg_list);
+        if (move == 0) {
+            move = maybe_fprintf(sink, format, &pos, arg_list);
+            if (move == -1) {
+                sink->put('%');
+                sink->put(c);
+                move = 1;
             }
-            printed_chars += move;
         }
+        printed_chars += move;
+        ++pos;
     }
 
     return printed_chars;
 }
 
+int print_va_args_to_file(FILE* file, static_string format, va_list* arg_list) {
+    char buffer[1024];
+    Print_Sink sink;
+    sink.init_file(file, buffer, sizeof(buffer));
+    lock_print_file(file);
+    defer { unlock_print_file(file); };
+    int printed_chars = print_va_args_to_sink(&sink, format, arg_list);
+    sink.flush();
+    return printed_chars;
+}
+
 int print_va_args(static_string format, va_list* arg_list) {
     return print_va_args_to_file(stdout, format, arg_list);
 }
@@ -3304,20 +5529,12 @@ int print_va_args_to_string(String* out, Allocator_Base* allocator, static_strin
     if (!allocator)
         allocator = grab_current_allocator();
 
-    FILE* t_file = tmpfile();
-    if (!t_file) {
-        return 0;
-    }
-
-    int num_printed_chars = print_va_args_to_file(t_file, format, arg_list);
-
-    out->data = allocator->allocate<char>(num_printed_chars+1);
+    char stack_buffer[1024];
+    Print_Sink sink;
+    sink.init_string(allocator, stack_buffer, sizeof(stack_buffer));
 
-    rewind(t_file);
-    fread(out->data, sizeof(char), num_printed_chars, t_file);
-    out->data[num_printed_chars] = '\0';
-
-    fclose(t_file);
+    int num_printed_chars = print_va_args_to_sink(&sink, format, arg_list);
+    *out = sink.finish();
 
     return num_printed_chars;
 }
@@ -3354,8 +5571,11 @@ int print_to_string(char** out, Allocator_Base* allocator, static_string format,
     va_list arg_list;
     va_start(arg_list, format);
 
-    int num_printed_chars = print_to_string(&str, allocator, format, &arg_list);
+    int num_printed_chars = print_va_args_to_string(&str, allocator, format, &arg_list);
     *out = str.data;
+
+    va_end(arg_list);
+
     return num_printed_chars;
 }
 
@@ -3370,23 +5590,29 @@ int print_to_file(FILE* file, static_string format, ...) {
     return num_printed_chars;
 }
 
+int print_to_sink(Print_Sink* sink, static_string format, ...) {
+    va_list arg_list;
+    va_start(arg_list, format);
+
+    int num_printed_chars = print_va_args_to_sink(sink, format, &arg_list);
+
+    va_end(arg_list);
+
+    return num_printed_chars;
+}
+
 
-int print_spaces(FILE* f, s32 num) {
+int print_spaces(Print_Sink* f, s32 num) {
     int sum = 0;
 
     while (num >= 8) {
-        // println("%d", 8);
-        sum += print_to_file(f, "        ");
+        f->write("        ", 8);
+        sum += 8;
         num -= 8;
     }
-    while (num >= 4) {
-        // println("%d", 4);
-        sum += print_to_file(f, "    ");
-        num -= 4;
-    }
     while (num >= 1) {
-        // println("%d", 1);
-        sum += print_to_file(f, " ");
+        f->put(' ');
+        ++sum;
         num--;
     }
     return sum;
@@ -3410,8 +5636,16 @@ int raw_println(static_string format, ...) {
 
     int num_printed_chars = 0;
 
-    num_printed_chars += print_va_args_to_file(ftb_stdout, format, &arg_list);
-    num_printed_chars += raw_print("\n");
+    char buffer[1024];
+    Print_Sink sink;
+    sink.init_file(ftb_stdout, buffer, sizeof(buffer));
+    lock_print_file(ftb_stdout);
+    defer { unlock_print_file(ftb_stdout); };
+
+    num_printed_chars += print_va_args_to_sink(&sink, format, &arg_list);
+    sink.put('\n');
+    ++num_printed_chars;
+    sink.flush();
     fflush(stdout);
 
     va_end(arg_list);
@@ -3419,11 +5653,11 @@ int raw_println(static_string format, ...) {
     return num_printed_chars;
 }
 
-int print_prefixes(FILE* out_file) {
+int print_prefixes(Print_Sink* sink) {
     int num_printed_chars = 0;
 
-    for (u32 i = 0; i < prefix_stack_count; ++i) {
-        num_printed_chars += print_to_file(out_file, prefix_stack[i]);
+    for (u32 i = 0; i < prefix_stack.count; ++i) {
+        num_printed_chars += print_to_sink(sink, prefix_stack.entries[i]);
     }
 
     return num_printed_chars;
@@ -3435,8 +5669,15 @@ int print(static_string format, ...) {
 
     int num_printed_chars = 0;
 
-    num_printed_chars += print_prefixes(ftb_stdout);
-    num_printed_chars += print_va_args_to_file(ftb_stdout, format, &arg_list);
+    char buffer[1024];
+    Print_Sink sink;
+    sink.init_file(ftb_stdout, buffer, sizeof(buffer));
+    lock_print_file(ftb_stdout);
+    defer { unlock_print_file(ftb_stdout); };
+
+    num_printed_chars += print_prefixes(&sink);
+    num_printed_chars += print_va_args_to_sink(&sink, format, &arg_list);
+    sink.flush();
 
     va_end(arg_list);
 
@@ -3449,9 +5690,17 @@ int println(static_string format, ...) {
 
     int num_printed_chars = 0;
 
-    num_printed_chars += print_prefixes(ftb_stdout);
-    num_printed_chars += print_va_args_to_file(ftb_stdout, format, &arg_list);
-    num_printed_chars += raw_print("\n");
+    char buffer[1024];
+    Print_Sink sink;
+    sink.init_file(ftb_stdout, buffer, sizeof(buffer));
+    lock_print_file(ftb_stdout);
+    defer { unlock_print_file(ftb_stdout); };
+
+    num_printed_chars += print_prefixes(&sink);
+    num_printed_chars += print_va_args_to_sink(&sink, format, &arg_list);
+    sink.put('\n');
+    ++num_printed_chars;
+    sink.flush();
     fflush(stdout);
 
     va_end(arg_list);
@@ -3459,6 +5708,583 @@ int println(static_string format, ...) {
     return num_printed_chars;
 }
 
+int print_log_line(static_string color, static_string label, static_string format, ...) {
+    va_list arg_list;
+    va_start(arg_list, format);
+
+    int num_printed_chars = 0;
+
+    char buffer[1024];
+    Print_Sink sink;
+    sink.init_file(ftb_stdout, buffer, sizeof(buffer));
+    lock_print_file(ftb_stdout);
+    defer { unlock_print_file(ftb_stdout); };
+
+    num_printed_chars += print_prefixes(&sink);
+    num_printed_chars += print_to_sink(&sink, "%{color<}%s", color, label);
+    num_printed_chars += print_va_args_to_sink(&sink, format, &arg_list);
+    num_printed_chars += print_to_sink(&sink, "%{>color}");
+    sink.put('\n');
+    ++num_printed_chars;
+    sink.flush();
+    fflush(stdout);
+
+    va_end(arg_list);
+
+    return num_printed_chars;
+}
+
+int sink_printf(Print_Sink* sink, const char* format, ...) {
+    va_list arg_list;
+    va_start(arg_list, format);
+    defer { va_end(arg_list); };
+    return sink_vprintf(sink, format, arg_list);
+}
+
+// NOTE(Felix): finds the printer of a `%{...}` segment, the first time a call
+//   site uses it, and checks that the arguments fit its type
+Custom_Printer* resolve_format_printer(const char* format, const Format_Segment* segment,
+                                       const Format_Arg* given_args, std::atomic<u64>* cache)
+{
+    u64 generation = printer_generation.load(std::memory_order_relaxed);
+    u64 cached     = cache->load(std::memory_order_relaxed);
+    if ((cached >> 32) == generation && (u32)cached != 0)
+        return &custom_printers[(u32)cached - 1];
+
+    const char* spec = format + segment->start;
+    Interned_Id id = printer_specs.lookup(spec, segment->length);
+    if (id == INTERNED_ID_INVALID) {
+        fprintf(stderr, "ERROR: %.*s printer not found\n", segment->length, spec);
+        return nullptr;
+    }
+
+    Custom_Printer* printer = &custom_printers[id];
+    panic_if(segment->printer_type != Printer_Function_Type::unknown &&
+             segment->printer_type != printer->type,
+             "the %.*s printer was registered with another type than the built in one",
+             segment->length, spec);
+    panic_if(printer->type == Printer_Function_Type::_void && segment->arg_count != 0,
+             "the %.*s printer takes no argument", segment->length, spec);
+
+    if (segment->printer_type == Printer_Function_Type::unknown) {
+        Format_Arg element = format_arg_for_printer(printer->type);
+        for (u32 i = 0; i < segment->arg_count; ++i) {
+            bool is_element = segment->repeat == Format_Repeat::None || segment->repeat == Format_Repeat::Inline;
+            panic_if(is_element && !format_arg_accepts(element, given_args[segment->first_arg + i]),
+                     "argument %u does not fit the %.*s printer",
+                     segment->first_arg + i, segment->length, spec);
+        }
+    }
+
+    cache->store((generation << 32) | (id + 1), std::memory_order_relaxed);
+    return printer;
+}
+
+int call_format_printer(Print_Sink* sink, Custom_Printer* printer, Format_Value value) {
+    switch (printer->type) {
+    case Printer_Function_Type::_32b: return ((printer_function_32b)printer->fun)(sink, (u32)value.integer);
+    case Printer_Function_Type::_64b: return ((printer_function_64b)printer->fun)(sink, (u64)value.integer);
+    case Printer_Function_Type::_flt: return ((printer_function_flt)printer->fun)(sink, value.flt);
+    case Printer_Function_Type::_ptr: return ((printer_function_ptr)printer->fun)(sink, (void*)value.pointer);
+    default:                          return ((printer_function_void)printer->fun)(sink);
+    }
+}
+
+int print_compiled_format(Print_Sink* sink, const char* format, Format_Call_Site call_site, const Format_Value* values) {
+    int printed_chars = 0;
+
+    for (u32 s = 0; s < call_site.segment_count; ++s) {
+        const Format_Segment* segment = &call_site.segments[s];
+        const Format_Value*   args    = values + segment->first_arg;
+
+        switch (segment->type) {
+        case Format_Segment_Type::Literal: {
+            sink->write(format + segment->start, segment->length);
+            printed_chars += segment->length;
+        } break;
+        case Format_Segment_Type::Integer: {
+            char buffer[24];
+            u32 length;
+            if (call_site.expected_args[segment->first_arg] == Format_Arg::Int32)
+                length = segment->is_signed
+                    ? format_s64((s32)args[0].integer, buffer)
+                    : format_u64((u32)args[0].integer, buffer);
+            else
+                length = segment->is_signed
+                    ? format_s64(args[0].integer, buffer)
+                    : format_u64((u64)args[0].integer, buffer);
+            sink->write(buffer, length);
+            printed_chars += length;
+        } break;
+        case Format_Segment_Type::C_String: {
+            const char* str = args[0].pointer ? (const char*)args[0].pointer : "(null)";
+            u64 length = strlen(str);
+            sink->write(str, length);
+            printed_chars += (int)length;
+        } break;
+        case Format_Segment_Type::Printf: {
+            // NOTE(Felix): the last argument is the value, the ones before
+            //   are '*' widths and precisions
+            u32 star_count = segment->arg_count - 1;
+            int star_0 = star_count > 0 ? (int)args[0].integer : 0;
+            int star_1 = star_count > 1 ? (int)args[1].integer : 0;
+            auto print_value = [&](auto value) -> int {
+                if (star_count == 0) return sink_printf(sink, segment->spec, value);
+                if (star_count == 1) return sink_printf(sink, segment->spec, star_0, value);
+                return sink_printf(sink, segment->spec, star_0, star_1, value);
+            };
+
+            Format_Value value = args[star_count];
+            switch (call_site.expected_args[segment->first_arg + star_count]) {
+            case Format_Arg::Int32: printed_chars += print_value((int)value.integer);       break;
+            case Format_Arg::Int64: printed_chars += print_value((long long)value.integer); break;
+            case Format_Arg::Float: printed_chars += print_value(value.flt);                break;
+            default:                printed_chars += print_value(value.pointer);            break;
+            }
+        } break;
+        case Format_Segment_Type::Custom: {
+            Custom_Printer* printer = resolve_format_printer(format, segment, call_site.given_args,
+                                                             &call_site.printer_cache[s]);
+            if (!printer)
+                break;
+
+            if (segment->repeat == Format_Repeat::None) {
+                printed_chars += call_format_printer(sink, printer, args[0]);
+                break;
+            }
+
+            u32 count = segment->repeat == Format_Repeat::Array_Var
+                ? (u32)args[1].integer
+                : segment->element_count;
+
+            // both brackets
+            printed_chars += 2;
+            sink->put('[');
+            for (u32 i = 0; i < count; ++i) {
+                if (i > 0) {
+                    sink->write(", ", 2);
+                    printed_chars += 2;
+                }
+
+                Format_Value element {};
+                if (segment->repeat == Format_Repeat::Inline) {
+                    if (printer->type != Printer_Function_Type::_void)
+                        element = args[i];
+                } else {
+                    switch (printer->type) {
+                    case Printer_Function_Type::_32b: element.integer = ((u32*)args[0].pointer)[i];     break;
+                    case Printer_Function_Type::_64b: element.integer = ((s64*)args[0].pointer)[i];     break;
+                    case Printer_Function_Type::_flt: element.flt     = ((f32*)args[0].pointer)[i];     break;
+                    default:                          element.pointer = ((void**)args[0].pointer)[i];   break;
+                    }
+                }
+                printed_chars += call_format_printer(sink, printer, element);
+            }
+            sink->put(']');
+        } break;
+        }
+    }
+
+    return printed_chars;
+}
+
+auto print_compiled_format(Static_Print_Mode mode, Print_Sink* sink, const char* format,
+                           Format_Call_Site call_site, const Format_Value* values) -> s32
+{
+    if (mode == Static_Print_Mode::To_Sink)
+        return print_compiled_format(sink, format, call_site, values);
+
+    char buffer[1024];
+    Print_Sink file_sink;
+    file_sink.init_file(ftb_stdout, buffer, sizeof(buffer));
+    lock_print_file(ftb_stdout);
+    defer { unlock_print_file(ftb_stdout); };
+
+    int num_printed_chars = 0;
+    num_printed_chars += print_prefixes(&file_sink);
+    num_printed_chars += print_compiled_format(&file_sink, format, call_site, values);
+    if (mode == Static_Print_Mode::Println) {
+        file_sink.put('\n');
+        ++num_printed_chars;
+    }
+    file_sink.flush();
+    if (mode == Static_Print_Mode::Println)
+        fflush(stdout);
+    return num_printed_chars;
+}
+
+enum struct Async_Log_Record_Kind : u32 {
+    Format,
+    Text,    // formatted by the producer
+    Padding, // to the end of the ring buffer
+};
+
+// NOTE(Felix): followed by the copied prefixes (zero terminated, padded to 8
+//   bytes), the argument values and the copied strings (a copied string's
+//   value is its offset from the record). The prefixes are copied since the
+//   strings pushed with with_print_prefix may be gone when the record is
+//   formatted. Records are 8 byte aligned and never wrap around the end of
+//   the buffer.
+struct Async_Log_Record {
+    const Async_Log_Site* site;
+    u32                   size;
+    Async_Log_Record_Kind kind;
+    u32                   prefix_count;
+    u32                   prefix_size;
+    u32                   text_length;
+};
+
+// NOTE(Felix): one producer (the owning thread), one consumer (the log
+//   thread). Buffers are only ever pushed to the front of the list, so the
+//   log thread can unlink any but the first one once its thread is gone.
+struct Async_Log_Buffer {
+    char*             data;
+    u64               capacity; // power of two
+    std::atomic<u64>  head;
+    std::atomic<u64>  tail;
+    std::atomic<bool> abandoned;
+    Async_Log_Buffer* next;
+};
+
+struct Async_Log_State {
+    std::atomic<Async_Log_Buffer*> buffers;
+    std::atomic<bool>              running;
+    std::atomic<bool>              stop;
+    std::atomic<u32>               producers; // threads inside async_log_write
+    std::thread                    thread;
+    FILE*                          file;
+    u32                            buffer_size;
+} async_log_state;
+
+// NOTE(Felix): other thread locals' destructors might still log after this
+//   one ran, those messages are printed right away instead of going to a
+//   buffer the log thread might already have freed.
+struct Async_Log_Thread {
+    Async_Log_Buffer* buffer;
+    bool              gone;
+    ~Async_Log_Thread() {
+        if (buffer)
+            buffer->abandoned.store(true, std::memory_order_release);
+        buffer = nullptr;
+        gone   = true;
+    }
+};
+thread_local Async_Log_Thread async_log_thread;
+
+auto async_log_thread_buffer() -> Async_Log_Buffer* {
+    if (async_log_thread.buffer)
+        return async_log_thread.buffer;
+
+    // NOTE(Felix): freed by the log thread, so it can't come from this
+    //   thread's allocator
+    Async_Log_Buffer* buffer = libc_allocator->allocate_0<Async_Log_Buffer>(1);
+    buffer->capacity = async_log_state.buffer_size;
+    buffer->data     = libc_allocator->allocate<char>(buffer->capacity);
+    buffer->next     = async_log_state.buffers.load(std::memory_order_relaxed);
+    while (!async_log_state.buffers.compare_exchange_weak(buffer->next, buffer,
+                                                          std::memory_order_release,
+                                                          std::memory_order_relaxed));
+    async_log_thread.buffer = buffer;
+    return buffer;
+}
+
+auto async_log_free_buffer(Async_Log_Buffer* buffer) -> void {
+    libc_allocator->deallocate(buffer->data);
+    libc_allocator->deallocate(buffer);
+}
+
+// NOTE(Felix): Formats a record synchronously and writes it with a single
+//   fwrite, for when there is no log thread or the record is too big for
+//   the ring buffer. Goes to the file given to start_async_log, even after
+//   stop_async_log, so no message ends up somewhere else just because it
+//   raced with stopping.
+auto async_log_write_now(const Async_Log_Site* site, const Format_Value* values) -> void {
+    FILE* file = async_log_state.file ? async_log_state.file : ftb_stdout;
+
+    char buffer[512];
+    Print_Sink sink;
+    sink.init_string(libc_allocator, buffer, sizeof(buffer));
+    defer { sink.deinit(); };
+
+    print_prefixes(&sink);
+    print_compiled_format(&sink, site->format, site->call_site, values);
+    fwrite(sink.data, 1, sink.count, file);
+    fflush(file);
+}
+
+// NOTE(Felix): waits for `size` contiguous bytes in the ring buffer. Returns
+//   nullptr if they will never be available.
+auto async_log_reserve(Async_Log_Buffer* buffer, u64 size) -> char* {
+    if (size > buffer->capacity / 2)
+        return nullptr;
+
+    u64 head      = buffer->head.load(std::memory_order_relaxed);
+    u64 offset    = head & (buffer->capacity - 1);
+    u64 remaining = buffer->capacity - offset;
+    u64 needed    = remaining < size ? size + remaining : size;
+
+    while (head + needed - buffer->tail.load(std::memory_order_acquire) > buffer->capacity) {
+        if (!async_log_state.running.load(std::memory_order_relaxed))
+            return nullptr;
+        std::this_thread::yield();
+    }
+
+    if (remaining < size) {
+        if (remaining >= sizeof(Async_Log_Record)) {
+            Async_Log_Record* padding = (Async_Log_Record*)(buffer->data + offset);
+            padding->size = (u32)remaining;
+            padding->kind = Async_Log_Record_Kind::Padding;
+        }
+        // NOTE(Felix): release, so the log thread never sees the new head
+        //   before the padding record
+        buffer->head.store(head + remaining, std::memory_order_release);
+        offset = 0;
+    }
+    return buffer->data + offset;
+}
+
+auto async_log_publish(Async_Log_Buffer* buffer, u64 size) -> void {
+    buffer->head.store(buffer->head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+}
+
+auto async_log_write(const Async_Log_Site* site, const Format_Value* values) -> void {
+    // NOTE(Felix): counted before looking at `running`, so stop_async_log
+    //   can wait for everyone who still saw it set (both sequentially
+    //   consistent, so at least one side sees the other)
+    async_log_state.producers.fetch_add(1);
+    defer { async_log_state.producers.fetch_sub(1, std::memory_order_release); };
+
+    if (!async_log_state.running.load() || async_log_thread.gone) {
+        async_log_write_now(site, values);
+        return;
+    }
+
+    Async_Log_Buffer* buffer = async_log_thread_buffer();
+
+    if (!site->deferrable) {
+        char text_buffer[512];
+        Print_Sink text;
+        text.init_string(libc_allocator, text_buffer, sizeof(text_buffer));
+        defer { text.deinit(); };
+
+        print_prefixes(&text);
+        print_compiled_format(&text, site->format, site->call_site, values);
+
+        u64 size = (sizeof(Async_Log_Record) + text.count + 7) & ~7llu;
+        char* memory = async_log_reserve(buffer, size);
+        if (!memory) {
+            flush_async_log();
+            fwrite(text.data, 1, text.count, async_log_state.file);
+            fflush(async_log_state.file);
+            return;
+        }
+
+        Async_Log_Record* record = (Async_Log_Record*)memory;
+        record->site        = site;
+        record->size        = (u32)size;
+        record->kind        = Async_Log_Record_Kind::Text;
+        record->text_length = (u32)text.count;
+        memcpy(record + 1, text.data, text.count);
+        async_log_publish(buffer, size);
+        return;
+    }
+
+    u64 prefix_size = 0;
+    for (u32 i = 0; i < prefix_stack.count; ++i)
+        prefix_size += strlen(prefix_stack.entries[i]) + 1;
+    prefix_size = (prefix_size + 7) & ~7llu;
+
+    u64 string_lengths[64];
+    u64 size = sizeof(Async_Log_Record) + prefix_size +
+        site->arg_count * sizeof(Format_Value);
+    for (u32 i = 0; i < site->arg_count; ++i) {
+        if (!site->copy_string[i] || !values[i].pointer)
+            continue;
+        u64 length = strlen((const char*)values[i].pointer) + 1;
+        if (i < array_length(string_lengths))
+            string_lengths[i] = length;
+        size += length;
+    }
+    size = (size + 7) & ~7llu;
+
+    char* memory = site->arg_count <= array_length(string_lengths)
+        ? async_log_reserve(buffer, size)
+        : nullptr;
+    if (!memory) {
+        // NOTE(Felix): keep the order of this thread's messages
+        flush_async_log();
+        async_log_write_now(site, values);
+        return;
+    }
+
+    Async_Log_Record* record = (Async_Log_Record*)memory;
+    record->site         = site;
+    record->size         = (u32)size;
+    record->kind         = Async_Log_Record_Kind::Format;
+    record->prefix_count = prefix_stack.count;
+    record->prefix_size  = (u32)prefix_size;
+
+    char* cursor = (char*)(record + 1);
+    for (u32 i = 0; i < prefix_stack.count; ++i) {
+        u64 length = strlen(prefix_stack.entries[i]) + 1;
+        memcpy(cursor, prefix_stack.entries[i], length);
+        cursor += length;
+    }
+    cursor = (char*)(record + 1) + prefix_size;
+
+    Format_Value* record_values = (Format_Value*)cursor;
+    memcpy(record_values, values, site->arg_count * sizeof(Format_Value));
+    cursor += site->arg_count * sizeof(Format_Value);
+
+    for (u32 i = 0; i < site->arg_count; ++i) {
+        if (!site->copy_string[i] || !values[i].pointer)
+            continue;
+        memcpy(cursor, values[i].pointer, string_lengths[i]);
+        record_values[i].integer = cursor - memory;
+        cursor += string_lengths[i];
+    }
+
+    async_log_publish(buffer, size);
+}
+
+auto async_log_format_record(Print_Sink* sink, Async_Log_Record* record) -> void {
+    char* cursor = (char*)(record + 1);
+    if (record->kind == Async_Log_Record_Kind::Text) {
+        sink->write(cursor, record->text_length);
+        return;
+    }
+
+    const char* prefix = cursor;
+    for (u32 i = 0; i < record->prefix_count; ++i) {
+        print_to_sink(sink, prefix);
+        prefix += strlen(prefix) + 1;
+    }
+    cursor += record->prefix_size;
+
+    const Async_Log_Site* site = record->site;
+    Format_Value* values = (Format_Value*)cursor;
+    for (u32 i = 0; i < site->arg_count; ++i) {
+        if (site->copy_string[i] && values[i].integer != 0)
+            values[i].pointer = (char*)record + values[i].integer;
+    }
+
+    print_compiled_format(sink, site->format, site->call_site, values);
+}
+
+// NOTE(Felix): formats everything queued in all buffers into `batch` and
+//   writes it. Returns whether there was anything.
+auto async_log_drain(Print_Sink* batch) -> bool {
+    bool any = false;
+
+    Async_Log_Buffer* previous = nullptr;
+    Async_Log_Buffer* buffer   = async_log_state.buffers.load(std::memory_order_acquire);
+    while (buffer) {
+        // NOTE(Felix): read before head, so a gone thread's head is final
+        bool abandoned = buffer->abandoned.load(std::memory_order_acquire);
+        u64  head      = buffer->head.load(std::memory_order_acquire);
+        u64  tail      = buffer->tail.load(std::memory_order_relaxed);
+
+        while (tail != head) {
+            u64 offset    = tail & (buffer->capacity - 1);
+            u64 remaining = buffer->capacity - offset;
+            if (remaining < sizeof(Async_Log_Record)) {
+                tail += remaining;
+                continue;
+            }
+
+            Async_Log_Record* record = (Async_Log_Record*)(buffer->data + offset);
+            if (record->kind != Async_Log_Record_Kind::Padding) {
+                async_log_format_record(batch, record);
+                any = true;
+            }
+            tail += record->size;
+        }
+        buffer->tail.store(tail, std::memory_order_release);
+
+        Async_Log_Buffer* next = buffer->next;
+        if (abandoned && previous) {
+            previous->next = next;
+            async_log_free_buffer(buffer);
+        } else {
+            previous = buffer;
+        }
+        buffer = next;
+    }
+
+    if (batch->count) {
+        fwrite(batch->data, 1, batch->count, async_log_state.file);
+        fflush(async_log_state.file);
+        batch->rewind_to(0);
+    }
+    return any;
+}
+
+auto async_log_worker() -> void {
+    Print_Sink batch;
+    batch.init_string(libc_allocator);
+    defer { batch.deinit(); };
+
+    while (true) {
+        bool stopping = async_log_state.stop.load(std::memory_order_acquire);
+        if (async_log_drain(&batch))
+            continue;
+        if (stopping)
+            break;
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+}
+
+auto start_async_log(FILE* file, u32 buffer_size) -> void {
+    panic_if(async_log_state.running.load(), "the async log is already running");
+
+    u32 capacity = 1024;
+    while (capacity < buffer_size)
+        capacity *= 2;
+
+    async_log_state.file        = file ? file : ftb_stdout;
+    async_log_state.buffer_size = capacity;
+    async_log_state.stop.store(false);
+    async_log_state.running.store(true, std::memory_order_release);
+    async_log_state.thread = std::thread(async_log_worker);
+}
+
+auto stop_async_log() -> void {
+    if (!async_log_state.running.load())
+        return;
+
+    // NOTE(Felix): from here on new messages are printed right away, the log
+    //   thread writes what is queued and exits
+    async_log_state.running.store(false);
+    async_log_state.stop.store(true, std::memory_order_release);
+    async_log_state.thread.join();
+
+    // NOTE(Felix): for records that were published after the last round of
+    //   the log thread, including the ones of producers that saw `running`
+    //   just before it was cleared and are still writing theirs
+    while (async_log_state.producers.load(std::memory_order_acquire) != 0)
+        std::this_thread::yield();
+
+    Print_Sink batch;
+    batch.init_string(libc_allocator);
+    defer { batch.deinit(); };
+    async_log_drain(&batch);
+}
+
+auto flush_async_log() -> void {
+    // NOTE(Felix): other threads' buffers might be freed by the log thread
+    //   any time, only our own is safe to look at
+    Async_Log_Buffer* buffer = async_log_thread.buffer;
+    if (!buffer)
+        return;
+
+    u64 head = buffer->head.load(std::memory_order_relaxed);
+    while (buffer->tail.load(std::memory_order_acquire) < head &&
+           async_log_state.running.load(std::memory_order_relaxed))
+    {
+        std::this_thread::yield();
+    }
+}
+
 auto print_str_lines(static_string s, u32 max_lines) -> s32 {
     s32 cursor = 0;
     s32 lines = 0;
@@ -3491,111 +6317,127 @@ auto print_str_lines(static_string s, u32 max_lines) -> s32 {
 }
 
 void push_print_prefix(static_string pfx) {
-
-    if (prefix_stack_count == color_stack_allocated) {
-        prefix_stack_allocated *= 2;
-        prefix_stack = print_allocator->resize<const char*>(prefix_stack, prefix_stack_allocated);
-    }
-
-    prefix_stack[prefix_stack_count] = pfx;
-    ++prefix_stack_count;
+    prefix_stack.push(pfx);
 }
 
 void pop_print_prefix() {
-#ifdef FTB_INTERNAL_DEBUG
-    if (prefix_stack_count == 0)
-        fprintf(stderr, "ERROR: prefix_stack_count already 0\n");
-#endif
-
-    --prefix_stack_count;
+    prefix_stack.pop();
 }
 
 int print_indented(u32 indentation, static_string format, ...) {
-    int s = print_spaces(stdout, (s32)indentation);
+    char buffer[1024];
+    Print_Sink sink;
+    sink.init_file(stdout, buffer, sizeof(buffer));
+    lock_print_file(stdout);
+    defer { unlock_print_file(stdout); };
+
+    int s = print_spaces(&sink, (s32)indentation);
     va_list list;
     va_start(list, format);
-    s += print_va_args_to_file(stdout, format, &list);
+    s += print_va_args_to_sink(&sink, format, &list);
     va_end(list);
+    sink.flush();
 
     s += print("\n");
 
     return s;
 }
 
-int print_bool(FILE* f, u32 val) {
-    return print_to_file(f, val ? "true" : "false");
+int print_bool(Print_Sink* f, u32 val) {
+    if (val) {
+        f->write("true", 4);
+        return 4;
+    }
+    f->write("false", 5);
+    return 5;
 }
 
-int print_u32(FILE* f, u32 num) {
-    return print_to_file(f, "%u", num);
+int print_u32(Print_Sink* f, u32 num) {
+    char buffer[24];
+    u32 length = format_u64(num, buffer);
+    f->write(buffer, length);
+    return (int)length;
 }
 
 
-int print_u64(FILE* f, u64 num) {
-    return print_to_file(f, "%llu", num);
+int print_u64(Print_Sink* f, u64 num) {
+    char buffer[24];
+    u32 length = format_u64(num, buffer);
+    f->write(buffer, length);
+    return (int)length;
+}
+
+int print_s32(Print_Sink* f, s32 num) {
+    char buffer[24];
+    u32 length = format_s64(num, buffer);
+    f->write(buffer, length);
+    return (int)length;
 }
 
-int print_s32(FILE* f, s32 num) {
-    return print_to_file(f, "%d", num);
+int print_s64(Print_Sink* f, s64 num) {
+    char buffer[24];
+    u32 length = format_s64(num, buffer);
+    f->write(buffer, length);
+    return (int)length;
 }
 
-int print_s64(FILE* f, s64 num) {
-    return print_to_file(f, "%lld", num);
+int print_flt(Print_Sink* f, double arg) {
+    return print_to_sink(f, "%f", arg);
 }
 
-int print_flt(FILE* f, double arg) {
-    return print_to_file(f, "%f", arg);
+int print_f32(Print_Sink* f, double arg) {
+    char buffer[32];
+    u32 length = format_f32((f32)arg, buffer);
+    f->write(buffer, length);
+    return (int)length;
 }
 
-int print_str(FILE* f, char* str) {
-    return print_to_file(f, "%s", str);
+int print_str(Print_Sink* f, char* str) {
+    u64 length = strlen(str);
+    f->write(str, length);
+    return (int)length;
 }
 
-int print_color_start(FILE* f, void* vp_str) {
+int print_color_start(Print_Sink* f, void* vp_str) {
     char* str = (char*)vp_str;
-    if (color_stack_count == color_stack_allocated) {
-        color_stack_allocated *= 2;
-        color_stack = print_allocator->resize<const char*>(color_stack, color_stack_allocated);
-    }
-    color_stack[color_stack_count] = str;
-    ++color_stack_count;
+    color_stack.push(str);
 
-    return print_to_file(f, "%s", str);
+    u64 length = strlen(str);
+    f->write(str, length);
+    return (int)length;
 }
 
-int print_color_end(FILE* f) {
-#ifdef FTB_INTERNAL_DEBUG
-    if (color_stack_count == 0) {
-        fprintf(stderr, "ERROR: color_stack_count already 0\n");
-    }
-#endif
+int print_color_end(Print_Sink* f) {
+    color_stack.pop();
+    const char* color = color_stack.count == 0
+        ? console_normal
+        : color_stack.entries[color_stack.count-1];
 
-    --color_stack_count;
-    if (color_stack_count == 0) {
-        return print_to_file(f, "%s", console_normal);
-    } else {
-        return print_to_file(f, "%s", color_stack[color_stack_count-1]);
-    }
+    u64 length = strlen(color);
+    f->write(color, length);
+    return (int)length;
 }
 
-int print_ptr(FILE* f, void* ptr) {
+int print_ptr(Print_Sink* f, void* ptr) {
     if (ptr)
-        return print_to_file(f, "%#0*X", sizeof(void*)*2+2, ptr);
-    return print_to_file(f, "nullptr");
+        return print_to_sink(f, "%#0*X", sizeof(void*)*2+2, ptr);
+    return print_to_sink(f, "nullptr");
 }
 
-auto print_Str(FILE* f, String* str) -> s32 {
-    return print_to_file(f, "%.*s", str->length, str->data);
+auto print_Str(Print_Sink* f, String* str) -> s32 {
+    f->write(str->data, str->length);
+    return (s32)str->length;
 }
 
-auto print_str_line(FILE* f, char* str) -> s32 {
+auto print_str_line(Print_Sink* f, char* str) -> s32 {
     u32 length = 0;
     while (str[length] != '\0') {
         if (str[length] == '\n')
             break;
         length++;
     }
-    return print_to_file(f, "%.*s", length, str);
+    f->write(str, length);
+    return (s32)length;
 }
 
 auto hex_dump(void* ptr, s64 count, u32 bytes_per_line) -> void {
@@ -3643,37 +6485,37 @@ auto hex_dump(void* ptr, s64 count, u32 bytes_per_line) -> void {
 }
 
 #ifdef FTB_USING_MATH
-auto print_v2(FILE* f, V2* v2) -> s32 {
-    return print_to_file(f, "{ %f %f }",
+auto print_v2(Print_Sink* f, V2* v2) -> s32 {
+    return print_to_sink(f, "{ %f %f }",
                          v2->x, v2->y);
 }
 
-auto print_v3(FILE* f, V3* v3) -> s32 {
-    return print_to_file(f, "{ %f %f %f }",
+auto print_v3(Print_Sink* f, V3* v3) -> s32 {
+    return print_to_sink(f, "{ %f %f %f }",
                          v3->x, v3->y, v3->z);
 }
 
-auto print_v4(FILE* f, V4* v4) -> s32 {
-    return print_to_file(f, "{ %f %f %f %f }",
+auto print_v4(Print_Sink* f, V4* v4) -> s32 {
+    return print_to_sink(f, "{ %f %f %f %f }",
                          v4->x, v4->y, v4->z, v4->w);
 }
 
-auto print_quat(FILE* f, Quat* quat) -> s32 {
+auto print_quat(Print_Sink* f, Quat* quat) -> s32 {
     return print_v4(f, quat);
 }
 
 // NOTE(Felix): Matrices are in column major, but we print them in row major to
 //   look more normal
-auto print_m2x2(FILE* f, M2x2* m2x2) -> s32 {
-    return print_to_file(f,
+auto print_m2x2(Print_Sink* f, M2x2* m2x2) -> s32 {
+    return print_to_sink(f,
                          "{ %f %f\n"
                          "  %f %f }",
                          m2x2->_00, m2x2->_10,
                          m2x2->_01, m2x2->_11);
 }
 
-auto print_m3x3(FILE* f, M3x3* m3x3) -> s32 {
-    return print_to_file(f,
+auto print_m3x3(Print_Sink* f, M3x3* m3x3) -> s32 {
+    return print_to_sink(f,
                          "{ %f %f %f\n"
                          "  %f %f %f\n"
                          "  %f %f %f }",
@@ -3682,8 +6524,8 @@ auto print_m3x3(FILE* f, M3x3* m3x3) -> s32 {
                          m3x3->_02, m3x3->_12, m3x3->_22);
 }
 
-auto print_m4x4(FILE* f, M4x4* m4x4) -> s32 {
-    return print_to_file(f,
+auto print_m4x4(Print_Sink* f, M4x4* m4x4) -> s32 {
+    return print_to_sink(f,
                          "{ %f %f %f %f \n"
                          "  %f %f %f %f \n"
                          "  %f %f %f %f \n"
@@ -3711,25 +6553,19 @@ void init_printer(Allocator_Base* allocator) {
     dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
     SetConsoleMode(hOut, dwMode);
 #endif
+    printer_specs.init(32, print_allocator);
+    ++printer_generation;
     custom_printers_count     = 0;
     custom_printers_allocated = 32;
     custom_printers           = print_allocator->allocate<Custom_Printer>(custom_printers_allocated);
 
-    color_stack_count     = 0;
-    color_stack_allocated = 16;
-    color_stack           = print_allocator->allocate<const char*>(color_stack_allocated);
-
-    prefix_stack_count     = 0;
-    prefix_stack_allocated = 16;
-    prefix_stack           = print_allocator->allocate<const char*>(prefix_stack_allocated);
-
     register_printer("spaces",      print_spaces,      Printer_Function_Type::_32b);
     register_printer("u32",         print_u32,         Printer_Function_Type::_32b);
     register_printer("u64",         print_u64,         Printer_Function_Type::_64b);
     register_printer("bool",        print_bool,        Printer_Function_Type::_32b);
     register_printer("s64",         print_s64,         Printer_Function_Type::_64b);
     register_printer("s32",         print_s32,         Printer_Function_Type::_32b);
-    register_printer("f32",         print_flt,         Printer_Function_Type::_flt);
+    register_printer("f32",         print_f32,         Printer_Function_Type::_flt);
     register_printer("f64",         print_flt,         Printer_Function_Type::_flt);
     register_printer("->char",      print_str,         Printer_Function_Type::_ptr);
     register_printer("->",          print_ptr,         Printer_Function_Type::_ptr);
@@ -3750,9 +6586,10 @@ void init_printer(Allocator_Base* allocator) {
 }
 
 void deinit_printer() {
-    print_allocator->deallocate(color_stack);
-    print_allocator->deallocate(prefix_stack);
+    // NOTE(Felix): the log thread still needs the printers
+    stop_async_log();
     print_allocator->deallocate(custom_printers);
+    printer_specs.deinit();
 }
 #ifndef FTB_NO_INIT_PRINTER
 namespace {
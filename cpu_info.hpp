@@ -278,6 +278,19 @@ enum struct Ecx_81_Extended_Feature_Flags {
     _resv7        = 1<<31, // (reserved)
 };
 
+// NOTE(Felix): Advanced power management information (0x80000007)
+enum struct Edx_87_Power_Management_Flags {
+    ts            = 1<<0,  // Temperature sensor
+    fid           = 1<<1,  // Frequency ID control
+    vid           = 1<<2,  // Voltage ID control
+    ttp           = 1<<3,  // THERMTRIP
+    tm            = 1<<4,  // Hardware thermal control
+    _resv1        = 1<<5,  // (reserved)
+    mul100        = 1<<6,  // 100 MHz multiplier control
+    hw_pstate     = 1<<7,  // Hardware P-state control
+    invariant_tsc = 1<<8,  // TSC rate is invariant across P-, C- and T-states
+};
+
 struct Cpu_Info {
     char vendor[0x20];
     char brand[0x40];
@@ -292,6 +305,7 @@ struct Cpu_Info {
     int f_7_EDX;
     int f_81_ECX;
     int f_81_EDX;
+    int f_87_EDX;
 };
 
 #ifndef FTB_CPU_INFO_IMPL
@@ -303,6 +317,7 @@ inline auto query_cpu_feature(Cpu_Info* info, Ecx_7_Extended_Feature_Flags flag)
 inline auto query_cpu_feature(Cpu_Info* info, Edx_7_Extended_Feature_Flags flag) -> bool;
 inline auto query_cpu_feature(Cpu_Info* info, Edx_81_Extended_Feature_Flags flag) -> bool;
 inline auto query_cpu_feature(Cpu_Info* info, Ecx_81_Extended_Feature_Flags flag) -> bool;
+inline auto query_cpu_feature(Cpu_Info* info, Edx_87_Power_Management_Flags flag) -> bool;
 auto get_cpu_info(Cpu_Info* info) -> void;
 
 #else // implementations
@@ -335,6 +350,10 @@ inline auto query_cpu_feature(Cpu_Info* info, Ecx_81_Extended_Feature_Flags flag
     return info->f_81_ECX & (int)flag;
 }
 
+inline auto query_cpu_feature(Cpu_Info* info, Edx_87_Power_Management_Flags flag) -> bool {
+    return info->f_87_EDX & (int)flag;
+}
+
 auto get_cpu_info(Cpu_Info* info) -> void {
     *info = {};
 
@@ -399,6 +418,11 @@ auto get_cpu_info(Cpu_Info* info) -> void {
             memcpy(info->brand + 16, register_sets[1], sizeof(register_sets[1]));
             memcpy(info->brand + 32, register_sets[2], sizeof(register_sets[2]));
         }
+
+        if (nExIds_ >= 0x80000007) {
+            platform_independent_cpuid(0x80000007, register_sets[0]);
+            info->f_87_EDX = register_sets[0][3];
+        }
     }
 }
 
@@ -0,0 +1,395 @@
+/*
+ * BSD 2-Clause License
+ *
+ * Copyright (c) 2021, Felix Brendel
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include "core.hpp"
+#include "hashmap.hpp"
+
+// NOTE(Felix): Keeps an index of all files and directories below `root` (path
+//   -> File_Info) up to date and reports what changed since the last poll in
+//   one batch. On Linux the changes come from inotify, so a poll only stats
+//   the paths that were actually touched; a full rescan only happens if the
+//   kernel's event queue overflowed. Without inotify (and on Windows) every
+//   poll rescans the tree and diffs it against the index.
+//
+//   The paths of the events point into the index and stay valid until the
+//   watcher is deinited. Paths of deleted files are kept in the index (with
+//   `exists` set to false), so memory grows with the number of distinct paths
+//   ever seen, not with the number of changes. Directories are not reported
+//   as modified when entries are added to or removed from them; those
+//   entries get events of their own.
+enum struct File_Change : u8 {
+    Created,
+    Modified,
+    Deleted,
+};
+
+struct File_Change_Event {
+    File_Change change;
+    String      path;
+    File_Info   file_info; // as it is now (all zero for Deleted)
+};
+
+typedef void (*file_change_callback)(File_Change_Event* events, u32 count, void* user_data);
+
+struct Watched_File {
+    File_Info info;
+    u32       generation; // last rescan or poll that looked at it
+    s32       watch;      // directories: inotify watch descriptor, -1 if none
+};
+
+struct File_Watcher {
+    Allocator_Base*                allocator;
+    Hash_Map<char*, Watched_File>  index;
+    Array_List<File_Change_Event>  events;
+    Array_List<char*>              pending;       // paths touched since the last poll
+    Array_List<char*>              watched_dirs;  // by watch descriptor
+    char*                          root;
+    bool                           recursive;
+    u32                            generation;
+    s32                            inotify_fd;    // -1 if not available
+
+    void init(const char* root, bool recursive = true, Allocator_Base* allocator = nullptr);
+    void deinit();
+
+    // NOTE(Felix): never blocks; calls `callback` once with all changes since
+    //   the last poll (if there are any) and returns how many there were
+    u32 poll(file_change_callback callback, void* user_data = nullptr);
+
+    Watched_File* lookup(const char* path); // nullptr if never seen
+    u32 file_count(); // existing files and directories in the index
+};
+
+#ifdef FTB_FILE_WATCHER_IMPL
+
+#ifdef FTB_LINUX
+#  include <sys/inotify.h>
+#  include <sys/stat.h>
+#  include <errno.h>
+
+const u32 file_watcher_mask =
+    IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+    IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+#endif
+
+auto file_watcher_get_or_insert(File_Watcher* watcher, const char* path) -> char* {
+    s64 index = watcher->index.get_index_of_living_cell_if_it_exists((char*)path, hm_hash((char*)path));
+    if (index != -1)
+        return watcher->index.data[index].original;
+
+    char* key = heap_copy_c_string(path, watcher->allocator);
+    watcher->index.set_object(key, Watched_File { .watch = -1 });
+    return key;
+}
+
+auto file_watcher_emit(File_Watcher* watcher, File_Change change, char* key, File_Info info) -> void {
+    watcher->events.append({
+        .change    = change,
+        .path      = { key, (u64)strlen(key) },
+        .file_info = info,
+    });
+}
+
+auto file_watcher_add_watch(File_Watcher* watcher, char* key, Watched_File* file) -> void {
+#ifdef FTB_LINUX
+    if (watcher->inotify_fd < 0 || file->watch >= 0)
+        return;
+
+    s32 watch = inotify_add_watch(watcher->inotify_fd, key, file_watcher_mask);
+    if (watch < 0)
+        return;
+
+    file->watch = watch;
+    while (watcher->watched_dirs.count <= (u32)watch)
+        watcher->watched_dirs.append(nullptr);
+    watcher->watched_dirs[watch] = key;
+#endif
+}
+
+auto file_watcher_remove_watch(File_Watcher* watcher, Watched_File* file) -> void {
+#ifdef FTB_LINUX
+    if (file->watch < 0)
+        return;
+    inotify_rm_watch(watcher->inotify_fd, file->watch);
+    watcher->watched_dirs[file->watch] = nullptr;
+    file->watch = -1;
+#endif
+}
+
+// NOTE(Felix): compares `info` (what is on disk now) with the index and
+//   emits the matching event. Files inotify reported as `touched` are
+//   modified even if size and (second granular) mtime did not change. The
+//   size and mtime of directories change with their entries, so they are
+//   only modified when they replaced a file (or the other way around).
+auto file_watcher_update(File_Watcher* watcher, char* key, File_Info info, bool report, bool touched = false) -> void {
+    Watched_File* file = watcher->index.get_object_ptr(key);
+    file->generation = watcher->generation;
+
+    File_Info old = file->info;
+    file->info = info;
+
+    if (info.exists && !old.exists) {
+        if (report)
+            file_watcher_emit(watcher, File_Change::Created, key, info);
+    } else if (!info.exists && old.exists) {
+        file_watcher_remove_watch(watcher, file);
+        if (report)
+            file_watcher_emit(watcher, File_Change::Deleted, key, info);
+    } else if (info.exists &&
+               (info.is_directory != old.is_directory ||
+                (!info.is_directory &&
+                 (touched ||
+                  info.size              != old.size ||
+                  info.modification_time != old.modification_time))))
+    {
+        if (report)
+            file_watcher_emit(watcher, File_Change::Modified, key, info);
+    }
+
+    if (info.exists && info.is_directory && (watcher->recursive || key == watcher->root))
+        file_watcher_add_watch(watcher, key, file);
+}
+
+// NOTE(Felix): walks `dir` and brings the index up to date with it. With
+//   `report` set, every difference becomes an event.
+auto file_watcher_rescan(File_Watcher* watcher, const char* dir, bool report) -> void {
+    struct Params {
+        File_Watcher* watcher;
+        bool          report;
+    } params { watcher, report };
+
+    walk_files(dir, {
+            .recursive        = watcher->recursive,
+            .with_files       = true,
+            .with_directories = true,
+        }, [](Path_Info pi, Walk_Status*, void* user_data) -> void {
+            Params* params = (Params*)user_data;
+            char* key = file_watcher_get_or_insert(params->watcher, pi.full_path.string.data);
+            file_watcher_update(params->watcher, key, pi.file_info, params->report);
+        }, &params);
+}
+
+// NOTE(Felix): everything in the index below `dir` that was not seen in the
+//   current generation is gone
+auto file_watcher_collect_deleted(File_Watcher* watcher, const char* dir) -> void {
+    u64 dir_length = strlen(dir);
+    watcher->index.for_each([&](char* key, Watched_File file, u64) {
+        if (!file.info.exists || file.generation == watcher->generation || key == watcher->root)
+            return;
+        if (strncmp(key, dir, dir_length) != 0 || key[dir_length] != '/')
+            return;
+        file_watcher_update(watcher, key, {}, true);
+    });
+}
+
+auto file_watcher_full_rescan(File_Watcher* watcher, bool report) -> void {
+    ++watcher->generation;
+    file_watcher_rescan(watcher, watcher->root, report);
+    file_watcher_collect_deleted(watcher, watcher->root);
+}
+
+void File_Watcher::init(const char* in_root, bool in_recursive, Allocator_Base* in_allocator) {
+    allocator  = in_allocator ? in_allocator : grab_current_allocator();
+    recursive  = in_recursive;
+    generation = 0;
+    inotify_fd = -1;
+
+    index.init(1024, allocator);
+    events.init(64, allocator);
+    pending.init(64, allocator);
+    watched_dirs.init(64, allocator);
+
+    // NOTE(Felix): event paths are built as dir + '/' + name, so the root
+    //   must not end in a separator
+    Scratch_Arena scratch = scratch_arena_start();
+    defer { scratch_arena_end(scratch); };
+    char* root_path = heap_copy_c_string(in_root, scratch.arena);
+    for (u64 length = strlen(root_path); length > 1 && root_path[length-1] == '/'; --length)
+        root_path[length-1] = '\0';
+
+    root = file_watcher_get_or_insert(this, root_path);
+    index.get_object_ptr(root)->info = file_info(root);
+
+#ifdef FTB_LINUX
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd >= 0)
+        file_watcher_add_watch(this, root, index.get_object_ptr(root));
+#endif
+
+    file_watcher_full_rescan(this, false);
+}
+
+void File_Watcher::deinit() {
+#ifdef FTB_LINUX
+    if (inotify_fd >= 0)
+        close(inotify_fd);
+#endif
+    index.for_each([&](char* key, Watched_File file, u64) {
+        allocator->deallocate(key);
+    });
+    index.deinit();
+    events.deinit();
+    pending.deinit();
+    watched_dirs.deinit();
+    *this = {};
+}
+
+Watched_File* File_Watcher::lookup(const char* path) {
+    return index.get_object_ptr((char*)path);
+}
+
+u32 File_Watcher::file_count() {
+    u32 count = 0;
+    index.for_each([&](char* key, Watched_File file, u64) {
+        count += file.info.exists && key != root;
+    });
+    return count;
+}
+
+u32 File_Watcher::poll(file_change_callback callback, void* user_data) {
+    events.clear();
+    ++generation;
+
+    if (inotify_fd < 0) {
+        file_watcher_full_rescan(this, true);
+    }
+#ifdef FTB_LINUX
+    else {
+        bool overflowed = false;
+        pending.clear();
+
+        Scratch_Arena scratch = scratch_arena_start();
+        defer { scratch_arena_end(scratch); };
+
+        // NOTE(Felix): directories whose watch is gone (deleted or moved
+        //   away). If something is at their path again by the time of the
+        //   poll, it gets a new watch and is rescanned.
+        Array_List<char*> lost_watches;
+        lost_watches.init(8, scratch.arena);
+
+        // NOTE(Felix): the root has no watched parent that would report it
+        //   being created again, so without a watch it is checked every poll
+        Watched_File* root_file = index.get_object_ptr(root);
+        if (root_file->watch < 0) {
+            root_file->generation = generation;
+            pending.append(root);
+            lost_watches.append(root);
+        }
+
+        alignas(inotify_event) char buffer[16 * 1024];
+        while (true) {
+            ssize_t read_bytes = read(inotify_fd, buffer, sizeof(buffer));
+            if (read_bytes <= 0)
+                break;
+
+            for (ssize_t offset = 0; offset < read_bytes;) {
+                inotify_event* event = (inotify_event*)(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    overflowed = true;
+                    continue;
+                }
+                if (event->wd < 0 || (u32)event->wd >= watched_dirs.count || !watched_dirs[event->wd])
+                    continue;
+
+                char* dir = watched_dirs[event->wd];
+                if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    // NOTE(Felix): after IN_IGNORED the kernel already
+                    //   dropped the watch, after the others we drop it
+                    Watched_File* dir_file = index.get_object_ptr(dir);
+                    if (event->mask & IN_IGNORED) {
+                        watched_dirs[event->wd] = nullptr;
+                        dir_file->watch = -1;
+                    } else {
+                        file_watcher_remove_watch(this, dir_file);
+                    }
+                    if (!lost_watches.contains_linear_search(dir))
+                        lost_watches.append(dir);
+                }
+
+                char* path = dir;
+                if (event->len && event->name[0]) {
+                    u64 dir_length  = strlen(dir);
+                    u64 name_length = strlen(event->name);
+                    path = scratch.arena->allocate<char>(dir_length + name_length + 2);
+                    memcpy(path, dir, dir_length);
+                    path[dir_length] = '/';
+                    memcpy(path + dir_length + 1, event->name, name_length + 1);
+                }
+
+                // NOTE(Felix): several events for the same path in one batch
+                //   only need one stat
+                char* key = file_watcher_get_or_insert(this, path);
+                Watched_File* file = index.get_object_ptr(key);
+                if (file->generation != generation) {
+                    file->generation = generation;
+                    pending.append(key);
+                }
+            }
+        }
+
+        if (overflowed) {
+            file_watcher_full_rescan(this, true);
+        } else {
+            for (char* key : pending) {
+                File_Info old  = index.get_object_ptr(key)->info;
+                File_Info info = file_info(key);
+                file_watcher_update(this, key, info, true, true);
+
+                if (!recursive && key != root)
+                    continue;
+
+                if (info.exists && info.is_directory && !old.exists) {
+                    // NOTE(Felix): things might have been created in it
+                    //   before the watch was added
+                    file_watcher_rescan(this, key, true);
+                } else if (!info.exists && old.is_directory) {
+                    // NOTE(Felix): for directories moved away there are no
+                    //   events for their contents
+                    file_watcher_collect_deleted(this, key);
+                } else if (info.exists && info.is_directory &&
+                           lost_watches.contains_linear_search(key))
+                {
+                    // NOTE(Felix): replaced since the last poll, so none of
+                    //   the old contents can be trusted
+                    file_watcher_rescan(this, key, true);
+                    file_watcher_collect_deleted(this, key);
+                }
+            }
+        }
+    }
+#endif
+
+    if (events.count && callback)
+        callback(events.data, events.count, user_data);
+
+    return events.count;
+}
+
+#endif // FTB_FILE_WATCHER_IMPL
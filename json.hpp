@@ -3,6 +3,18 @@
 #include "parsing.hpp"
 #include "hashmap.hpp"
 #include <initializer_list>
+#include <new>
+#include <thread>
+#include <errno.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#  define FTB_JSON_X86
+#  include "cpu_info.hpp"
+#  include <immintrin.h>
+#endif
+#ifdef FTB_WINDOWS
+#  include <io.h> // _read
+#endif
 
 // TODO(Felix):
 //  - pattern for reading into `maybe` types
@@ -59,9 +71,12 @@ namespace json {
         } parent;
     };
 
+    struct Structural_Index;
+
     struct Parser_Context {
         Parser_Context_Stack_Entry  context_stack;
         const char*                 position_in_string;
+        Structural_Index*           structural_index; // nullptr if not available
     };
 
     typedef Pattern_Match_Result (*parser_hook)(void* matched_obj,
@@ -76,20 +91,31 @@ namespace json {
     //   colon of the objet members and then wirte/check the value. If nothing
     //   is to be written, we rewind the writing pointer a bit to overwrite
     //   the key again.
-    typedef u32  (*writer_function)(FILE*           file, void* value_to_write);
+    typedef u32  (*writer_function)(Print_Sink*     sink, void* value_to_write);
     typedef bool (*writer_selection_function)(void* value_to_write);
 
+    // NOTE(Felix): binary counterparts of custom readers and writers (see
+    //   write_pattern_to_binary). A binary reader returns the number of bytes
+    //   it read, or -1 if the data ended too early.
+    typedef u32  (*binary_reader_function)(const u8* position, const u8* end, void* out_read_value);
+    typedef void (*binary_writer_function)(Print_Sink* sink, void* value_to_write);
+
     struct Hooks {
         // NOTE(Felix): custom_reader might be set or nullptr; if set,
         //   value.destination_offset must also be set, as it will be passed
         //   as the destination to the custom reader
-        reader_function           custom_reader;
-        writer_function           custom_writer;
-        writer_selection_function custom_writer_selection; // NOTE(Felix): see note above at writer_selection_function
-
-        void* callback_data;
-        parser_hook enter_hook;
-        parser_hook leave_hook;
+        reader_function           custom_reader           = nullptr;
+        writer_function           custom_writer           = nullptr;
+        writer_selection_function custom_writer_selection = nullptr; // NOTE(Felix): see note above at writer_selection_function
+
+        void* callback_data    = nullptr;
+        parser_hook enter_hook = nullptr;
+        parser_hook leave_hook = nullptr;
+
+        // NOTE(Felix): optional, without them values with custom readers or
+        //   writers are stored as json text in the binary encoding
+        binary_reader_function    custom_binary_reader    = nullptr;
+        binary_writer_function    custom_binary_writer    = nullptr;
     };
 
     struct Key_Mapping {
@@ -109,6 +135,12 @@ namespace json {
                 Object_Member* members;
                 u32 member_count;
                 Fallback_Pattern* fallback_pattern; // pattern used for wildcard matches
+                // NOTE(Felix): open addressing table over the interned key
+                //   ids, holding member index + 1 (0 means empty). Built by
+                //   json::object; if it is nullptr the members are searched
+                //   linearly.
+                u32* member_index;
+                u32  member_index_mask;
             } object;
             struct {
                 u32 hash_map_offset;
@@ -138,6 +170,10 @@ namespace json {
     struct Object_Member {
         const char*  key;
         Pattern      pattern;
+        // NOTE(Felix): set by json::object, matching compares this instead of
+        //   the key string. Members of hand built patterns leave it unset and
+        //   are matched by comparing the key string.
+        Interned_Id  key_id = INTERNED_ID_INVALID;
     };
 
     struct List_Info {
@@ -157,20 +193,251 @@ namespace json {
     Pattern p_f32(u32 offset,  Hooks hooks={0});
     Pattern p_bool(u32 offset, Hooks hooks={0});
     Pattern p_str(u32 offset,  Hooks hooks={0});
+    // NOTE(Felix): Like p_str, but the String points straight into the matched
+    //   input instead of being copied, so the input has to outlive it. Only
+    //   strings with escapes are unescaped into memory from the allocator
+    //   passed to pattern_match; use an arena if you can't tell them apart.
+    Pattern p_str_view(u32 offset, Hooks hooks={0});
     Pattern custom(Json_Type source_type, u32 destination_offset,
                    Hooks hooks={0});
 
 
+    // NOTE(Felix): The structural index is a first pass over the whole input
+    //   that records the offsets of all quotes, braces, brackets, colons and
+    //   commas that are not inside of strings, and for every opening brace,
+    //   bracket and quote the index of its partner. The matcher uses it to
+    //   skip over values it has no pattern for without looking at their
+    //   contents. The scan uses AVX2 or SSE2 when the cpu supports it. If the
+    //   input contains comments, single quoted strings or is unbalanced,
+    //   `valid` is false and the matcher falls back to scanning char by char.
+    //   Offsets are u32, so inputs have to be smaller than 4GB. The matching
+    //   functions build their index with the libc allocator and free it
+    //   before they return, so nothing of it ends up in the allocator they
+    //   match into.
+    struct Structural_Index {
+        const char*     base;
+        const char*     end;
+        u32*            positions;
+        u32*            matching;
+        u32             count;
+        u32             allocated;
+        u32             cursor; // matching only moves forward
+        bool            valid;
+        Allocator_Base* allocator;
+
+        void init(const char* string, u64 length, Allocator_Base* allocator = nullptr);
+        void deinit();
+    };
+
     // Pattern member_value(const char* key, Json_Type source_type, Data_Type destination_type, u32 destination_offset);
     Pattern_Match_Result pattern_match(const char* string, Pattern pattern, void* obj_to_match_into, void* callback_data = nullptr, Allocator_Base* allocator = nullptr);
+    // NOTE(Felix): for input with a known length, like the contents of a
+    //   Mapped_File, which are matched in place; it still has to be followed by a NUL
+    Pattern_Match_Result pattern_match(String string, Pattern pattern, void* obj_to_match_into, void* callback_data = nullptr, Allocator_Base* allocator = nullptr);
+
+    // NOTE(Felix): json::compile flattens a pattern tree into an array of
+    //   steps with precomputed member tables, so matching it does not copy
+    //   Patterns around or branch on their types over and over. Compile once,
+    //   match many times; the result is the same as matching the pattern.
+    //   Subtrees with enter/leave hooks, fallback patterns or hash maps are
+    //   kept as they are and interpreted (with the full parser context).
+    enum struct Plan_Op : u8 {
+        Value,
+        Custom,
+        Object,
+        List,
+        Interpret,
+    };
+
+    struct Plan_Step {
+        Plan_Op   op;
+        Json_Type type;
+        Data_Type destination_type;
+        u32       destination_offset; // List: array list offset
+        u32       element_size;       // List
+        u32       child;              // Object: first member, List: element step
+        u32       member_count;       // Object
+        u32       member_table;       // Object: start in member_tables
+        u32       member_table_mask;  // Object
+        reader_function custom_reader;
+        Pattern*  pattern;            // Interpret
+    };
+
+    struct Plan_Member {
+        Interned_Id key_id;
+        Json_Type   type;
+        u32         step;
+    };
+
+    struct Compiled_Pattern {
+        Plan_Step*      steps;
+        Plan_Member*    members;
+        u32*            member_tables; // member index + 1, 0 is empty
+        Pattern*        interpreted;
+        u32             step_count;
+        u32             member_count;
+        u32             member_table_size;
+        u32             interpreted_count;
+        Allocator_Base* allocator;
+
+        void deinit();
+    };
+
+    Compiled_Pattern compile(Pattern pattern, Allocator_Base* allocator = nullptr);
+    Pattern_Match_Result pattern_match(const char* string, const Compiled_Pattern& plan, void* obj_to_match_into, void* callback_data = nullptr, Allocator_Base* allocator = nullptr);
+
+    // NOTE(Felix): For inputs that are one big list of records, matched by a
+    //   json::list pattern. The record boundaries are found with the
+    //   structural index first, then the records are matched on `thread_count`
+    //   threads (0 means one per core) straight into their slots of the list,
+    //   so the result is the same as with pattern_match. Since the records are
+    //   matched concurrently, `allocator` and custom readers have to be thread
+    //   safe (wrap arenas in a Locking_Allocator). Patterns with enter or leave
+    //   hooks anywhere, small inputs, and inputs the structural index can't
+    //   handle are matched on the calling thread; the index has u32 offsets,
+    //   so that includes all inputs of 4GB and more. On MATCHING_ERROR the strings
+    //   and lists of the records matched so far are freed and the list keeps
+    //   its old count.
+    Pattern_Match_Result pattern_match_parallel(const char* string, Pattern list_pattern, void* obj_to_match_into,
+                                                u32 thread_count = 0, void* callback_data = nullptr,
+                                                Allocator_Base* allocator = nullptr);
+
+    // NOTE(Felix): Streaming: the input is pulled in chunks and split into
+    //   records, which are either newline delimited json objects or the
+    //   elements of a top level list. Records have to be objects or lists: a
+    //   top level list of scalars is rejected, and since an input starting with
+    //   '[' is read as one top level list, so is newline delimited json whose
+    //   records are lists. Every record is matched against
+    //   `record_pattern` into a zeroed buffer of `record_size` bytes as soon as
+    //   it is complete, and then handed to `on_record`. Only the current record
+    //   is kept in memory, so files of any size can be processed. Everything
+    //   allocated while matching a record (strings, lists) belongs to the
+    //   callback. The input buffer is reused, so p_str_view strings are only
+    //   valid inside the callback. Returning OK_DONE from the callback stops the stream,
+    //   MATCHING_ERROR aborts it. If the records are the elements of a top
+    //   level list, the enter and leave hooks of `list_hooks` are called for
+    //   that list (with a nullptr object), like the hooks of the json::list
+    //   pattern the whole input would be matched with. A reader returns
+    //   STREAM_READ_ERROR if reading failed, which aborts the stream.
+    typedef u64 (*stream_reader)(void* reader_data, char* buffer, u64 buffer_size); // 0 means end of input
+    typedef Pattern_Match_Result (*record_callback)(void* record, u64 record_index, void* callback_data);
+    const u64 STREAM_READ_ERROR = (u64)-1;
+
+    Pattern_Match_Result pattern_match_stream(stream_reader reader, void* reader_data,
+                                              Pattern record_pattern, u32 record_size,
+                                              record_callback on_record, void* callback_data = nullptr,
+                                              Allocator_Base* allocator = nullptr, Hooks list_hooks={0});
+    Pattern_Match_Result pattern_match_stream(FILE* file,
+                                              Pattern record_pattern, u32 record_size,
+                                              record_callback on_record, void* callback_data = nullptr,
+                                              Allocator_Base* allocator = nullptr, Hooks list_hooks={0});
+    Pattern_Match_Result pattern_match_stream_fd(int fd,
+                                                 Pattern record_pattern, u32 record_size,
+                                                 record_callback on_record, void* callback_data = nullptr,
+                                                 Allocator_Base* allocator = nullptr, Hooks list_hooks={0});
+
+    void write_pattern_to_sink(Print_Sink* sink, Pattern pattern, void* user_data);
     void write_pattern_to_file(const char* path, Pattern pattern, void* user_data);
     Allocated_String write_pattern_to_string(Pattern pattern, void* user_data, Allocator_Base* allocator = nullptr);
 
+    // NOTE(Felix): Compact binary encoding driven by the same patterns. Since
+    //   both sides know the schema, no keys or type tags are stored: values
+    //   are written in pattern order, integers as zigzag LEB128 varints, f32s
+    //   as their 4 little endian bytes, bools as one byte, strings and lists as
+    //   a varint length followed by the bytes or elements. Objects with
+    //   custom_writer_selection hooks start with a bitmap of the written
+    //   members. Values with custom readers and writers use their binary
+    //   hooks if set, otherwise they are stored as their (length prefixed)
+    //   json text and read back with their custom reader. Parser
+    //   hooks are not called and fallback patterns are ignored, as there are
+    //   no unknown members. p_str_view strings point into `data`. Object_As_Hash_Map
+    //   patterns can't be encoded, matching them returns MATCHING_ERROR.
+    //   pattern_match_binary returns OK_CONTINUE on success, like pattern_match.
+    void write_pattern_to_binary(Print_Sink* sink, Pattern pattern, void* user_data);
+    Allocated_String write_pattern_to_binary(Pattern pattern, void* user_data, Allocator_Base* allocator = nullptr);
+    Pattern_Match_Result pattern_match_binary(const void* data, u64 length, Pattern pattern,
+                                              void* matched_obj, Allocator_Base* allocator = nullptr,
+                                              u64* out_read = nullptr);
+
+    // NOTE(Felix): On demand access for when there is no schema to write a
+    //   Pattern for. A Value is just a position in the input; nothing is
+    //   parsed until it is asked for, and values that are not touched are
+    //   only skipped over. Strings are views into the input unless they have
+    //   escapes. By default the Doc allocates nothing; with
+    //   `build_structural_index` skipping over big subtrees gets faster, at the
+    //   cost of an index proportional to the size of the input. The input has
+    //   to be NUL terminated and outlive the Doc and its Values.
+    struct Doc;
+
+    struct Value {
+        Doc*        doc;
+        const char* position; // nullptr if the value does not exist
+
+        bool      exists();
+        Json_Type type(); // Invalid if the value does not exist
+
+        // objects
+        Value find_field(const char* key);
+        Value find_field(String key);
+
+        // lists
+        Value at(u32 index);
+        Value first_element();
+        Value next_element(); // on an element, the next one in the same list
+        u32   count();        // elements of a list or members of an object
+
+        template <typename lambda>
+        void iterate_array(lambda l) {
+            for (Value element = first_element(); element.exists(); element = element.next_element())
+                l(element);
+        }
+
+        template <typename lambda>
+        void iterate_object(lambda l);
+
+        // NOTE(Felix): return false if the value does not exist or has the
+        //   wrong type, and leave `out` untouched then
+        bool get_f32(f32* out);
+        bool get_s32(s32* out);
+        bool get_s64(s64* out);
+        bool get_bool(bool* out);
+        bool get_string(String* out, Allocator_Base* allocator = nullptr); // see p_str_view
+        String get_raw(); // the json text of the value
+    };
+
+    struct Member {
+        String key; // as written in the input, without the quotes
+        Value  value;
+
+        bool   exists();
+        Member next();
+    };
+
+    struct Doc {
+        const char*      string;
+        const char*      end;
+        Structural_Index structural_index;
+
+        void  init(const char* string, bool build_structural_index = false, Allocator_Base* allocator = nullptr);
+        void  deinit();
+        Value root();
+    };
+
+    Member first_member(Value object);
+
+    template <typename lambda>
+    void Value::iterate_object(lambda l) {
+        for (Member member = first_member(*this); member.exists(); member = member.next())
+            l(member.key, member.value);
+    }
+
     // helper for custom parsers
     Json_Type identify_thing(const char* string);
     u32 eat_whitespace_and_comments(const char* string);
     u32 read_float_array(const char* point, f32* arr, u32 count);
-    u32 write_float_array(FILE* out_file, f32* arr, u32 count);
+    u32 write_float_array(Print_Sink* sink, f32* arr, u32 count);
+    u32 read_float_array_binary(const u8* point, const u8* end, f32* arr, u32 count);
+    void write_float_array_binary(Print_Sink* sink, f32* arr, u32 count);
 
 
     // NOTE(Felix): This can go away once we have dedicated array patterns.
@@ -181,8 +448,14 @@ namespace json {
                 .custom_reader = [](const char* point, void* out_vec3) -> u32 {
                     return read_float_array(point, (f32*)out_vec3, ARRAY_SIZE);
                 },
-                .custom_writer = [](FILE* out_file, void* vec3_to_write) -> u32 {
-                    return write_float_array(out_file, (f32*)vec3_to_write, ARRAY_SIZE);
+                .custom_writer = [](Print_Sink* sink, void* vec3_to_write) -> u32 {
+                    return write_float_array(sink, (f32*)vec3_to_write, ARRAY_SIZE);
+                },
+                .custom_binary_reader = [](const u8* point, const u8* end, void* out_vec3) -> u32 {
+                    return read_float_array_binary(point, end, (f32*)out_vec3, ARRAY_SIZE);
+                },
+                .custom_binary_writer = [](Print_Sink* sink, void* vec3_to_write) -> void {
+                    write_float_array_binary(sink, (f32*)vec3_to_write, ARRAY_SIZE);
                 }
             }
         );
@@ -197,6 +470,17 @@ namespace json {
     const char false_string[] = "false";
     const char null_string[]  = "null";
 
+    // NOTE(Felix): The keys of all object patterns are interned here, so
+    //   matching a member name is a single hash lookup followed by integer
+    //   compares. Patterns usually live for the whole program, and so does
+    //   this.
+    String_Interner* key_interner() {
+        static String_Interner interner;
+        static bool initialized = (interner.init(64, libc_allocator), true);
+        (void)initialized;
+        return &interner;
+    }
+
     u32 read_float_array(const char* point, f32* arr, u32 count) {
         panic_if(point[0] != '[', "Trying to parse float array, but not on list: '%.*s'", 50, point);
         ++point;
@@ -220,21 +504,52 @@ namespace json {
         return total_length;
     }
 
-    u32 write_float_array(FILE* out_file, f32* arr, u32 count) {
-        u32 written = print_to_file(out_file, "[");
+    u32 write_float_array(Print_Sink* sink, f32* arr, u32 count) {
+        char buffer[32+2];
+        u32 written = 2;
+        sink->put('[');
 
-        u32 i = 0;
-        for (; i < count-1; ++i) {
-            print_to_file(out_file, "%g, ", arr[i]);
+        for (u32 i = 0; i < count; ++i) {
+            u32 length = 0;
+            if (i != 0) {
+                buffer[length++] = ',';
+                buffer[length++] = ' ';
+            }
+            length += format_f32(arr[i], buffer+length);
+            sink->write(buffer, length);
+            written += length;
         }
-        print_to_file(out_file, "%g", arr[i]);
 
-        written += print_to_file(out_file, "]");
+        sink->put(']');
 
         return written;
     }
 
 
+    u32 read_float_array_binary(const u8* point, const u8* end, f32* arr, u32 count) {
+        if ((u64)(end - point) < (u64)count * 4)
+            return (u32)-1;
+
+        for (u32 i = 0; i < count; ++i) {
+            const u8* b = point + 4*i;
+            u32 bits = (u32)b[0] | ((u32)b[1] << 8) | ((u32)b[2] << 16) | ((u32)b[3] << 24);
+            memcpy(&arr[i], &bits, sizeof(bits));
+        }
+        return count * 4;
+    }
+
+    void write_float_array_binary(Print_Sink* sink, f32* arr, u32 count) {
+        for (u32 i = 0; i < count; ++i) {
+            u32 bits;
+            memcpy(&bits, &arr[i], sizeof(bits));
+            char bytes[4] = {
+                (char)bits, (char)(bits >> 8), (char)(bits >> 16), (char)(bits >> 24)
+            };
+            sink->write(bytes, 4);
+        }
+    }
+
+
     Json_Type identify_thing(const char* string) {
         if (is_quotes_char(string[0])) return Json_Type::String;
         if (is_number_char(string[0])
@@ -293,6 +608,366 @@ namespace json {
         }
     }
 
+    // ------------------------------------------------------------------------
+    //                          structural index
+    // ------------------------------------------------------------------------
+    struct Block_Masks {
+        u64 quotes;
+        u64 backslashes;
+        u64 operators;   // { } [ ] : ,
+        u64 unsupported; // / and ' (comments and single quoted strings)
+    };
+
+    inline u32 count_trailing_zeros(u64 value) {
+#ifdef _MSC_VER
+        unsigned long idx;
+        _BitScanForward64(&idx, value);
+        return (u32)idx;
+#else
+        return (u32)__builtin_ctzll(value);
+#endif
+    }
+
+    inline u64 prefix_xor(u64 bits) {
+        bits ^= bits << 1;
+        bits ^= bits << 2;
+        bits ^= bits << 4;
+        bits ^= bits << 8;
+        bits ^= bits << 16;
+        bits ^= bits << 32;
+        return bits;
+    }
+
+    void classify_block_scalar(const char* block, Block_Masks* out) {
+        *out = {};
+        for (u32 i = 0; i < 64; ++i) {
+            u64 bit = 1llu << i;
+            switch (block[i]) {
+                case '"':  out->quotes      |= bit; break;
+                case '\\': out->backslashes |= bit; break;
+                case '{': case '}': case '[': case ']':
+                case ':': case ',':
+                    out->operators   |= bit; break;
+                case '/': case '\'':
+                    out->unsupported |= bit; break;
+                default: break;
+            }
+        }
+    }
+
+#ifdef FTB_JSON_X86
+#  ifdef _MSC_VER
+#    define FTB_TARGET_AVX2
+#  else
+#    define FTB_TARGET_AVX2 __attribute__((target("avx2")))
+#  endif
+
+    FTB_TARGET_AVX2
+    void classify_block_avx2(const char* block, Block_Masks* out) {
+        auto mask_of = [](__m256i lo, __m256i hi, char c) FTB_TARGET_AVX2 -> u64 {
+            __m256i cv = _mm256_set1_epi8(c);
+            u64 l = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, cv));
+            u64 h = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, cv));
+            return l | (h << 32);
+        };
+
+        __m256i lo = _mm256_loadu_si256((const __m256i*)block);
+        __m256i hi = _mm256_loadu_si256((const __m256i*)(block+32));
+
+        out->quotes      = mask_of(lo, hi, '"');
+        out->backslashes = mask_of(lo, hi, '\\');
+        out->operators   =
+            mask_of(lo, hi, '{') | mask_of(lo, hi, '}') |
+            mask_of(lo, hi, '[') | mask_of(lo, hi, ']') |
+            mask_of(lo, hi, ':') | mask_of(lo, hi, ',');
+        out->unsupported = mask_of(lo, hi, '/') | mask_of(lo, hi, '\'');
+    }
+
+    void classify_block_sse2(const char* block, Block_Masks* out) {
+        __m128i v[4];
+        for (u32 i = 0; i < 4; ++i)
+            v[i] = _mm_loadu_si128((const __m128i*)(block + 16*i));
+
+        auto mask_of = [&](char c) -> u64 {
+            __m128i cv = _mm_set1_epi8(c);
+            u64 result = 0;
+            for (u32 i = 0; i < 4; ++i)
+                result |= ((u64)(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(v[i], cv))) << (16*i);
+            return result;
+        };
+
+        out->quotes      = mask_of('"');
+        out->backslashes = mask_of('\\');
+        out->operators   =
+            mask_of('{') | mask_of('}') |
+            mask_of('[') | mask_of(']') |
+            mask_of(':') | mask_of(',');
+        out->unsupported = mask_of('/') | mask_of('\'');
+    }
+#endif // FTB_JSON_X86
+
+    typedef void (*block_classifier)(const char* block, Block_Masks* out);
+
+#ifdef FTB_JSON_X86
+    // NOTE(Felix): XCR0, which says what register state the OS saves on a
+    //   context switch. Only valid to read if cpuid reports osxsave.
+    inline u64 read_xcr0() {
+#  ifdef _MSC_VER
+        return _xgetbv(0);
+#  else
+        u32 eax, edx;
+        asm volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return ((u64)edx << 32) | eax;
+#  endif
+    }
+#endif
+
+    // NOTE(Felix): asks cpuid directly instead of going through get_cpu_info,
+    //   so the json implementation does not need FTB_CPU_INFO_IMPL.
+    block_classifier select_block_classifier() {
+#ifdef FTB_JSON_X86
+        int registers[4];
+        platform_independent_cpuid(0, registers);
+        int max_function_id = registers[0];
+
+        platform_independent_cpuidex(1, 0, registers);
+        bool sse2    = registers[3] & (int)Edx_1_Feature_Flags::sse2;
+        bool avx     = registers[2] & (int)Ecx_1_Feature_Flags::avx;
+        bool osxsave = registers[2] & (int)Ecx_1_Feature_Flags::osxsave;
+
+        bool avx2 = false;
+        if (max_function_id >= 7) {
+            platform_independent_cpuidex(7, 0, registers);
+            avx2 = registers[1] & (int)Ebx_7_Extended_Feature_Flags::avx2;
+        }
+
+        // NOTE(Felix): the OS has to save the xmm and ymm registers (bits 1
+        //   and 2 of XCR0) for AVX2 to be usable
+        if (avx && avx2 && osxsave && (read_xcr0() & 6) == 6)
+            return classify_block_avx2;
+        if (sse2)
+            return classify_block_sse2;
+#endif
+        return classify_block_scalar;
+    }
+
+    void structural_index_append(Structural_Index* index, u32 position) {
+        if (index->count == index->allocated) {
+            index->allocated = index->allocated ? index->allocated * 2 : 1024;
+            index->positions = index->allocator->resize<u32>(index->positions, index->allocated);
+        }
+        index->positions[index->count++] = position;
+    }
+
+    void Structural_Index::init(const char* string, u64 length, Allocator_Base* allocator) {
+        if (!allocator)
+            allocator = grab_current_allocator();
+
+        *this = {};
+        this->base      = string;
+        this->end       = string + length;
+        this->allocator = allocator;
+        this->valid     = length < 0xffffffff;
+        if (!valid)
+            return;
+
+        static block_classifier classify = select_block_classifier();
+
+        // NOTE(Felix): carried over from one block to the next
+        u64 prev_in_string = 0; // all ones if the previous block ended in a string
+        bool prev_escaped  = false;
+
+        for (u64 block_start = 0; block_start < length; block_start += 64) {
+            Block_Masks masks;
+            if (length - block_start >= 64) {
+                classify(string+block_start, &masks);
+            } else {
+                char padded[64];
+                memset(padded, ' ', sizeof(padded));
+                memcpy(padded, string+block_start, length - block_start);
+                classify(padded, &masks);
+            }
+
+            // NOTE(Felix): a backslash escapes the char after it, even if that
+            //   is a backslash itself. Runs of backslashes are rare enough that
+            //   walking them bit by bit is fine.
+            u64 escaped     = 0;
+            u64 backslashes = masks.backslashes;
+            if (prev_escaped) {
+                escaped     |= 1;
+                backslashes &= ~1llu;
+                prev_escaped = false;
+            }
+            while (backslashes) {
+                u32 bit = count_trailing_zeros(backslashes);
+                if (bit == 63) {
+                    prev_escaped = true;
+                    break;
+                }
+                escaped     |= 1llu << (bit+1);
+                backslashes &= ~(3llu << bit);
+            }
+
+            u64 quotes    = masks.quotes & ~escaped;
+            u64 in_string = prefix_xor(quotes) ^ prev_in_string;
+            prev_in_string = (u64)((s64)in_string >> 63);
+
+            if (masks.unsupported & ~in_string) {
+                valid = false;
+                return;
+            }
+
+            u64 structurals = (masks.operators & ~in_string) | quotes;
+            while (structurals) {
+                structural_index_append(this, (u32)(block_start + count_trailing_zeros(structurals)));
+                structurals &= structurals - 1;
+            }
+        }
+
+        if (prev_in_string) {
+            valid = false;
+            return;
+        }
+
+        // NOTE(Felix): second pass: pair up the openers and closers
+        matching = allocator->allocate<u32>(MAX(count, 1));
+        u32* open_stack = allocator->allocate<u32>(MAX(count, 1));
+        defer { allocator->deallocate(open_stack); };
+        u32  open_count  = 0;
+        bool string_open = false;
+        u32  string_start;
+
+        for (u32 i = 0; i < count; ++i) {
+            char c = base[positions[i]];
+            matching[i] = i;
+            switch (c) {
+                case '"': {
+                    if (string_open) matching[string_start] = i;
+                    else             string_start = i;
+                    string_open = !string_open;
+                } break;
+                case '{': case '[': {
+                    open_stack[open_count++] = i;
+                } break;
+                case '}': case ']': {
+                    char expected_opener = c == '}' ? '{' : '[';
+                    if (open_count == 0 ||
+                        base[positions[open_stack[open_count-1]]] != expected_opener)
+                    {
+                        valid = false;
+                        return;
+                    }
+                    matching[open_stack[--open_count]] = i;
+                } break;
+                default: break;
+            }
+        }
+
+        if (open_count != 0)
+            valid = false;
+    }
+
+    void Structural_Index::deinit() {
+        if (allocator) {
+            allocator->deallocate(positions);
+            allocator->deallocate(matching);
+        }
+        *this = {};
+    }
+
+    u32 structural_seek(Structural_Index* index, u32 offset) {
+        // NOTE(Felix): parsing only moves forward, so usually the cursor only
+        //   walks over the few structurals we actually looked at; subtrees we
+        //   skip are jumped over via `matching`.
+        u32 c = index->cursor;
+        if (c > 0 && index->positions[c-1] >= offset) {
+            u32 low = 0, high = c;
+            while (low < high) {
+                u32 mid = low + (high - low) / 2;
+                if (index->positions[mid] < offset) low  = mid + 1;
+                else                                high = mid;
+            }
+            c = low;
+        }
+        while (c < index->count && index->positions[c] < offset)
+            ++c;
+
+        index->cursor = c;
+        return c;
+    }
+
+    // NOTE(Felix): Like structural_seek, but ignores the cursor and binary
+    //   searches the whole index, for starting somewhere in the middle of the
+    //   input without walking there first.
+    u32 structural_seek_from(Structural_Index* index, u32 offset) {
+        u32 low = 0, high = index->count;
+        while (low < high) {
+            u32 mid = low + (high - low) / 2;
+            if (index->positions[mid] < offset) low  = mid + 1;
+            else                                high = mid;
+        }
+        index->cursor = low;
+        return low;
+    }
+
+    // NOTE(Felix): `position` has to be on a {, [ or ". Returns the number of
+    //   bytes up to and including the matching closing char, or 0 if the index
+    //   can't tell.
+    u32 structural_skip_construct(Structural_Index* index, const char* position) {
+        u32 offset = (u32)(position - index->base);
+        u32 c      = structural_seek(index, offset);
+        if (c == index->count || index->positions[c] != offset || index->matching[c] == c)
+            return 0;
+
+        u32 closing   = index->matching[c];
+        index->cursor = closing + 1;
+        return index->positions[closing] - offset + 1;
+    }
+
+    // NOTE(Felix): Works like eat_construct: `position` is somewhere inside of a
+    //   construct and this eats up to and including `delimiter`. Returns 0 if
+    //   the index can't tell.
+    u32 structural_skip_to_delimiter(Structural_Index* index, const char* position, char delimiter) {
+        u32 offset = (u32)(position - index->base);
+        u32 c      = structural_seek(index, offset);
+
+        while (c < index->count) {
+            char at_c = index->base[index->positions[c]];
+            if (at_c == delimiter) {
+                index->cursor = c + 1;
+                return index->positions[c] - offset + 1;
+            }
+            if (at_c == '}' || at_c == ']')
+                return 0;
+            if (at_c == '{' || at_c == '[' || at_c == '"')
+                c = index->matching[c] + 1;
+            else
+                ++c;
+        }
+        return 0;
+    }
+
+    u32 eat_thing(Parser_Context ctx, const char* string) {
+        if (ctx.structural_index) {
+            Json_Type thing = identify_thing(string);
+            if (thing == Json_Type::Object || thing == Json_Type::List || thing == Json_Type::String) {
+                u32 eaten = structural_skip_construct(ctx.structural_index, string);
+                if (eaten)
+                    return eaten;
+            }
+        }
+        return eat_thing(string);
+    }
+
+    u32 eat_rest_of_construct(Parser_Context ctx, const char* string, char delimiter) {
+        if (ctx.structural_index) {
+            u32 eaten = structural_skip_to_delimiter(ctx.structural_index, string, delimiter);
+            if (eaten)
+                return eaten;
+        }
+        return eat_construct(string, delimiter);
+    }
+
     Pattern_Match_Result pattern_match_list(Parser_Context ctx,
                                             Pattern list_pattern,
                                             Pattern child,
@@ -318,13 +993,18 @@ namespace json {
                                                      void* callback_data, u32* out_eaten,
                                                      Allocator_Base* allocator);
 
-    u32 read_into(void* destination, Data_Type dtype, const char* source, Allocator_Base* allocator) {
+    u32 read_into(void* destination, Data_Type dtype, const char* source,
+                  const char* end, Allocator_Base* allocator)
+    {
+        // NOTE(Felix): `end` is the end of the whole input if known (nullptr
+        //   otherwise), it lets the number readers go 8 digits at a time.
         switch (dtype) {
-            case Data_Type::Integer: return read_int(source,  (s32*)destination);
-            case Data_Type::Long:    return read_long(source, (s64*)destination);
+            case Data_Type::Integer: return read_int(source,  end, (s32*)destination);
+            case Data_Type::Long:    return read_long(source, end, (s64*)destination);
             case Data_Type::Boolean: return read_bool(source, (bool*)destination);
             case Data_Type::String:  return read_string(source, (String*)destination, allocator);
-            case Data_Type::Float:   return read_float(source, (f32*)destination);
+            case Data_Type::String_View: return read_string_view(source, (String*)destination, allocator);
+            case Data_Type::Float:   return read_float(source, end, (f32*)destination);
             default: panic("dtype %u not implemented", (u8)dtype - (u8)(1<<7));
         }
     }
@@ -361,7 +1041,7 @@ namespace json {
 
             eaten += sub_eaten;
             if (sub_result == Pattern_Match_Result::OK_DONE) {
-                eaten += eat_construct(string+eaten, '}');
+                eaten += eat_rest_of_construct(ctx, string+eaten, '}');
             }
 
             eaten += eat_whitespace_and_comments(string+eaten);
@@ -395,6 +1075,43 @@ namespace json {
             || (type_in_string == Json_Type::Number && type_in_pattern == Json_Type::String);
     }
 
+    // NOTE(Felix): reads a string, number or bool at `string` into
+    //   `destination`, returns the number of chars read. Shared by the pattern
+    //   interpreter and compiled patterns.
+    u32 match_simple_value(Json_Type pattern_type, Data_Type destination_type, void* destination,
+                           Json_Type thing_at_point, const char* string, const char* input_end,
+                           Allocator_Base* allocator)
+    {
+        u32 eaten = 0;
+        if (thing_at_point == pattern_type) {
+            eaten += read_into(destination, destination_type, string, input_end, allocator);
+        } else if (thing_at_point == Json_Type::String) {
+            // NOTE(Felix): if types don't match, but in the supplied
+            //   json we are looking at a string, then try to read the
+            //   thing in the string
+            if (identify_thing(string+1) == pattern_type) {
+                ++eaten; // overstep quotation marks
+                eaten += read_into(destination, destination_type,
+                                   string+eaten, input_end, allocator);
+                ++eaten; // overstep quotation marks
+            }
+        } else if ((destination_type == Data_Type::String ||
+                    destination_type == Data_Type::String_View) &&
+                   thing_at_point == Json_Type::Number)
+        {
+            // NOTE(Felix): if we're on a number but should read into a string
+            u32 str_len = eat_number(string);
+            String* str = (String*)destination;
+            if (destination_type == Data_Type::String_View)
+                str->data = (char*)string;
+            else
+                str->data = heap_copy_limited_c_string(string, str_len, allocator);
+            str->length = str_len;
+            eaten += str_len;
+        }
+        return eaten;
+    }
+
     Pattern_Match_Result pattern_match_value(Parser_Context ctx, Pattern pattern,
                                              void* matched_obj, void* callback_data,
                                              u32* out_eaten, Allocator_Base* allocator)
@@ -406,6 +1123,7 @@ namespace json {
         eaten += eat_whitespace_and_comments(string);
 
         Json_Type thing_at_point = identify_thing(string+eaten);
+        const char* input_end = ctx.structural_index ? ctx.structural_index->end : nullptr;
 
         Pattern_Match_Result enter_message = Pattern_Match_Result::OK_CONTINUE;
         Pattern_Match_Result leave_message = Pattern_Match_Result::OK_CONTINUE;
@@ -451,35 +1169,11 @@ namespace json {
                                                     callback_data,
                                                     &eaten_sub_object, allocator);
                 } else {
-                    // match simple values
-
                     panic_if(pattern.type == Json_Type::Object_Member_Name,
                              "object member not valid here");
-                    if (thing_at_point == pattern.type) {
-                        eaten += read_into((void*)(((u8*)matched_obj)+pattern.value.destination_offset),
-                                           pattern.value.destination_type,
-                                           string+eaten, allocator);
-                    } else if (thing_at_point == Json_Type::String) {
-                        // NOTE(Felix): if types don't match, but in the supplied
-                        //   json we are looking at a string, then try to read the
-                        //   thing in the string
-                        if (identify_thing(string+eaten+1) == pattern.type) {
-                            ++eaten; // overstep quotation marks
-                            eaten += read_into((void*)(((u8*)matched_obj)+pattern.value.destination_offset),
-                                               pattern.value.destination_type,
-                                               string+eaten, allocator);
-                            ++eaten; // overstep quotation marks
-                        }
-                    } else if (pattern.value.destination_type == Data_Type::String &&
-                               thing_at_point == Json_Type::Number)
-                    {
-                        // NOTE(Felix): if we're on a number but should read into a string
-                        u32 str_len = eat_number(string+eaten);
-                        String* str = (String*)(((u8*)matched_obj)+pattern.value.destination_offset);
-                        str->data   = heap_copy_limited_c_string(string+eaten, str_len, allocator);
-                        str->length = str_len;
-                        eaten += str_len;
-                    }
+                    eaten += match_simple_value(pattern.type, pattern.value.destination_type,
+                                                ((u8*)matched_obj)+pattern.value.destination_offset,
+                                                thing_at_point, string+eaten, input_end, allocator);
 
                     sub_result = Pattern_Match_Result::OK_CONTINUE;
 
@@ -495,7 +1189,7 @@ namespace json {
         // NOTE(Felix): if pattern is on something that can't have children we
         //   have to overstep it here
         if (!eaten_sub_object) {
-            eaten += eat_thing(string+eaten);
+            eaten += eat_thing(ctx, string+eaten);
         }
 
         call_ctx.position_in_string = string+eaten;
@@ -593,6 +1287,7 @@ namespace json {
                     }
                 },
                 .position_in_string = string+eaten,
+                .structural_index   = ctx.structural_index,
             };
 
             Pattern_Match_Result sub_result
@@ -604,7 +1299,7 @@ namespace json {
 
             if (sub_result == Pattern_Match_Result::OK_DONE) {
                 // skip rest of the list
-                eaten += eat_construct(string+eaten, ']');
+                eaten += eat_rest_of_construct(ctx, string+eaten, ']');
                 *out_eaten = eaten;
                 return Pattern_Match_Result::OK_DONE;
             }
@@ -649,7 +1344,7 @@ namespace json {
             //   patterns should be Object_Member_Name, since this is the only
             //   pattern here
 
-            member_name_len = eat_string(string+eaten)-2; // subtract the "
+            member_name_len = eat_thing(ctx, string+eaten)-2; // subtract the "
             member_name = string+eaten+1;
             value_lengh = 0;
 
@@ -718,19 +1413,44 @@ namespace json {
 
             Json_Type thing_at_point = identify_thing(string+eaten);
 
-            // check for children patterns with that member name
-            for (u32 i = 0; i < p.object.member_count; ++i) {
-                const Object_Member om = p.object.members[i];
-                bool names_match =
-                    strlen(om.key) == member_name_len &&
-                    strncmp(om.key, member_name, member_name_len) == 0;
-                bool types_compatible = pattern_types_compatible(om.pattern.type, thing_at_point);
+            Interned_Id member_id = key_interner()->lookup(member_name, member_name_len);
 
-                if (names_match && types_compatible)
+            // check for children patterns with that member name
+            if (p.object.member_index) {
+                // NOTE(Felix): members with the same key sit in the same probe
+                //   sequence in declaration order, so the first compatible one
+                //   wins, just like in the linear search below. If the key was
+                //   never interned, no pattern anywhere has it.
+                u32 mask = p.object.member_index_mask;
+                for (u32 slot = member_id & mask;
+                     member_id != INTERNED_ID_INVALID &&
+                     p.object.member_index[slot];
+                     slot = (slot + 1) & mask)
                 {
-                    found_pattern_todo = true;
-                    pattern_todo = om;
-                    break;
+                    const Object_Member& om = p.object.members[p.object.member_index[slot]-1];
+                    if (om.key_id == member_id &&
+                        pattern_types_compatible(om.pattern.type, thing_at_point))
+                    {
+                        found_pattern_todo = true;
+                        pattern_todo = om;
+                        break;
+                    }
+                }
+            } else {
+                for (u32 i = 0; i < p.object.member_count; ++i) {
+                    const Object_Member& om = p.object.members[i];
+                    bool names_match = om.key_id != INTERNED_ID_INVALID
+                        ? om.key_id == member_id
+                        : strncmp(om.key, member_name, member_name_len) == 0 &&
+                          om.key[member_name_len] == '\0';
+                    bool types_compatible = pattern_types_compatible(om.pattern.type, thing_at_point);
+
+                    if (names_match && types_compatible)
+                    {
+                        found_pattern_todo = true;
+                        pattern_todo = om;
+                        break;
+                    }
                 }
             }
 
@@ -750,6 +1470,7 @@ namespace json {
                     }
                 },
                 .position_in_string = string+eaten,
+                .structural_index   = ctx.structural_index,
             };
 
             value_lengh = 0;
@@ -761,7 +1482,7 @@ namespace json {
 
 
                 if (sub_result == Pattern_Match_Result::MATCHING_ERROR) {
-                    log_info("When matching %{->Str}", member_name_str);
+                    log_info("When matching %{->Str}", &member_name_str);
                     return Pattern_Match_Result::MATCHING_ERROR;
                 }
 
@@ -786,7 +1507,7 @@ namespace json {
             else {
                 // NOTE(Felix): neither pattern nor mapping was done, so we need to
                 //   get the value length ourselved
-                eaten += eat_thing(string+eaten);
+                eaten += eat_thing(ctx, string+eaten);
             }
 
         }
@@ -796,6 +1517,27 @@ namespace json {
     }
 
 
+    Pattern_Match_Result pattern_match_in_context(const char* string, u64 length,
+                                                  Parser_Context_Stack_Entry context,
+                                                  Pattern pattern, void* matched_obj,
+                                                  void* callback_data, Allocator_Base* allocator)
+    {
+        u32 eaten = 0;
+
+        Structural_Index structural_index;
+        structural_index.init(string, length, libc_allocator);
+        defer { structural_index.deinit(); };
+
+        Parser_Context call_ctx {
+            .context_stack      = context,
+            .position_in_string = string,
+            .structural_index   = structural_index.valid ? &structural_index : nullptr,
+        };
+        return pattern_match_value(call_ctx, pattern,
+                                   matched_obj, callback_data,
+                                   &eaten, allocator);
+    }
+
     Pattern_Match_Result pattern_match(const char* string, Pattern pattern,
                                        void* matched_obj, void* callback_data,
                                        Allocator_Base* allocator) {
@@ -807,99 +1549,1293 @@ namespace json {
         if (!allocator)
             allocator = grab_current_allocator();
 
-        u32 eaten = 0;
+        return pattern_match_in_context(string, strlen(string), {}, pattern,
+                                        matched_obj, callback_data, allocator);
+    }
 
-        Parser_Context call_ctx {
-            .position_in_string = string,
-        };
-        return pattern_match_value(call_ctx, pattern,
-                                   matched_obj, callback_data,
-                                   &eaten, allocator);
+    Pattern_Match_Result pattern_match(String string, Pattern pattern,
+                                       void* matched_obj, void* callback_data,
+                                       Allocator_Base* allocator) {
+        if (!string.data) {
+            return Pattern_Match_Result::MATCHING_ERROR;
+        }
+
+        if (!allocator)
+            allocator = grab_current_allocator();
+
+        return pattern_match_in_context(string.data, string.length, {}, pattern,
+                                        matched_obj, callback_data, allocator);
     }
 
-    // Pattern member_value(const char* key, Json_Type source_type, Data_Type destination_type, u32 destination_offset) {
-    //     Pattern p = Pattern {
-    //         .type     = Json_Type::Object_Member_Name,
-    //         .member   = { .name = key },
-    //         .children = Array_List<Pattern>::create_from({
-    //             {
-    //                 .type = source_type,
-    //                 .value = {
-    //                     .destination_type   = destination_type,
-    //                     .destination_offset = destination_offset
-    //                 }
-    //             }
-    //             })
-    //     };
-    //     return p;
-    // }
+    // ------------------------------------------------------------------------
+    //                          on demand access
+    // ------------------------------------------------------------------------
+    void Doc::init(const char* in_string, bool build_structural_index, Allocator_Base* allocator) {
+        string = in_string;
+        end    = in_string + strlen(in_string);
+        structural_index = {};
+        if (build_structural_index)
+            structural_index.init(string, end - string, allocator);
+    }
 
+    void Doc::deinit() {
+        structural_index.deinit();
+        *this = {};
+    }
 
-    Pattern p_str(u32 offset, Hooks hooks) {
-        Pattern p = Pattern {
-            .type  = Json_Type::String,
-            .value = {
-                .destination_type   = Data_Type::String,
-                .destination_offset = offset
-            },
-            .hooks = hooks
+    Value Doc::root() {
+        return Value {
+            .doc      = this,
+            .position = string + eat_whitespace_and_comments(string),
         };
-        return p;
     }
 
-    Pattern p_s32(u32 offset, Hooks hooks) {
-        Pattern p = Pattern {
-            .type  = Json_Type::Number,
-            .value = {
-                .destination_type   = Data_Type::Integer,
-                .destination_offset = offset
-            },
-            .hooks = hooks
+    Parser_Context doc_context(Doc* doc) {
+        return Parser_Context {
+            .context_stack      = {},
+            .position_in_string = doc->string,
+            .structural_index   = doc->structural_index.valid ? &doc->structural_index : nullptr,
         };
+    }
 
-        return p;
+    bool Value::exists() {
+        return position != nullptr;
     }
 
-    Pattern p_s64(u32 offset, Hooks hooks) {
-        Pattern p = Pattern {
-            .type  = Json_Type::Number,
-            .value = {
-                .destination_type   = Data_Type::Long,
-                .destination_offset = offset
-            },
-            .hooks = hooks
-        };
+    Json_Type Value::type() {
+        if (!position)
+            return Json_Type::Invalid;
+
+        // NOTE(Felix): stricter than identify_thing, which calls everything it
+        //   does not know a Boolean
+        switch (position[0]) {
+            case '"': case '\'': return Json_Type::String;
+            case '{':            return Json_Type::Object;
+            case '[':            return Json_Type::List;
+            case 't': return strncmp(position, true_string,  sizeof(true_string)-1)  == 0 ? Json_Type::Boolean : Json_Type::Invalid;
+            case 'f': return strncmp(position, false_string, sizeof(false_string)-1) == 0 ? Json_Type::Boolean : Json_Type::Invalid;
+            case 'n': return strncmp(position, null_string,  sizeof(null_string)-1)  == 0 ? Json_Type::Null    : Json_Type::Invalid;
+            default:
+                if (is_number_char(position[0]) || position[0] == '+' || position[0] == '-')
+                    return Json_Type::Number;
+                return Json_Type::Invalid;
+        }
+    }
 
-        return p;
+    // NOTE(Felix): `string` is just past a list element or member value; goes
+    //   to the start of the next one or returns nullptr at the end of the
+    //   construct
+    const char* doc_after_separator(const char* string) {
+        string += eat_whitespace_and_comments(string);
+        if (string[0] != ',')
+            return nullptr;
+        ++string;
+        string += eat_whitespace_and_comments(string);
+        if (string[0] == ']' || string[0] == '}') // trailing comma
+            return nullptr;
+        return string;
     }
 
-    Pattern p_f32(u32 offset, Hooks hooks) {
-        Pattern p = Pattern {
-            .type  = Json_Type::Number,
-            .value = {
-                .destination_type   = Data_Type::Float,
-                .destination_offset = offset
-            },
-            .hooks = hooks
-        };
+    Value Value::first_element() {
+        if (type() != Json_Type::List)
+            return { doc, nullptr };
 
-        return p;
+        const char* element = position + 1;
+        element += eat_whitespace_and_comments(element);
+        if (element[0] == ']')
+            return { doc, nullptr };
+        return { doc, element };
     }
 
-    Pattern p_bool(u32 offset, Hooks hooks) {
-        Pattern p = Pattern {
-            .type  = Json_Type::Boolean,
-            .value = {
-                .destination_type   = Data_Type::Boolean,
-                .destination_offset = offset
-            },
-            .hooks = hooks
-        };
-        return p;
+    Value Value::next_element() {
+        if (!position)
+            return { doc, nullptr };
+        const char* after = position + eat_thing(doc_context(doc), position);
+        return { doc, doc_after_separator(after) };
     }
 
-    Pattern object(std::initializer_list<Object_Member> members, Fallback_Pattern fallback_pattern, Hooks hooks) {
-        Pattern p = Pattern {
+    Value Value::at(u32 index) {
+        Value element = first_element();
+        for (u32 i = 0; i < index && element.exists(); ++i)
+            element = element.next_element();
+        return element;
+    }
+
+    Member read_member(Doc* doc, const char* string) {
+        Member member { .value = { doc, nullptr } };
+        if (!string)
+            return member;
+
+        u32 key_length;
+        if (is_quotes_char(string[0])) {
+            key_length = eat_thing(doc_context(doc), string);
+            member.key = { (char*)string+1, key_length-2 };
+        } else {
+            key_length = eat_identifier(string);
+            member.key = { (char*)string, key_length };
+        }
+        string += key_length;
+        string += eat_whitespace_and_comments(string);
+
+        // NOTE(Felix): malformed input ends the object, like everything else
+        //   the on demand api can't make sense of
+        if (string[0] != ':')
+            return { .value = { doc, nullptr } };
+        ++string; // overstep :
+        member.value.position = string + eat_whitespace_and_comments(string);
+        return member;
+    }
+
+    Member first_member(Value object) {
+        if (object.type() != Json_Type::Object)
+            return { .value = { object.doc, nullptr } };
+
+        const char* string = object.position + 1;
+        string += eat_whitespace_and_comments(string);
+        if (string[0] == '}')
+            return { .value = { object.doc, nullptr } };
+        return read_member(object.doc, string);
+    }
+
+    bool Member::exists() {
+        return value.exists();
+    }
+
+    Member Member::next() {
+        return read_member(value.doc, doc_after_separator(
+                               value.position + eat_thing(doc_context(value.doc), value.position)));
+    }
+
+    Value Value::find_field(String key) {
+        for (Member member = first_member(*this); member.exists(); member = member.next()) {
+            if (member.key.length == key.length &&
+                memcmp(member.key.data, key.data, key.length) == 0)
+            {
+                return member.value;
+            }
+        }
+        return { doc, nullptr };
+    }
+
+    Value Value::find_field(const char* key) {
+        return find_field(String { (char*)key, (u64)strlen(key) });
+    }
+
+    u32 Value::count() {
+        u32 result = 0;
+        if (type() == Json_Type::Object) {
+            for (Member member = first_member(*this); member.exists(); member = member.next())
+                ++result;
+        } else {
+            for (Value element = first_element(); element.exists(); element = element.next_element())
+                ++result;
+        }
+        return result;
+    }
+
+    bool Value::get_f32(f32* out) {
+        if (type() != Json_Type::Number)
+            return false;
+        read_float(position, doc->end, out);
+        return true;
+    }
+
+    bool Value::get_s32(s32* out) {
+        if (type() != Json_Type::Number)
+            return false;
+        read_int(position, doc->end, out);
+        return true;
+    }
+
+    bool Value::get_s64(s64* out) {
+        if (type() != Json_Type::Number)
+            return false;
+        read_long(position, doc->end, out);
+        return true;
+    }
+
+    bool Value::get_bool(bool* out) {
+        if (type() != Json_Type::Boolean)
+            return false;
+        read_bool(position, out);
+        return true;
+    }
+
+    bool Value::get_string(String* out, Allocator_Base* allocator) {
+        if (type() != Json_Type::String)
+            return false;
+        read_string_view(position, out, allocator);
+        return true;
+    }
+
+    String Value::get_raw() {
+        if (type() == Json_Type::Invalid)
+            return {};
+        return { (char*)position, eat_thing(doc_context(doc), position) };
+    }
+
+    // ------------------------------------------------------------------------
+    //                          parallel matching
+    // ------------------------------------------------------------------------
+    struct Parallel_Match {
+        const char*       string;
+        const u32*        record_starts;
+        Structural_Index* structural_index;
+        Pattern*          element_pattern;
+        u8*               elements;
+        u32               element_size;
+        void*             callback_data;
+        Allocator_Base*   allocator;
+
+        std::atomic<u32>  done_at; // first record that returned OK_DONE
+        std::atomic<bool> failed;
+    };
+
+    // NOTE(Felix): enter and leave hooks see the records in order and one at a
+    //   time when matching serially, so patterns with them are not matched in
+    //   parallel
+    bool pattern_has_parser_hooks(const Pattern& pattern) {
+        if (pattern.hooks.enter_hook || pattern.hooks.leave_hook)
+            return true;
+        if (pattern.hooks.custom_reader)
+            return false;
+
+        if (pattern.type == Json_Type::Object) {
+            for (u32 i = 0; i < pattern.object.member_count; ++i) {
+                if (pattern_has_parser_hooks(pattern.object.members[i].pattern))
+                    return true;
+            }
+            return pattern.object.fallback_pattern &&
+                pattern_has_parser_hooks(pattern.object.fallback_pattern->pattern);
+        }
+        if (pattern.type == Json_Type::List)
+            return pattern_has_parser_hooks(*pattern.list.child_pattern);
+        return false;
+    }
+
+    // NOTE(Felix): frees the strings and lists matched into `obj` and zeroes
+    //   them. Whatever custom readers allocated is not known and stays.
+    void free_matched_value(const Pattern& pattern, void* obj, Allocator_Base* allocator) {
+        if (pattern.hooks.custom_reader)
+            return;
+
+        auto free_list = [&](u32 array_list_offset, u32 element_size, const Pattern& element_pattern) {
+            Array_List<byte>* list = (Array_List<byte>*)(((u8*)obj) + array_list_offset);
+            if (element_size == 0 || !list->data)
+                return;
+            for (u32 i = 0; i < list->count; ++i)
+                free_matched_value(element_pattern, list->data + (u64)i * element_size, allocator);
+            allocator->deallocate(list->data);
+            *list = {};
+        };
+
+        switch (pattern.type) {
+            case Json_Type::Object: {
+                for (u32 i = 0; i < pattern.object.member_count; ++i)
+                    free_matched_value(pattern.object.members[i].pattern, obj, allocator);
+                if (pattern.object.fallback_pattern) {
+                    const Fallback_Pattern* fallback = pattern.object.fallback_pattern;
+                    free_list(fallback->array_list_offset, fallback->element_size, fallback->pattern);
+                }
+            } break;
+            case Json_Type::List: {
+                free_list(pattern.list.array_list_offset, pattern.list.element_size,
+                          *pattern.list.child_pattern);
+            } break;
+            case Json_Type::String: {
+                if (pattern.value.destination_type != Data_Type::String)
+                    break;
+                String* str = (String*)(((u8*)obj) + pattern.value.destination_offset);
+                if (str->data)
+                    allocator->deallocate(str->data);
+                *str = {};
+            } break;
+            default: break;
+        }
+    }
+
+    // NOTE(Felix): every thread needs its own cursor into the shared index,
+    //   starting at its first record
+    Structural_Index structural_index_for_thread(const Structural_Index* shared, u32 start_offset) {
+        Structural_Index index = *shared;
+        structural_seek_from(&index, start_offset);
+        return index;
+    }
+
+    void match_parallel_records(Parallel_Match* m, u32 begin, u32 end) {
+        Structural_Index structural_index;
+        if (m->structural_index && begin < end)
+            structural_index = structural_index_for_thread(m->structural_index, m->record_starts[begin]);
+
+        Parser_Context_Stack_Entry root {};
+        for (u32 i = begin; i < end; ++i) {
+            if (i > m->done_at.load(std::memory_order_relaxed) ||
+                m->failed.load(std::memory_order_relaxed))
+                return;
+
+            Parser_Context call_ctx {
+                .context_stack = {
+                    .previous    = &root,
+                    .parent_type = Parser_Context_Type::List_Entry,
+                    .parent {
+                        .list_entry  = {
+                            .index  = (s32)i,
+                        }
+                    }
+                },
+                .position_in_string = m->string + m->record_starts[i],
+                .structural_index   = m->structural_index ? &structural_index : nullptr,
+            };
+
+            u32 eaten = 0;
+            Pattern_Match_Result result =
+                pattern_match_value(call_ctx, *m->element_pattern,
+                                    m->elements + (u64)i * m->element_size,
+                                    m->callback_data, &eaten, m->allocator);
+
+            if (result == Pattern_Match_Result::MATCHING_ERROR) {
+                m->failed.store(true);
+                return;
+            }
+            if (result == Pattern_Match_Result::OK_DONE) {
+                u32 done_at = m->done_at.load();
+                while (i < done_at && !m->done_at.compare_exchange_weak(done_at, i))
+                    ;
+                return;
+            }
+        }
+    }
+
+    Pattern_Match_Result pattern_match_parallel(const char* string, Pattern list_pattern,
+                                                void* matched_obj, u32 thread_count,
+                                                void* callback_data, Allocator_Base* allocator)
+    {
+        if (!string)
+            return Pattern_Match_Result::MATCHING_ERROR;
+
+        if (!allocator)
+            allocator = grab_current_allocator();
+
+        if (thread_count == 0)
+            thread_count = MAX(std::thread::hardware_concurrency(), 1u);
+
+        bool parallelizable =
+            thread_count > 1 &&
+            list_pattern.type == Json_Type::List &&
+            list_pattern.list.element_size > 0 &&
+            !list_pattern.hooks.custom_reader &&
+            !pattern_has_parser_hooks(list_pattern);
+
+        if (!parallelizable)
+            return pattern_match(string, list_pattern, matched_obj, callback_data, allocator);
+
+        u64 length = strlen(string);
+        Structural_Index structural_index;
+        structural_index.init(string, length, libc_allocator);
+        defer { structural_index.deinit(); };
+
+        if (!structural_index.valid)
+            return pattern_match(string, list_pattern, matched_obj, callback_data, allocator);
+
+        Parser_Context ctx {
+            .context_stack      = {},
+            .position_in_string = string,
+            .structural_index   = &structural_index,
+        };
+
+        // NOTE(Felix): find the record boundaries, skipping records is cheap
+        //   with the structural index
+        u32 eaten = eat_whitespace_and_comments(string);
+        if (string[eaten] != '[')
+            return pattern_match(string, list_pattern, matched_obj, callback_data, allocator);
+        ++eaten; // overstep [
+        eaten += eat_whitespace_and_comments(string+eaten);
+
+        Array_List<u32> record_starts;
+        record_starts.init(1024, allocator);
+        defer { record_starts.deinit(); };
+
+        while (string[eaten] != ']') {
+            record_starts.append(eaten);
+            eaten += eat_thing(ctx, string+eaten);
+            eaten += eat_whitespace_and_comments(string+eaten);
+
+            if (string[eaten] != ',' && string[eaten] != ']') {
+                log_error("expected comma or end of list here, but got %.*s",
+                          (s32)MIN(strlen(string+eaten), (u64)20), string+eaten);
+                return Pattern_Match_Result::MATCHING_ERROR;
+            }
+
+            if (string[eaten] == ',') {
+                ++eaten; // overstep ,
+                eaten += eat_whitespace_and_comments(string+eaten);
+            }
+        }
+
+        u32 record_count = record_starts.count;
+        // NOTE(Felix): starting threads is not worth it for a few records
+        thread_count = MIN(thread_count, record_count / 64);
+        if (thread_count <= 1)
+            return pattern_match(string, list_pattern, matched_obj, callback_data, allocator);
+
+        // NOTE(Felix): make room for all records up front (zeroed, like
+        //   list_assure_free_slot does), so every thread can write into its
+        //   own slots and nothing has to be concatenated afterwards
+        u32 element_size = list_pattern.list.element_size;
+        Array_List<byte>* list = (Array_List<byte>*)(((u8*)matched_obj) + list_pattern.list.array_list_offset);
+        u32 first = list->count;
+        if (list->length < first + record_count) {
+            list->data = (byte*)realloc_zero(list->data,
+                                             (u64)list->length * element_size,
+                                             (u64)(first + record_count) * element_size,
+                                             allocator);
+            list->length    = first + record_count;
+            list->allocator = allocator;
+        }
+
+        Parallel_Match m {
+            .string           = string,
+            .record_starts    = record_starts.data,
+            .structural_index = &structural_index,
+            .element_pattern  = list_pattern.list.child_pattern,
+            .elements         = ((u8*)list->data) + (u64)first * element_size,
+            .element_size     = element_size,
+            .callback_data    = callback_data,
+            .allocator        = allocator,
+        };
+        m.done_at = record_count;
+        m.failed  = false;
+
+        // NOTE(Felix): the calling thread takes the first chunk itself
+        std::thread* threads = allocator->allocate<std::thread>(thread_count-1);
+        defer { allocator->deallocate(threads); };
+
+        u32 per_thread = (record_count + thread_count - 1) / thread_count;
+        for (u32 t = 1; t < thread_count; ++t) {
+            u32 begin = MIN(t * per_thread, record_count);
+            u32 end   = MIN(begin + per_thread, record_count);
+            new (&threads[t-1]) std::thread(match_parallel_records, &m, begin, end);
+        }
+        match_parallel_records(&m, 0, MIN(per_thread, record_count));
+
+        for (u32 t = 0; t < thread_count-1; ++t) {
+            threads[t].join();
+            threads[t].~thread();
+        }
+
+        // NOTE(Felix): records that don't end up in the list (all of them on
+        //   an error, the ones behind an OK_DONE) might have been matched
+        //   already, free what they allocated
+        u32 keep = m.failed ? 0 : MIN(m.done_at + 1, record_count);
+        for (u32 i = keep; i < record_count; ++i)
+            free_matched_value(*list_pattern.list.child_pattern, m.elements + (u64)i * element_size, allocator);
+
+        if (m.failed)
+            return Pattern_Match_Result::MATCHING_ERROR;
+
+        u32 done_at = m.done_at;
+        if (done_at < record_count) {
+            list->count = first + done_at + 1;
+            return Pattern_Match_Result::OK_DONE;
+        }
+
+        list->count = first + record_count;
+        return Pattern_Match_Result::OK_CONTINUE;
+    }
+
+    // ------------------------------------------------------------------------
+    //                          compiled patterns
+    // ------------------------------------------------------------------------
+    struct Plan_Compiler {
+        Array_List<Plan_Step>   steps;
+        Array_List<Plan_Member> members;
+        Array_List<u32>         member_tables;
+        Array_List<Pattern>     interpreted;
+    };
+
+    u32 compile_step(Plan_Compiler* compiler, const Pattern& pattern) {
+        u32 index = compiler->steps.count;
+        compiler->steps.append({});
+
+        Plan_Step step {};
+        step.type = pattern.type;
+
+        bool has_parser_hooks = pattern.hooks.enter_hook || pattern.hooks.leave_hook;
+        bool needs_interpreter =
+            has_parser_hooks ||
+            pattern.type == Json_Type::Object_As_Hash_Map ||
+            (pattern.type == Json_Type::Object && !pattern.hooks.custom_reader &&
+             pattern.object.fallback_pattern);
+
+        if (needs_interpreter) {
+            step.op = Plan_Op::Interpret;
+            // NOTE(Felix): stored as index for now, the list might still move
+            step.element_size = compiler->interpreted.count;
+            compiler->interpreted.append(pattern);
+        } else if (pattern.hooks.custom_reader) {
+            step.op                 = Plan_Op::Custom;
+            step.custom_reader      = pattern.hooks.custom_reader;
+            step.destination_offset = pattern.value.destination_offset;
+        } else if (pattern.type == Json_Type::Object) {
+            step.op           = Plan_Op::Object;
+            step.member_count = pattern.object.member_count;
+
+            // NOTE(Felix): compile the member patterns first, so the members
+            //   of this object end up next to each other
+            Auto_Array_List<u32> member_steps(pattern.object.member_count+1);
+            for (u32 i = 0; i < pattern.object.member_count; ++i)
+                member_steps.append(compile_step(compiler, pattern.object.members[i].pattern));
+
+            step.child = compiler->members.count;
+            for (u32 i = 0; i < pattern.object.member_count; ++i) {
+                const Object_Member& member = pattern.object.members[i];
+                compiler->members.append({
+                    .key_id = member.key_id != INTERNED_ID_INVALID
+                        ? member.key_id
+                        : key_interner()->intern(member.key),
+                    .type   = pattern.object.members[i].pattern.type,
+                    .step   = member_steps[i],
+                });
+            }
+
+            u32 table_size = 4;
+            while (table_size < step.member_count * 2)
+                table_size *= 2;
+
+            step.member_table      = compiler->member_tables.count;
+            step.member_table_mask = table_size - 1;
+            for (u32 i = 0; i < table_size; ++i)
+                compiler->member_tables.append(0);
+
+            // NOTE(Felix): same insertion order as json::object, so members
+            //   with the same key are found in declaration order
+            u32* table = compiler->member_tables.data + step.member_table;
+            for (u32 i = 0; i < step.member_count; ++i) {
+                u32 slot = compiler->members[step.child + i].key_id & step.member_table_mask;
+                while (table[slot])
+                    slot = (slot + 1) & step.member_table_mask;
+                table[slot] = i + 1;
+            }
+        } else if (pattern.type == Json_Type::List) {
+            step.op                 = Plan_Op::List;
+            step.destination_offset = pattern.list.array_list_offset;
+            step.element_size       = pattern.list.element_size;
+            step.child              = compile_step(compiler, *pattern.list.child_pattern);
+        } else {
+            step.op                 = Plan_Op::Value;
+            step.destination_type   = pattern.value.destination_type;
+            step.destination_offset = pattern.value.destination_offset;
+        }
+
+        compiler->steps[index] = step;
+        return index;
+    }
+
+    Compiled_Pattern compile(Pattern pattern, Allocator_Base* allocator) {
+        if (!allocator)
+            allocator = grab_current_allocator();
+
+        Plan_Compiler compiler;
+        compiler.steps.init(16);
+        compiler.members.init(16);
+        compiler.member_tables.init(64);
+        compiler.interpreted.init(4);
+        defer {
+            compiler.steps.deinit();
+            compiler.members.deinit();
+            compiler.member_tables.deinit();
+            compiler.interpreted.deinit();
+        };
+
+        compile_step(&compiler, pattern);
+
+        Compiled_Pattern plan {};
+        plan.allocator         = allocator;
+        plan.step_count        = compiler.steps.count;
+        plan.member_count      = compiler.members.count;
+        plan.member_table_size = compiler.member_tables.count;
+        plan.interpreted_count = compiler.interpreted.count;
+
+        plan.steps = allocator->allocate<Plan_Step>(plan.step_count);
+        memcpy(plan.steps, compiler.steps.data, sizeof(Plan_Step) * plan.step_count);
+
+        if (plan.member_count) {
+            plan.members = allocator->allocate<Plan_Member>(plan.member_count);
+            memcpy(plan.members, compiler.members.data, sizeof(Plan_Member) * plan.member_count);
+        }
+        if (plan.member_table_size) {
+            plan.member_tables = allocator->allocate<u32>(plan.member_table_size);
+            memcpy(plan.member_tables, compiler.member_tables.data, sizeof(u32) * plan.member_table_size);
+        }
+        if (plan.interpreted_count) {
+            plan.interpreted = allocator->allocate<Pattern>(plan.interpreted_count);
+            memcpy(plan.interpreted, compiler.interpreted.data, sizeof(Pattern) * plan.interpreted_count);
+        }
+
+        for (u32 i = 0; i < plan.step_count; ++i) {
+            if (plan.steps[i].op == Plan_Op::Interpret) {
+                plan.steps[i].pattern      = &plan.interpreted[plan.steps[i].element_size];
+                plan.steps[i].element_size = 0;
+            }
+        }
+
+        return plan;
+    }
+
+    void Compiled_Pattern::deinit() {
+        allocator->deallocate(steps);
+        if (members)       allocator->deallocate(members);
+        if (member_tables) allocator->deallocate(member_tables);
+        if (interpreted)   allocator->deallocate(interpreted);
+        *this = {};
+    }
+
+    struct Plan_Matcher {
+        const Compiled_Pattern* plan;
+        Parser_Context          ctx; // only the structural index and root context
+        const char*             input_end;
+        void*                   callback_data;
+        Allocator_Base*         allocator;
+    };
+
+    Pattern_Match_Result run_plan_step(Plan_Matcher* m, u32 step_index, const char* string,
+                                       Parser_Context_Stack_Entry* context,
+                                       void* matched_obj, u32* out_eaten);
+
+    Pattern_Match_Result run_plan_object(Plan_Matcher* m, const Plan_Step& step, const char* string,
+                                         Parser_Context_Stack_Entry* context,
+                                         void* matched_obj, u32* out_eaten)
+    {
+        // NOTE(Felix): same as pattern_match_object + pattern_match_object_member
+        const Plan_Member* members = m->plan->members + step.child;
+        const u32*         table   = m->plan->member_tables + step.member_table;
+
+        *out_eaten = 0;
+        u32 eaten = 1; // overstep {
+        eaten += eat_whitespace_and_comments(string+eaten);
+
+        while (string[eaten] != '}') {
+            u32         member_name_len;
+            const char* member_name;
+
+            if (string[eaten] == '"') {
+                member_name_len = eat_thing(m->ctx, string+eaten)-2; // subtract the "
+                member_name     = string+eaten+1;
+                eaten += member_name_len+2;
+            } else {
+                member_name_len = eat_identifier(string+eaten);
+                member_name     = string+eaten;
+                eaten += member_name_len;
+            }
+            eaten += eat_whitespace_and_comments(string+eaten);
+
+            panic_if(string[eaten] != ':',
+                     "expected a : here, but got %s",
+                     string+eaten);
+            ++eaten; // overstep :
+            eaten += eat_whitespace_and_comments(string+eaten);
+
+            Json_Type   thing_at_point = identify_thing(string+eaten);
+            Interned_Id member_id      = key_interner()->lookup(member_name, member_name_len);
+
+            const Plan_Member* found = nullptr;
+            if (member_id != INTERNED_ID_INVALID) {
+                for (u32 slot = member_id & step.member_table_mask;
+                     table[slot];
+                     slot = (slot + 1) & step.member_table_mask)
+                {
+                    const Plan_Member& member = members[table[slot]-1];
+                    if (member.key_id == member_id &&
+                        pattern_types_compatible(member.type, thing_at_point))
+                    {
+                        found = &member;
+                        break;
+                    }
+                }
+            }
+
+            Pattern_Match_Result sub_result = Pattern_Match_Result::OK_CONTINUE;
+            u32 value_length = 0;
+            if (found) {
+                Parser_Context_Stack_Entry member_context {
+                    .previous    = context,
+                    .parent_type = Parser_Context_Type::Object_Member,
+                    .parent {
+                        .object = {
+                            .member_name = String {(char*)member_name, member_name_len},
+                        }
+                    }
+                };
+                sub_result = run_plan_step(m, found->step, string+eaten, &member_context,
+                                           matched_obj, &value_length);
+                if (sub_result == Pattern_Match_Result::MATCHING_ERROR) {
+                    log_info("When matching %.*s", member_name_len, member_name);
+                    return Pattern_Match_Result::MATCHING_ERROR;
+                }
+            }
+
+            if (value_length)
+                eaten += value_length;
+            else
+                eaten += eat_thing(m->ctx, string+eaten);
+
+            if (sub_result == Pattern_Match_Result::OK_DONE)
+                eaten += eat_rest_of_construct(m->ctx, string+eaten, '}');
+
+            eaten += eat_whitespace_and_comments(string+eaten);
+
+            panic_if(string[eaten] != ',' &&
+                     string[eaten] != '}',
+                     "Expected , or } but got '%s'",
+                     string+eaten);
+
+            if (string[eaten] == ',') {
+                ++eaten;
+                eaten += eat_whitespace_and_comments(string+eaten);
+            }
+        }
+
+        ++eaten; // overstep }
+        *out_eaten = eaten;
+        return Pattern_Match_Result::OK_CONTINUE;
+    }
+
+    Pattern_Match_Result run_plan_list(Plan_Matcher* m, const Plan_Step& step, const char* string,
+                                       Parser_Context_Stack_Entry* context,
+                                       void* list_ptr, u32* out_eaten)
+    {
+        // NOTE(Felix): same as pattern_match_list
+        *out_eaten = 0;
+        u32 eaten = 1; // overstep [
+        eaten += eat_whitespace_and_comments(string+eaten);
+
+        s32 index = 0;
+        while (string[eaten] != ']') {
+            void* element = list_assure_free_slot(list_ptr, step.element_size, m->allocator);
+
+            Parser_Context_Stack_Entry element_context {
+                .previous    = context,
+                .parent_type = Parser_Context_Type::List_Entry,
+                .parent {
+                    .list_entry = {
+                        .index = index,
+                    }
+                }
+            };
+
+            u32 sub_eaten = 0;
+            Pattern_Match_Result sub_result = run_plan_step(m, step.child, string+eaten, &element_context,
+                                                            element, &sub_eaten);
+            if (sub_result == Pattern_Match_Result::MATCHING_ERROR)
+                return Pattern_Match_Result::MATCHING_ERROR;
+
+            if (sub_result == Pattern_Match_Result::OK_DONE) {
+                eaten += eat_rest_of_construct(m->ctx, string+eaten, ']');
+                *out_eaten = eaten;
+                return Pattern_Match_Result::OK_DONE;
+            }
+
+            eaten += sub_eaten;
+            eaten += eat_whitespace_and_comments(string+eaten);
+
+            panic_if(string[eaten] != ',' &&
+                     string[eaten] != ']',
+                     "expected comma or end of list here, but got %s",
+                     string+eaten);
+
+            if (string[eaten] == ',') {
+                ++eaten;
+                eaten += eat_whitespace_and_comments(string+eaten);
+            }
+            ++index;
+        }
+
+        ++eaten; // overstep ]
+        *out_eaten = eaten;
+        return Pattern_Match_Result::OK_CONTINUE;
+    }
+
+    Pattern_Match_Result run_plan_step(Plan_Matcher* m, u32 step_index, const char* string,
+                                       Parser_Context_Stack_Entry* context,
+                                       void* matched_obj, u32* out_eaten)
+    {
+        const Plan_Step& step = m->plan->steps[step_index];
+
+        if (step.op == Plan_Op::Interpret) {
+            Parser_Context call_ctx {
+                .context_stack      = *context,
+                .position_in_string = string,
+                .structural_index   = m->ctx.structural_index,
+            };
+            return pattern_match_value(call_ctx, *step.pattern, matched_obj,
+                                       m->callback_data, out_eaten, m->allocator);
+        }
+
+        // NOTE(Felix): same as pattern_match_value without the hooks
+        *out_eaten = 0;
+        u32 eaten = eat_whitespace_and_comments(string);
+
+        Json_Type thing_at_point = identify_thing(string+eaten);
+        panic_if(!pattern_types_compatible(step.type, thing_at_point),
+                 "Attempting to match objects of incompatible types.\n"
+                 "Pattern type: %d\n"
+                 "Actual  type: %d\n"
+                 "At: %s", step.type, thing_at_point, string+eaten);
+
+        u32 eaten_sub_object = 0;
+        Pattern_Match_Result sub_result = Pattern_Match_Result::OK_CONTINUE;
+
+        if (step.op == Plan_Op::Custom) {
+            panic_if(!pattern_types_match(step.type, thing_at_point),
+                     "Trying to parse a custom type expecting type %d but type was actually %d",
+                     step.type, thing_at_point);
+            eaten += step.custom_reader(string+eaten, ((u8*)matched_obj)+step.destination_offset);
+        } else if (thing_at_point == Json_Type::Object) {
+            sub_result = run_plan_object(m, step, string+eaten, context, matched_obj, &eaten_sub_object);
+        } else if (thing_at_point == Json_Type::List) {
+            sub_result = run_plan_list(m, step, string+eaten, context,
+                                       ((u8*)matched_obj) + step.destination_offset, &eaten_sub_object);
+        } else {
+            eaten += match_simple_value(step.type, step.destination_type,
+                                        ((u8*)matched_obj)+step.destination_offset,
+                                        thing_at_point, string+eaten, m->input_end, m->allocator);
+        }
+
+        if (sub_result == Pattern_Match_Result::MATCHING_ERROR)
+            return Pattern_Match_Result::MATCHING_ERROR;
+
+        eaten += eaten_sub_object;
+        if (!eaten_sub_object)
+            eaten += eat_thing(m->ctx, string+eaten);
+
+        *out_eaten = eaten;
+        return sub_result == Pattern_Match_Result::OK_DONE
+            ? Pattern_Match_Result::OK_DONE
+            : Pattern_Match_Result::OK_CONTINUE;
+    }
+
+    Pattern_Match_Result pattern_match(const char* string, const Compiled_Pattern& plan,
+                                       void* matched_obj, void* callback_data,
+                                       Allocator_Base* allocator)
+    {
+        if (!string)
+            return Pattern_Match_Result::MATCHING_ERROR;
+
+        if (!allocator)
+            allocator = grab_current_allocator();
+
+        u64 length = strlen(string);
+        Structural_Index structural_index;
+        structural_index.init(string, length, libc_allocator);
+        defer { structural_index.deinit(); };
+
+        Plan_Matcher matcher {
+            .plan          = &plan,
+            .ctx           = {
+                .context_stack      = {},
+                .position_in_string = string,
+                .structural_index   = structural_index.valid ? &structural_index : nullptr,
+            },
+            .input_end     = structural_index.valid ? structural_index.end : nullptr,
+            .callback_data = callback_data,
+            .allocator     = allocator,
+        };
+
+        Parser_Context_Stack_Entry root {};
+        u32 eaten = 0;
+        return run_plan_step(&matcher, 0, string, &root, matched_obj, &eaten);
+    }
+
+    enum struct Stream_State : u8 {
+        Before_Input,  // might still see the [ of a top level list
+        Between_Records,
+        In_Record,
+        In_Record_String,
+        In_Comment,
+        Done,
+    };
+
+    struct Record_Splitter {
+        Stream_State state;
+        Stream_State state_before_comment;
+        bool         escaped;
+        bool         pending_slash;
+        bool         top_level_list;
+        s32          depth;
+        u64          record_start;
+        u64          list_start; // of the top level list, in the current buffer
+        u64          list_end;
+    };
+
+    // NOTE(Felix): Advances the splitter over buffer[*scan_pos..length) and
+    //   stops right after a record was completed (returns true) or when the
+    //   buffer is exhausted (returns false). All state lives in the splitter,
+    //   so records can span any number of chunks.
+    bool split_next_record(Record_Splitter* sp, const char* buffer, u64 length, u64* scan_pos, bool* out_error) {
+        u64 i = *scan_pos;
+        defer { *scan_pos = i; };
+
+        for (; i < length; ++i) {
+            char c = buffer[i];
+
+            if (sp->pending_slash) {
+                sp->pending_slash = false;
+                if (c != '/') {
+                    log_error("Expected a comment after '/', got '%c'", c);
+                    *out_error = true;
+                    return false;
+                }
+                sp->state = Stream_State::In_Comment;
+                continue;
+            }
+
+            switch (sp->state) {
+                case Stream_State::In_Comment: {
+                    if (c == '\n')
+                        sp->state = sp->state_before_comment;
+                } break;
+                case Stream_State::In_Record_String: {
+                    if      (sp->escaped) sp->escaped = false;
+                    else if (c == '\\')  sp->escaped = true;
+                    else if (c == '"')   sp->state = Stream_State::In_Record;
+                } break;
+                case Stream_State::In_Record: {
+                    if (c == '"') {
+                        sp->state = Stream_State::In_Record_String;
+                    } else if (c == '/') {
+                        sp->pending_slash        = true;
+                        sp->state_before_comment = sp->state;
+                    } else if (c == '{' || c == '[') {
+                        ++sp->depth;
+                    } else if (c == '}' || c == ']') {
+                        if (--sp->depth == 0) {
+                            sp->state = Stream_State::Between_Records;
+                            ++i;
+                            return true;
+                        }
+                    }
+                } break;
+                case Stream_State::Before_Input:
+                case Stream_State::Between_Records: {
+                    if (is_whitespace(c) || (c == ',' && sp->top_level_list))
+                        break;
+                    if (c == '/') {
+                        sp->pending_slash        = true;
+                        sp->state_before_comment = sp->state;
+                        break;
+                    }
+                    if (c == '[' && sp->state == Stream_State::Before_Input) {
+                        sp->top_level_list = true;
+                        sp->list_start     = i;
+                        sp->state          = Stream_State::Between_Records;
+                        break;
+                    }
+                    if (c == ']' && sp->top_level_list) {
+                        sp->state    = Stream_State::Done;
+                        sp->list_end = i;
+                        break;
+                    }
+                    if (c == '{' || c == '[') {
+                        sp->state        = Stream_State::In_Record;
+                        sp->depth        = 1;
+                        sp->record_start = i;
+                        break;
+                    }
+                    if (sp->top_level_list)
+                        log_error("Only objects and lists can be streamed as elements of the "
+                                  "top level list, got '%c'", c);
+                    else
+                        log_error("Only objects and lists can be streamed as records, got '%c'", c);
+                    *out_error = true;
+                    return false;
+                } break;
+                case Stream_State::Done: {
+                    if (!is_whitespace(c)) {
+                        if (c == '[')
+                            log_error("Unexpected '[' after the end of the top level list, newline "
+                                      "delimited records that are lists can't be streamed");
+                        else
+                            log_error("Unexpected '%c' after the end of the top level list", c);
+                        *out_error = true;
+                        return false;
+                    }
+                } break;
+            }
+        }
+        return false;
+    }
+
+    Pattern_Match_Result pattern_match_stream(stream_reader reader, void* reader_data,
+                                              Pattern record_pattern, u32 record_size,
+                                              record_callback on_record, void* callback_data,
+                                              Allocator_Base* allocator, Hooks list_hooks)
+    {
+        if (!allocator)
+            allocator = grab_current_allocator();
+
+        const u64 chunk_size = 64 * 1024;
+
+        // NOTE(Felix): +1 so a complete record can always be NUL terminated in
+        //   place before matching it
+        u64   buffer_size  = chunk_size;
+        u64   buffer_count = 0;
+        char* buffer       = allocator->allocate<char>(buffer_size + 1);
+        void* record       = allocator->allocate_0(MAX(record_size, 1), 8);
+        defer {
+            allocator->deallocate(buffer);
+            allocator->deallocate(record);
+        };
+
+        Record_Splitter splitter {};
+        u64  scan_pos     = 0;
+        u64  record_index = 0;
+        bool end_of_input = false;
+        bool list_entered = false;
+        bool list_left    = false;
+
+        auto run_list_hook = [&](parser_hook hook, u64 position) -> Pattern_Match_Result {
+            if (!hook)
+                return Pattern_Match_Result::OK_CONTINUE;
+            Parser_Context ctx {
+                .context_stack      = {},
+                .position_in_string = buffer + position,
+                .structural_index   = nullptr,
+            };
+            return hook(nullptr, list_hooks.callback_data, {Json_Type::List}, ctx);
+        };
+
+        while (true) {
+            bool error = false;
+            bool record_complete = split_next_record(&splitter, buffer, buffer_count, &scan_pos, &error);
+
+            // NOTE(Felix): the [ comes before the first record and the ] can
+            //   only be reached by a call that did not complete a record
+            if (splitter.top_level_list && !list_entered) {
+                list_entered = true;
+                Pattern_Match_Result result = run_list_hook(list_hooks.enter_hook, splitter.list_start);
+                if (result != Pattern_Match_Result::OK_CONTINUE)
+                    return result;
+            }
+            if (splitter.state == Stream_State::Done && !list_left) {
+                list_left = true;
+                Pattern_Match_Result result = run_list_hook(list_hooks.leave_hook, splitter.list_end);
+                if (result != Pattern_Match_Result::OK_CONTINUE)
+                    return result;
+            }
+
+            if (record_complete) {
+                memset(record, 0, record_size);
+
+                char after_record = buffer[scan_pos];
+                buffer[scan_pos] = '\0';
+
+                Parser_Context_Stack_Entry context {};
+                if (splitter.top_level_list) {
+                    context.parent_type = Parser_Context_Type::List_Entry;
+                    context.parent.list_entry.index = (s32)record_index;
+                }
+                Pattern_Match_Result result =
+                    pattern_match_in_context(buffer + splitter.record_start,
+                                             scan_pos - splitter.record_start,
+                                             context, record_pattern, record,
+                                             callback_data, allocator);
+                buffer[scan_pos] = after_record;
+
+                if (result == Pattern_Match_Result::MATCHING_ERROR)
+                    return result;
+
+                result = on_record(record, record_index, callback_data);
+                ++record_index;
+                if (result != Pattern_Match_Result::OK_CONTINUE)
+                    return result;
+
+                continue;
+            }
+
+            if (error)
+                return Pattern_Match_Result::MATCHING_ERROR;
+
+            if (end_of_input) {
+                if (splitter.state == Stream_State::In_Record ||
+                    splitter.state == Stream_State::In_Record_String)
+                {
+                    log_error("Input ended in the middle of record %llu", record_index);
+                    return Pattern_Match_Result::MATCHING_ERROR;
+                }
+                if (splitter.pending_slash) {
+                    log_error("Input ended with a '/' that does not start a comment");
+                    return Pattern_Match_Result::MATCHING_ERROR;
+                }
+                if (splitter.top_level_list && splitter.state != Stream_State::Done) {
+                    log_error("Input ended before the end of the top level list");
+                    return Pattern_Match_Result::MATCHING_ERROR;
+                }
+                return Pattern_Match_Result::OK_CONTINUE;
+            }
+
+            // NOTE(Felix): drop everything before the current record (or
+            //   everything, if we are between records) to make room
+            u64 keep_from = scan_pos;
+            if (splitter.state == Stream_State::In_Record ||
+                splitter.state == Stream_State::In_Record_String ||
+                (splitter.state == Stream_State::In_Comment &&
+                 splitter.state_before_comment == Stream_State::In_Record))
+            {
+                keep_from = splitter.record_start;
+            }
+            memmove(buffer, buffer + keep_from, buffer_count - keep_from);
+            buffer_count          -= keep_from;
+            scan_pos              -= keep_from;
+            splitter.record_start -= MIN(splitter.record_start, keep_from);
+            splitter.list_start   -= MIN(splitter.list_start,   keep_from);
+            splitter.list_end     -= MIN(splitter.list_end,     keep_from);
+
+            // NOTE(Felix): the current record does not fit, grow the buffer
+            if (buffer_size - buffer_count < chunk_size / 2) {
+                buffer_size *= 2;
+                buffer = allocator->resize<char>(buffer, buffer_size + 1);
+            }
+
+            u64 read = reader(reader_data, buffer + buffer_count, buffer_size - buffer_count);
+            if (read == STREAM_READ_ERROR) {
+                log_error("Reading record %llu failed", record_index);
+                return Pattern_Match_Result::MATCHING_ERROR;
+            }
+            if (read == 0)
+                end_of_input = true;
+            buffer_count += read;
+        }
+    }
+
+    Pattern_Match_Result pattern_match_stream(FILE* file,
+                                              Pattern record_pattern, u32 record_size,
+                                              record_callback on_record, void* callback_data,
+                                              Allocator_Base* allocator, Hooks list_hooks)
+    {
+        return pattern_match_stream(
+            [](void* reader_data, char* buffer, u64 buffer_size) -> u64 {
+                u64 read = fread(buffer, 1, buffer_size, (FILE*)reader_data);
+                if (read == 0 && ferror((FILE*)reader_data))
+                    return STREAM_READ_ERROR;
+                return read;
+            }, file, record_pattern, record_size, on_record, callback_data, allocator, list_hooks);
+    }
+
+    Pattern_Match_Result pattern_match_stream_fd(int fd,
+                                                 Pattern record_pattern, u32 record_size,
+                                                 record_callback on_record, void* callback_data,
+                                                 Allocator_Base* allocator, Hooks list_hooks)
+    {
+        return pattern_match_stream(
+            [](void* reader_data, char* buffer, u64 buffer_size) -> u64 {
+                int fd = (int)(s64)reader_data;
+                s64 read;
+                do {
+#ifdef FTB_WINDOWS
+                    read = _read(fd, buffer, (unsigned)MIN(buffer_size, 0x7fffffff));
+#else
+                    read = ::read(fd, buffer, buffer_size);
+#endif
+                } while (read < 0 && errno == EINTR);
+                return read < 0 ? STREAM_READ_ERROR : (u64)read;
+            }, (void*)(s64)fd, record_pattern, record_size, on_record, callback_data, allocator, list_hooks);
+    }
+
+    // Pattern member_value(const char* key, Json_Type source_type, Data_Type destination_type, u32 destination_offset) {
+    //     Pattern p = Pattern {
+    //         .type     = Json_Type::Object_Member_Name,
+    //         .member   = { .name = key },
+    //         .children = Array_List<Pattern>::create_from({
+    //             {
+    //                 .type = source_type,
+    //                 .value = {
+    //                     .destination_type   = destination_type,
+    //                     .destination_offset = destination_offset
+    //                 }
+    //             }
+    //             })
+    //     };
+    //     return p;
+    // }
+
+
+    Pattern p_str(u32 offset, Hooks hooks) {
+        Pattern p = Pattern {
+            .type  = Json_Type::String,
+            .value = {
+                .destination_type   = Data_Type::String,
+                .destination_offset = offset
+            },
+            .hooks = hooks
+        };
+        return p;
+    }
+
+    Pattern p_str_view(u32 offset, Hooks hooks) {
+        Pattern p = Pattern {
+            .type  = Json_Type::String,
+            .value = {
+                .destination_type   = Data_Type::String_View,
+                .destination_offset = offset
+            },
+            .hooks = hooks
+        };
+        return p;
+    }
+
+    Pattern p_s32(u32 offset, Hooks hooks) {
+        Pattern p = Pattern {
+            .type  = Json_Type::Number,
+            .value = {
+                .destination_type   = Data_Type::Integer,
+                .destination_offset = offset
+            },
+            .hooks = hooks
+        };
+
+        return p;
+    }
+
+    Pattern p_s64(u32 offset, Hooks hooks) {
+        Pattern p = Pattern {
+            .type  = Json_Type::Number,
+            .value = {
+                .destination_type   = Data_Type::Long,
+                .destination_offset = offset
+            },
+            .hooks = hooks
+        };
+
+        return p;
+    }
+
+    Pattern p_f32(u32 offset, Hooks hooks) {
+        Pattern p = Pattern {
+            .type  = Json_Type::Number,
+            .value = {
+                .destination_type   = Data_Type::Float,
+                .destination_offset = offset
+            },
+            .hooks = hooks
+        };
+
+        return p;
+    }
+
+    Pattern p_bool(u32 offset, Hooks hooks) {
+        Pattern p = Pattern {
+            .type  = Json_Type::Boolean,
+            .value = {
+                .destination_type   = Data_Type::Boolean,
+                .destination_offset = offset
+            },
+            .hooks = hooks
+        };
+        return p;
+    }
+
+    Pattern object(std::initializer_list<Object_Member> members, Fallback_Pattern fallback_pattern, Hooks hooks) {
+        Pattern p = Pattern {
             .type = Json_Type::Object,
             .hooks = hooks
         };
@@ -914,8 +2850,26 @@ namespace json {
             const Object_Member* it = members.begin();
             for (u64 i = 0; i < p.object.member_count; ++i) {
                 p.object.members[i] = *it;
+                p.object.members[i].key_id = key_interner()->intern(it->key);
                 ++it;
             }
+
+            // NOTE(Felix): Keys of one object are usually interned together
+            //   and get consecutive ids, so indexing with the low bits of the
+            //   id rarely collides. The load factor stays at or below 1/2.
+            u32 index_size = 4;
+            while (index_size < p.object.member_count * 2)
+                index_size *= 2;
+
+            p.object.member_index      = temp->allocate_0<u32>(index_size);
+            p.object.member_index_mask = index_size - 1;
+
+            for (u32 i = 0; i < p.object.member_count; ++i) {
+                u32 slot = p.object.members[i].key_id & p.object.member_index_mask;
+                while (p.object.member_index[slot])
+                    slot = (slot + 1) & p.object.member_index_mask;
+                p.object.member_index[slot] = i + 1;
+            }
         }
 
         if (fallback_pattern.pattern.type != Json_Type::Invalid) {
@@ -976,80 +2930,115 @@ namespace json {
     }
 
 
-    void write_pattern_to_file(FILE* path, Pattern pattern, void* user_data);
-    void write_bool_to_file(FILE* out, u32 offset, void* data) {
+    void write_bool_to_sink(Print_Sink* out, u32 offset, void* data) {
         bool* b = (bool*)(((byte*)data)+offset);
-        fprintf(out, *b ? "true" : "false");
+        if (*b) out->write("true",  4);
+        else    out->write("false", 5);
     }
 
-    void write_int_to_file(FILE* out, u32 offset, void* data) {
+    void write_int_to_sink(Print_Sink* out, u32 offset, void* data) {
         int* i = (int*)(((byte*)data)+offset);
-        fprintf(out, "%d", *i);
+        char buffer[24];
+        out->write(buffer, format_s64(*i, buffer));
     }
 
-    void write_long_to_file(FILE* out, u32 offset, void* data) {
+    void write_long_to_sink(Print_Sink* out, u32 offset, void* data) {
         s64* i = (s64*)(((byte*)data)+offset);
-        fprintf(out, "%Id", *i);
+        char buffer[24];
+        out->write(buffer, format_s64(*i, buffer));
     }
 
-    void write_float_to_file(FILE* out, u32 offset, void* data) {
+    void write_float_to_sink(Print_Sink* out, u32 offset, void* data) {
         float* f = (float*)(((byte*)data)+offset);
-        fprintf(out, "%g", *f);
+        char buffer[32];
+        out->write(buffer, format_f32(*f, buffer));
     }
 
-    void write_string_to_file(FILE* out, u32 offset, void* data) {
+    // NOTE(Felix): strings are unescaped when they are read, so quotes,
+    //   backslashes and control characters are escaped again here. Runs of
+    //   chars that need no escaping are written in one go.
+    void write_string_to_sink(Print_Sink* out, u32 offset, void* data) {
         String* s = (String*)(((byte*)data)+offset);
-        fprintf(out, "\"%*s\"", (int)s->length, s->data);
+        out->put('"');
+
+        u64 run_start = 0;
+        for (u64 i = 0; i < s->length; ++i) {
+            u8 c = (u8)s->data[i];
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+
+            out->write(s->data + run_start, i - run_start);
+            run_start = i+1;
+
+            switch (c) {
+                case '"':  out->write("\\\"", 2); break;
+                case '\\': out->write("\\\\", 2); break;
+                case '\n': out->write("\\n", 2);  break;
+                case '\r': out->write("\\r", 2);  break;
+                case '\t': out->write("\\t", 2);  break;
+                case '\b': out->write("\\b", 2);  break;
+                case '\f': out->write("\\f", 2);  break;
+                default: {
+                    const char* hex = "0123456789abcdef";
+                    char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+                    out->write(escaped, sizeof(escaped));
+                } break;
+            }
+        }
+        out->write(s->data + run_start, s->length - run_start);
+
+        out->put('"');
     }
 
-    void write_list_to_file(FILE* out, u32 array_list_offset,
+    void write_list_to_sink(Print_Sink* out, u32 array_list_offset,
                             u32 element_size, Pattern child_pattern, void* data)
     {
         Array_List<void*>* list_p = (Array_List<void*>*)(((byte*)data)+array_list_offset);
-        fprintf(out, "[");
+        out->put('[');
 
         void* element_pointer = list_p->data;
         if (list_p->count != 0) {
-            write_pattern_to_file(out, child_pattern, element_pointer);
+            write_pattern_to_sink(out, child_pattern, element_pointer);
         }
 
         for (u32 i = 1; i < list_p->count; ++i) {
             element_pointer = ((u8*)element_pointer)+element_size;
-            fprintf(out, ", ");
-            write_pattern_to_file(out, child_pattern, element_pointer);
+            out->write(", ", 2);
+            write_pattern_to_sink(out, child_pattern, element_pointer);
         }
 
-        fprintf(out, "]");
+        out->put(']');
     }
 
 
-    void write_object_to_file(FILE* out, const Object_Member* members, u32 member_count, void* data)
+    void write_object_to_sink(Print_Sink* out, const Object_Member* members, u32 member_count, void* data)
     {
-        auto print_one_key_value_pair = [&](Object_Member om) {
-            fprintf(out, "\"%s\" : ", om.key);
-            write_pattern_to_file(out, om.pattern, data);
-        };
-
-        fprintf(out, "{");
+        out->put('{');
 
+        bool first_written = true;
         for (u32 i = 0; i < member_count; ++i) {
             const Object_Member om = members[i];
 
-            if (i != 0) {
-                fprintf(out, ", ");
-            }
-
             bool member_should_be_written = true;
             if (om.pattern.hooks.custom_writer_selection) {
                 u8* offset_data = ((u8*)data) + om.pattern.value.destination_offset;
                 member_should_be_written &= om.pattern.hooks.custom_writer_selection(offset_data);
             }
 
-            if (member_should_be_written)
-                print_one_key_value_pair(om);
+            if (!member_should_be_written)
+                continue;
+
+            if (!first_written)
+                out->write(", ", 2);
+            first_written = false;
+
+            out->put('"');
+            out->write(om.key, strlen(om.key));
+            out->write("\" : ", 4);
+            write_pattern_to_sink(out, om.pattern, data);
         }
 
-        fprintf(out, "}");
+        out->put('}');
     }
 
 
@@ -1057,27 +3046,20 @@ namespace json {
         if (!allocator)
             allocator = grab_current_allocator();
 
-        FILE* t_file = tmpfile();
-        if (!t_file) {
-            return {};
-        }
+        char stack_buffer[1024];
+        Print_Sink sink;
+        sink.init_string(allocator, stack_buffer, sizeof(stack_buffer));
 
-        write_pattern_to_file(t_file, pattern, user_data);
+        write_pattern_to_sink(&sink, pattern, user_data);
 
         Allocated_String ret {};
-        ret.string.length    = ftell(t_file) + 1;
-
-        rewind(t_file);
-
         ret.allocator = allocator;
-        ret.string.data      = allocator->allocate<char>((u32)ret.string.length);
-        ret.string.length    = fread(ret.string.data, sizeof(char), ret.string.length, t_file);
-        ret.string.data[ret.string.length] = '\0';
+        ret.string    = sink.finish();
 
         return ret;
     }
 
-    void write_pattern_to_file(FILE* out, Pattern pattern, void* user_data) {
+    void write_pattern_to_sink(Print_Sink* out, Pattern pattern, void* user_data) {
         if (pattern.hooks.custom_reader || pattern.hooks.custom_writer) {
             void* offset_user_data = ((u8*)user_data) + pattern.value.destination_offset;
             if (!pattern.hooks.custom_writer) {
@@ -1089,29 +3071,29 @@ namespace json {
         }
 
         switch (pattern.type) {
-            case Json_Type::Null: fprintf(out, "null"); break;
+            case Json_Type::Null: out->write("null", 4); break;
             case Json_Type::Boolean: {
-                write_bool_to_file(out, pattern.value.destination_offset, user_data);
+                write_bool_to_sink(out, pattern.value.destination_offset, user_data);
             } break;
             case Json_Type::String: {
-                write_string_to_file(out, pattern.value.destination_offset, user_data);
+                write_string_to_sink(out, pattern.value.destination_offset, user_data);
             } break;
             case Json_Type::Number: {
                 if (pattern.value.destination_type == Data_Type::Integer) {
-                    write_int_to_file(out, pattern.value.destination_offset, user_data);
+                    write_int_to_sink(out, pattern.value.destination_offset, user_data);
                 } else if (pattern.value.destination_type == Data_Type::Long) {
-                    write_long_to_file(out, pattern.value.destination_offset, user_data);
+                    write_long_to_sink(out, pattern.value.destination_offset, user_data);
                 } else {
-                    write_float_to_file(out, pattern.value.destination_offset, user_data);
+                    write_float_to_sink(out, pattern.value.destination_offset, user_data);
                 }
             } break;
             case Json_Type::List: {
-                write_list_to_file(out, pattern.list.array_list_offset,
+                write_list_to_sink(out, pattern.list.array_list_offset,
                                    pattern.list.element_size,
                                    *pattern.list.child_pattern, user_data);
             } break;
             case Json_Type::Object: {
-                write_object_to_file(out, pattern.object.members,
+                write_object_to_sink(out, pattern.object.members,
                                      pattern.object.member_count, user_data);
             } break;
             default: panic("Don't know how to print json object with type %d",
@@ -1126,9 +3108,337 @@ namespace json {
             return;
         }
         defer { fclose(out); };
-        write_pattern_to_file(out, pattern, user_data);
+
+        char buffer[4096];
+        Print_Sink sink;
+        sink.init_file(out, buffer, sizeof(buffer));
+        write_pattern_to_sink(&sink, pattern, user_data);
+        sink.flush();
+    }
+
+    // ----------------------------------------------------------------------------
+    //                              binary encoding
+    // ----------------------------------------------------------------------------
+    inline u64 zigzag_encode(s64 value) {
+        return ((u64)value << 1) ^ (u64)(value >> 63);
+    }
+
+    inline s64 zigzag_decode(u64 value) {
+        return (s64)(value >> 1) ^ -(s64)(value & 1);
+    }
+
+    void binary_write_varint(Print_Sink* out, u64 value) {
+        char buffer[10];
+        u32  length = 0;
+        while (value >= 0x80) {
+            buffer[length++] = (char)(value | 0x80);
+            value >>= 7;
+        }
+        buffer[length++] = (char)value;
+        out->write(buffer, length);
+    }
+
+    bool object_has_writer_selection(const Pattern& pattern) {
+        for (u32 i = 0; i < pattern.object.member_count; ++i) {
+            if (pattern.object.members[i].pattern.hooks.custom_writer_selection)
+                return true;
+        }
+        return false;
+    }
+
+    bool member_should_be_written(const Object_Member& om, void* data) {
+        if (!om.pattern.hooks.custom_writer_selection)
+            return true;
+        u8* offset_data = ((u8*)data) + om.pattern.value.destination_offset;
+        return om.pattern.hooks.custom_writer_selection(offset_data);
+    }
+
+    void write_pattern_to_binary(Print_Sink* out, Pattern pattern, void* user_data) {
+        if (pattern.hooks.custom_binary_writer) {
+            pattern.hooks.custom_binary_writer(out, ((u8*)user_data) + pattern.value.destination_offset);
+            return;
+        }
+
+        if (pattern.hooks.custom_reader || pattern.hooks.custom_writer) {
+            panic_if(!pattern.hooks.custom_writer, "No custom writer set");
+
+            void* offset_user_data = ((u8*)user_data) + pattern.value.destination_offset;
+
+            char stack_buffer[256];
+            Print_Sink text;
+            text.init_string(nullptr, stack_buffer, sizeof(stack_buffer));
+            defer { text.deinit(); };
+
+            pattern.hooks.custom_writer(&text, offset_user_data);
+            binary_write_varint(out, text.count);
+            out->write(text.data, text.count);
+            return;
+        }
+
+        switch (pattern.type) {
+            case Json_Type::Null: break;
+            case Json_Type::List: {
+                Array_List<byte>* list = (Array_List<byte>*)(((byte*)user_data)+pattern.list.array_list_offset);
+                binary_write_varint(out, list->count);
+                for (u32 i = 0; i < list->count; ++i) {
+                    write_pattern_to_binary(out, *pattern.list.child_pattern,
+                                            list->data + (u64)i * pattern.list.element_size);
+                }
+            } break;
+            case Json_Type::Object: {
+                const Object_Member* members = pattern.object.members;
+                u32 member_count = pattern.object.member_count;
+
+                if (object_has_writer_selection(pattern)) {
+                    for (u32 byte_start = 0; byte_start < member_count; byte_start += 8) {
+                        u8 bits = 0;
+                        for (u32 i = byte_start; i < member_count && i < byte_start + 8; ++i) {
+                            if (member_should_be_written(members[i], user_data))
+                                bits |= (u8)(1 << (i - byte_start));
+                        }
+                        out->put((char)bits);
+                    }
+                }
+
+                for (u32 i = 0; i < member_count; ++i) {
+                    if (member_should_be_written(members[i], user_data))
+                        write_pattern_to_binary(out, members[i].pattern, user_data);
+                }
+            } break;
+            case Json_Type::String:
+            case Json_Type::Number:
+            case Json_Type::Boolean: {
+                void* value = ((byte*)user_data) + pattern.value.destination_offset;
+                switch (pattern.value.destination_type) {
+                    case Data_Type::Integer: binary_write_varint(out, zigzag_encode(*(s32*)value)); break;
+                    case Data_Type::Long:    binary_write_varint(out, zigzag_encode(*(s64*)value)); break;
+                    case Data_Type::Boolean: out->put(*(bool*)value ? 1 : 0); break;
+                    case Data_Type::Float: {
+                        u32 bits;
+                        memcpy(&bits, value, sizeof(bits));
+                        char bytes[4] = {
+                            (char)bits, (char)(bits >> 8), (char)(bits >> 16), (char)(bits >> 24)
+                        };
+                        out->write(bytes, 4);
+                    } break;
+                    case Data_Type::String:
+                    case Data_Type::String_View: {
+                        String* str = (String*)value;
+                        binary_write_varint(out, str->length);
+                        out->write(str->data, str->length);
+                    } break;
+                    default: panic("dtype %u not implemented", (u8)pattern.value.destination_type - (u8)(1<<7));
+                }
+            } break;
+            default: {
+                // NOTE(Felix): Object_As_Hash_Map has no binary encoding,
+                //   reading it back fails
+                log_error("Don't know how to write json object with type %d as binary",
+                          pattern.type);
+            } break;
+        }
+    }
+
+    Allocated_String write_pattern_to_binary(Pattern pattern, void* user_data, Allocator_Base* allocator) {
+        if (!allocator)
+            allocator = grab_current_allocator();
+
+        char stack_buffer[1024];
+        Print_Sink sink;
+        sink.init_string(allocator, stack_buffer, sizeof(stack_buffer));
+
+        write_pattern_to_binary(&sink, pattern, user_data);
+
+        Allocated_String ret {};
+        ret.allocator = allocator;
+        ret.string    = sink.finish();
+
+        return ret;
+    }
+
+    struct Binary_Reader {
+        const u8*       cursor;
+        const u8*       end;
+        Allocator_Base* allocator;
+    };
+
+    bool binary_read_varint(Binary_Reader* reader, u64* out_value) {
+        u64 value = 0;
+        for (u32 shift = 0; shift < 64; shift += 7) {
+            if (reader->cursor == reader->end)
+                return false;
+            u8 b = *reader->cursor++;
+            value |= (u64)(b & 0x7f) << shift;
+            if (!(b & 0x80)) {
+                *out_value = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool binary_read_bytes(Binary_Reader* reader, u64 length, const u8** out_bytes) {
+        if ((u64)(reader->end - reader->cursor) < length)
+            return false;
+        *out_bytes = reader->cursor;
+        reader->cursor += length;
+        return true;
+    }
+
+    Pattern_Match_Result binary_match_value(Binary_Reader* reader, Pattern pattern, void* matched_obj) {
+        const Pattern_Match_Result error = Pattern_Match_Result::MATCHING_ERROR;
+        const Pattern_Match_Result ok    = Pattern_Match_Result::OK_CONTINUE;
+
+        if (pattern.hooks.custom_binary_reader) {
+            u32 read = pattern.hooks.custom_binary_reader(reader->cursor, reader->end,
+                                                          ((u8*)matched_obj) + pattern.value.destination_offset);
+            if (read == (u32)-1)
+                return error;
+            reader->cursor += read;
+            return ok;
+        }
+
+        if (pattern.hooks.custom_reader || pattern.hooks.custom_writer) {
+            panic_if(!pattern.hooks.custom_reader, "No custom reader set");
+
+            u64 length;
+            const u8* text;
+            if (!binary_read_varint(reader, &length) || !binary_read_bytes(reader, length, &text))
+                return error;
+
+            // NOTE(Felix): custom readers expect zero terminated json
+            Scratch_Arena scratch = scratch_arena_start();
+            defer { scratch_arena_end(scratch); };
+
+            char* terminated = scratch.arena->allocate<char>(length+1);
+            memcpy(terminated, text, length);
+            terminated[length] = '\0';
+
+            pattern.hooks.custom_reader(terminated, ((u8*)matched_obj) + pattern.value.destination_offset);
+            return ok;
+        }
+
+        switch (pattern.type) {
+            case Json_Type::Null: return ok;
+            case Json_Type::List: {
+                u64 count;
+                if (!binary_read_varint(reader, &count))
+                    return error;
+
+                void* list_ptr = ((u8*)matched_obj) + pattern.list.array_list_offset;
+                u32 element_size = pattern.list.element_size;
+
+                // NOTE(Felix): make room for all elements at once, but don't
+                //   trust counts that can't possibly fit into the input
+                Array_List<byte>* list = (Array_List<byte>*)list_ptr;
+                u64 expected = MIN(count, (u64)(reader->end - reader->cursor));
+                if (element_size != 0 && list->length < list->count + expected) {
+                    u32 old_allocated = list->length;
+                    list->length = (u32)(list->count + expected);
+                    list->data   = (byte*)realloc_zero(list->data, old_allocated * element_size,
+                                                       list->length * element_size, reader->allocator);
+                    list->allocator = reader->allocator;
+                }
+
+                for (u64 i = 0; i < count; ++i) {
+                    void* element = list_assure_free_slot(list_ptr, element_size, reader->allocator);
+                    if (binary_match_value(reader, *pattern.list.child_pattern, element) == error)
+                        return error;
+                }
+                return ok;
+            }
+            case Json_Type::Object: {
+                const Object_Member* members = pattern.object.members;
+                u32 member_count = pattern.object.member_count;
+
+                const u8* present = nullptr;
+                if (object_has_writer_selection(pattern)) {
+                    if (!binary_read_bytes(reader, (member_count + 7) / 8, &present))
+                        return error;
+                }
+
+                for (u32 i = 0; i < member_count; ++i) {
+                    if (present && !(present[i / 8] & (1 << (i % 8))))
+                        continue;
+                    if (binary_match_value(reader, members[i].pattern, matched_obj) == error)
+                        return error;
+                }
+                return ok;
+            }
+            case Json_Type::String:
+            case Json_Type::Number:
+            case Json_Type::Boolean: {
+                void* value = ((byte*)matched_obj) + pattern.value.destination_offset;
+                switch (pattern.value.destination_type) {
+                    case Data_Type::Integer:
+                    case Data_Type::Long: {
+                        u64 encoded;
+                        if (!binary_read_varint(reader, &encoded))
+                            return error;
+                        if (pattern.value.destination_type == Data_Type::Integer)
+                            *(s32*)value = (s32)zigzag_decode(encoded);
+                        else
+                            *(s64*)value = zigzag_decode(encoded);
+                    } break;
+                    case Data_Type::Boolean: {
+                        const u8* b;
+                        if (!binary_read_bytes(reader, 1, &b))
+                            return error;
+                        *(bool*)value = *b != 0;
+                    } break;
+                    case Data_Type::Float: {
+                        const u8* b;
+                        if (!binary_read_bytes(reader, 4, &b))
+                            return error;
+                        u32 bits = (u32)b[0] | ((u32)b[1] << 8) | ((u32)b[2] << 16) | ((u32)b[3] << 24);
+                        memcpy(value, &bits, sizeof(bits));
+                    } break;
+                    case Data_Type::String:
+                    case Data_Type::String_View: {
+                        u64 length;
+                        const u8* bytes;
+                        if (!binary_read_varint(reader, &length) || !binary_read_bytes(reader, length, &bytes))
+                            return error;
+                        String* str = (String*)value;
+                        str->length = length;
+                        if (pattern.value.destination_type == Data_Type::String_View)
+                            str->data = (char*)bytes;
+                        else
+                            str->data = heap_copy_limited_c_string((const char*)bytes, (u32)length, reader->allocator);
+                    } break;
+                    default: panic("dtype %u not implemented", (u8)pattern.value.destination_type - (u8)(1<<7));
+                }
+                return ok;
+            }
+            default: {
+                // NOTE(Felix): Object_As_Hash_Map has no binary encoding
+                log_error("Don't know how to read json object with type %d from binary",
+                          pattern.type);
+            } break;
+        }
+        return error;
+    }
+
+    Pattern_Match_Result pattern_match_binary(const void* data, u64 length, Pattern pattern,
+                                              void* matched_obj, Allocator_Base* allocator,
+                                              u64* out_read)
+    {
+        if (!allocator)
+            allocator = grab_current_allocator();
+
+        Binary_Reader reader {
+            .cursor    = (const u8*)data,
+            .end       = (const u8*)data + length,
+            .allocator = allocator,
+        };
+
+        Pattern_Match_Result result = binary_match_value(&reader, pattern, matched_obj);
+        if (out_read)
+            *out_read = reader.cursor - (const u8*)data;
+        return result;
     }
 
+
     void Pattern::print() {
         switch (type) {
             case Json_Type::Boolean:            raw_print("bool");          break;
@@ -323,9 +323,9 @@ struct Kd_Tree {
         // Descend on side of split planes where the point lies.
         bool point_is_on_left = point[ node->axis] <= node->point[node->axis];
         if (point_is_on_left) {
-            find_nearest_neighbor_rec(point, out_dist_to_neighbor, out_neighbor_pos, node->left_idx);
+            find_nearest_neighbor_rec(point, out_dist_to_neighbor, out_neighbor_pos, out_neighbor_payload, node->left_idx);
         } else {
-            find_nearest_neighbor_rec(point, out_dist_to_neighbor, out_neighbor_pos, node->right_idx);
+            find_nearest_neighbor_rec(point, out_dist_to_neighbor, out_neighbor_pos, out_neighbor_payload, node->right_idx);
         }
 
         // Compute the distance of this node to the point.
@@ -341,10 +341,10 @@ struct Kd_Tree {
 
         // Check whether there could be a closer point on the opposite side.
         if (point_is_on_left && point[node->axis] + *out_dist_to_neighbor >= node->point[node->axis]) {
-            find_nearest_neighbor_rec(point, out_dist_to_neighbor, out_neighbor_pos, node->right_idx);
+            find_nearest_neighbor_rec(point, out_dist_to_neighbor, out_neighbor_pos, out_neighbor_payload, node->right_idx);
         }
         if (!point_is_on_left && point[node->axis] - *out_dist_to_neighbor <= node->point[node->axis]) {
-            find_nearest_neighbor_rec(point, out_dist_to_neighbor, out_neighbor_pos, node->left_idx);
+            find_nearest_neighbor_rec(point, out_dist_to_neighbor, out_neighbor_pos, out_neighbor_payload, node->left_idx);
         }
     }
 };
@@ -582,20 +582,20 @@ inline auto hm_objects_match(Vertex_Fingerprint a, Vertex_Fingerprint b) -> bool
         && a.norm_i == b.norm_i;
 }
 
-auto read_vertex_fingerprint(const char** cursor, Vertex_Fingerprint* out_vfp) -> void {
+auto read_vertex_fingerprint(const char** cursor, const char* eof, Vertex_Fingerprint* out_vfp) -> void {
     // NOTE(Felix): all the indices in the obj file start at 1, so we subtract
     //   1 of all after reading.
-    (*cursor) += read_long(*cursor, (s64*)&(out_vfp->pos_i));
+    (*cursor) += read_long(*cursor, eof, (s64*)&(out_vfp->pos_i));
     --(out_vfp->pos_i);
 
     if (*cursor[0] == '/') {
         ++(*cursor); // overstep slash
-        (*cursor) += read_long(*cursor, (s64*)&(out_vfp->uv_i));
+        (*cursor) += read_long(*cursor, eof, (s64*)&(out_vfp->uv_i));
         --(out_vfp->uv_i);
 
         if (*cursor[0] == '/') {
             ++(*cursor); // overstep slash
-            (*cursor) += read_long(*cursor, (s64*)&(out_vfp->norm_i));
+            (*cursor) += read_long(*cursor, eof, (s64*)&(out_vfp->norm_i));
             --(out_vfp->norm_i);
         } else {
             out_vfp->norm_i = -1;
@@ -645,9 +645,9 @@ auto load_obj_from_in_memory_string(const char* cursor, const char* eof) -> Mesh
                 if (*cursor == ' ') {
                     // vertex pos
                     ++cursor;
-                    cursor += read_float(cursor, &x);
-                    cursor += read_float(cursor, &y);
-                    cursor += read_float(cursor, &z);
+                    cursor += read_float(cursor, eof, &x);
+                    cursor += read_float(cursor, eof, &y);
+                    cursor += read_float(cursor, eof, &z);
 
                     // skip optional 4th component, or vertex colors
                     cursor += eat_line(cursor);
@@ -656,15 +656,15 @@ auto load_obj_from_in_memory_string(const char* cursor, const char* eof) -> Mesh
                 } else if (*cursor == 'n') {
                     // vertex normal
                     ++cursor;
-                    cursor += read_float(cursor, &x);
-                    cursor += read_float(cursor, &y);
-                    cursor += read_float(cursor, &z);
+                    cursor += read_float(cursor, eof, &x);
+                    cursor += read_float(cursor, eof, &y);
+                    cursor += read_float(cursor, eof, &z);
                     normals.extend({x, y, z});
                 } else if (*cursor == 't') {
                     // vertex texture corrds
                     ++cursor;
-                    cursor += read_float(cursor, &u);
-                    cursor += read_float(cursor, &v);
+                    cursor += read_float(cursor, eof, &u);
+                    cursor += read_float(cursor, eof, &v);
                     v = 1 - v; // NOTE(Felix): Invert v, because in blender v goes up
                     uvs.extend({u, v});
                 } else {
@@ -676,7 +676,7 @@ auto load_obj_from_in_memory_string(const char* cursor, const char* eof) -> Mesh
                 ++cursor;
                 Vertex_Fingerprint vfp {};
                 for (u32 i = 0; i < 3; ++i) {
-                    read_vertex_fingerprint(&cursor, &vfp);
+                    read_vertex_fingerprint(&cursor, eof, &vfp);
                     fprints.append(vfp);
                 }
                 {
@@ -684,7 +684,7 @@ auto load_obj_from_in_memory_string(const char* cursor, const char* eof) -> Mesh
                     cursor += eat_whitespace(cursor);
                     u32 first = fprints.count-3;
                     while (*cursor >= '0' && *cursor <= '9') {
-                        read_vertex_fingerprint(&cursor, &vfp);
+                        read_vertex_fingerprint(&cursor, eof, &vfp);
 
                         fprints.append(fprints[first]);
                         fprints.append(fprints[fprints.count-2]);
@@ -748,17 +748,15 @@ auto load_obj_from_in_memory_string(const char* cursor, const char* eof) -> Mesh
 }
 
 auto load_obj(const char* path) -> Mesh_Data {
-    File_Read obj_str_read = read_entire_file(path);
-    if (!obj_str_read.success)
+    Mapped_File obj_file = map_entire_file(path);
+    if (!obj_file.success)
         return {};
-
-    Allocated_String obj_str = obj_str_read.contents;
-    defer{
-        obj_str.free();
+    defer {
+        unmap_file(&obj_file);
     };
 
-    char* cursor = obj_str.string.data;
-    char* eof    = obj_str.string.data + obj_str.string.length;
+    const char* cursor = obj_file.contents.data;
+    const char* eof    = obj_file.contents.data + obj_file.contents.length;
     Mesh_Data data =  load_obj_from_in_memory_string(cursor, eof);
     if (data.vertices.count == 0)
         log_error("error while reading '%s'", path);
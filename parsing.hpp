@@ -9,7 +9,8 @@ enum struct Data_Type : u8 {
     Float,
     Boolean,
     Maybe_Integer,
-    Maybe_Boolean
+    Maybe_Boolean,
+    String_View,
 };
 
 
@@ -21,11 +22,25 @@ bool is_whitespace(const char c);
 
 u32 read_identifier(const char* str, String* out_string, Allocator_Base* allocator = nullptr);
 u32 read_string(const char* str, String* out_string, Allocator_Base* allocator = nullptr);
+// NOTE(Felix): Like read_string, but if the string has no escapes, out_string
+//   points right into `str` (and is not NUL terminated). Only strings that
+//   have to be unescaped are allocated.
+u32 read_string_view(const char* str, String* out_string, Allocator_Base* allocator = nullptr);
+u32 unescape_string(const char* str, u32 length, char* out);
 u32 read_int(const char* str, s32* out_int);
 u32 read_long(const char* str, s64* out_int);
 u32 read_bool(const char* str, bool* out_bool);
 u32 read_float(const char* str, f32* out_float);
 
+// NOTE(Felix): The number readers don't depend on the locale and round
+//   correctly (floats are parsed Eisel-Lemire style, falling back to strtof
+//   only for more than 19 significant digits and other rare cases). If the end
+//   of the buffer is known, runs of digits are parsed 8 at a time (SWAR); the
+//   versions without `end` never read past the NUL terminator.
+u32 read_int(const char* str, const char* end, s32* out_int);
+u32 read_long(const char* str, const char* end, s64* out_long);
+u32 read_float(const char* str, const char* end, f32* out_float);
+
 u32 eat_line(const char* str);
 u32 eat_construct(const char* string, char delimiter);
 u32 eat_whitespace(const char* str);
@@ -111,7 +126,10 @@ u32 eat_number(const char* str) {
         ++eaten;
         while (is_number_char(str[eaten]))
             ++eaten;
-    } else if (str[eaten] == 'e') {
+    }
+
+    if (str[eaten] == 'e' || str[eaten] == 'E') {
+        ++eaten;
         if (str[eaten] == '+'
             || str[eaten] == '-')
             ++eaten;
@@ -169,9 +187,94 @@ u32 read_string(const char* str, String* out_string, Allocator_Base* allocator)
     // NOTE(Felix): Assumes we are on a " or '
     u32 length = eat_string(str);
 
-    // TODO(Felix): unescape string
-    out_string->data = heap_copy_limited_c_string(str+1, length-2, allocator); // quotes are not part of the string
-    out_string->length = length-2;
+    // NOTE(Felix): quotes are not part of the string
+    const char* content        = str+1;
+    u32         content_length = length-2;
+
+    out_string->data   = allocator->allocate<char>(content_length+1);
+    out_string->length = unescape_string(content, content_length, out_string->data);
+    out_string->data[out_string->length] = '\0';
+
+    return length;
+}
+
+u32 unescape_string(const char* str, u32 length, char* out) {
+    // NOTE(Felix): `out` needs room for `length` bytes, unescaping never makes
+    //   a string longer. Returns the number of bytes written.
+    auto hex_value = [](const char* hex, u32* out_value) -> bool {
+        u32 value = 0;
+        for (u32 i = 0; i < 4; ++i) {
+            char c = hex[i];
+            value <<= 4;
+            if      (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return false;
+        }
+        *out_value = value;
+        return true;
+    };
+
+    u32 written = 0;
+    for (u32 i = 0; i < length; ++i) {
+        if (str[i] != '\\' || i+1 == length) {
+            out[written++] = str[i];
+            continue;
+        }
+
+        char escaped = str[++i];
+        switch (escaped) {
+            case 'n': out[written++] = '\n'; break;
+            case 't': out[written++] = '\t'; break;
+            case 'r': out[written++] = '\r'; break;
+            case 'b': out[written++] = '\b'; break;
+            case 'f': out[written++] = '\f'; break;
+            case 'u': {
+                u32 cp;
+                if (i+4 >= length || !hex_value(str+i+1, &cp)) {
+                    out[written++] = escaped;
+                    break;
+                }
+                i += 4;
+
+                // NOTE(Felix): combine utf-16 surrogate pairs
+                u32 low;
+                if (cp >= 0xD800 && cp <= 0xDBFF &&
+                    i+6 < length && str[i+1] == '\\' && str[i+2] == 'u' &&
+                    hex_value(str+i+3, &low) && low >= 0xDC00 && low <= 0xDFFF)
+                {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                }
+                written += code_point_to_bytes(cp, out+written);
+            } break;
+            default: out[written++] = escaped; break; // \" \\ \/ \'
+        }
+    }
+
+    return written;
+}
+
+u32 read_string_view(const char* str, String* out_string, Allocator_Base* allocator) {
+    // NOTE(Felix): Assumes we are on a " or '
+    u32 length = eat_string(str);
+
+    const char* content        = str+1; // quotes are not part of the string
+    u32         content_length = length-2;
+
+    if (!memchr(content, '\\', content_length)) {
+        out_string->data   = (char*)content;
+        out_string->length = content_length;
+        return length;
+    }
+
+    if (allocator == nullptr)
+        allocator = grab_current_allocator();
+
+    char* unescaped    = allocator->allocate<char>(content_length+1);
+    out_string->length = unescape_string(content, content_length, unescaped);
+    out_string->data   = unescaped;
+    unescaped[out_string->length] = '\0';
 
     return length;
 }
@@ -190,41 +293,429 @@ u32 read_identifier(const char* str, String* out_string, Allocator_Base* allocat
     return length;
 }
 
-u32 read_long(const char* str, s64* out_long) {
+// ----------------------------------------------------------------------------
+//                              number parsing
+// ----------------------------------------------------------------------------
+inline bool is_made_of_eight_digits(u64 chunk) {
+    return !(((chunk + 0x4646464646464646llu) | (chunk - 0x3030303030303030llu)) &
+             0x8080808080808080llu);
+}
+
+inline u32 parse_eight_digits(u64 chunk) {
+    // NOTE(Felix): little endian, first char in the lowest byte
+    const u64 mask = 0x000000FF000000FFllu;
+    const u64 mul1 = 0x000F424000000064llu; // 100 + (1000000 << 32)
+    const u64 mul2 = 0x0000271000000001llu; // 1   + (10000   << 32)
+    chunk -= 0x3030303030303030llu;
+    chunk  = (chunk * 10) + (chunk >> 8);
+    chunk  = (((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32;
+    return (u32)chunk;
+}
+
+// NOTE(Felix): Accumulates the digits at `p` into `value` (which wraps around
+//   after 19 digits, callers have to check for that) and returns the position
+//   after the last digit. `end` may be nullptr.
+inline const char* accumulate_digits(const char* p, const char* end, u64* value) {
+    u64 v = *value;
+    if (end) {
+        while (end - p >= 8) {
+            u64 chunk;
+            memcpy(&chunk, p, 8);
+            if (!is_made_of_eight_digits(chunk))
+                break;
+            v  = v * 100000000 + parse_eight_digits(chunk);
+            p += 8;
+        }
+    }
+    while ((!end || p < end) && is_number_char(*p)) {
+        v = v * 10 + (*p - '0');
+        ++p;
+    }
+    *value = v;
+    return p;
+}
+
+inline u32 count_significant_digits(const char* digits, const char* digits_end) {
+    while (digits < digits_end && (*digits == '0' || *digits == '.'))
+        ++digits;
+    u32 count = 0;
+    for (; digits < digits_end; ++digits)
+        count += is_number_char(*digits);
+    return count;
+}
+
+struct Parsing_U128 {
+    u64 low;
+    u64 high;
+};
+
+inline Parsing_U128 full_multiplication(u64 a, u64 b) {
+#ifdef _MSC_VER
+    Parsing_U128 result;
+    result.low = _umul128(a, b, &result.high);
+    return result;
+#else
+    unsigned __int128 r = (unsigned __int128)a * b;
+    return { (u64)r, (u64)(r >> 64) };
+#endif
+}
+
+inline u32 count_leading_zeros(u64 value) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanReverse64(&idx, value);
+    return 63 - (u32)idx;
+#else
+    return (u32)__builtin_clzll(value);
+#endif
+}
+
+// NOTE(Felix): 128 bit approximations of 5^q for every q a f32 can need,
+//   normalized so that the highest bit is set (truncated for q >= 0, rounded
+//   up reciprocals for q < 0).
+const s32 f32_smallest_power_of_ten = -65;
+const s32 f32_largest_power_of_ten  =  38;
+const u64 f32_powers_of_five[][2] = {
+        {0x86ccbb52ea94baeallu, 0x98e947129fc2b4e9llu}, // 5^-65
+        {0xa87fea27a539e9a5llu, 0x3f2398d747b36224llu}, // 5^-64
+        {0xd29fe4b18e88640ellu, 0x8eec7f0d19a03aadllu}, // 5^-63
+        {0x83a3eeeef9153e89llu, 0x1953cf68300424acllu}, // 5^-62
+        {0xa48ceaaab75a8e2bllu, 0x5fa8c3423c052dd7llu}, // 5^-61
+        {0xcdb02555653131b6llu, 0x3792f412cb06794dllu}, // 5^-60
+        {0x808e17555f3ebf11llu, 0xe2bbd88bbee40bd0llu}, // 5^-59
+        {0xa0b19d2ab70e6ed6llu, 0x5b6aceaeae9d0ec4llu}, // 5^-58
+        {0xc8de047564d20a8bllu, 0xf245825a5a445275llu}, // 5^-57
+        {0xfb158592be068d2ellu, 0xeed6e2f0f0d56712llu}, // 5^-56
+        {0x9ced737bb6c4183dllu, 0x55464dd69685606bllu}, // 5^-55
+        {0xc428d05aa4751e4cllu, 0xaa97e14c3c26b886llu}, // 5^-54
+        {0xf53304714d9265dfllu, 0xd53dd99f4b3066a8llu}, // 5^-53
+        {0x993fe2c6d07b7fabllu, 0xe546a8038efe4029llu}, // 5^-52
+        {0xbf8fdb78849a5f96llu, 0xde98520472bdd033llu}, // 5^-51
+        {0xef73d256a5c0f77cllu, 0x963e66858f6d4440llu}, // 5^-50
+        {0x95a8637627989aadllu, 0xdde7001379a44aa8llu}, // 5^-49
+        {0xbb127c53b17ec159llu, 0x5560c018580d5d52llu}, // 5^-48
+        {0xe9d71b689dde71afllu, 0xaab8f01e6e10b4a6llu}, // 5^-47
+        {0x9226712162ab070dllu, 0xcab3961304ca70e8llu}, // 5^-46
+        {0xb6b00d69bb55c8d1llu, 0x3d607b97c5fd0d22llu}, // 5^-45
+        {0xe45c10c42a2b3b05llu, 0x8cb89a7db77c506allu}, // 5^-44
+        {0x8eb98a7a9a5b04e3llu, 0x77f3608e92adb242llu}, // 5^-43
+        {0xb267ed1940f1c61cllu, 0x55f038b237591ed3llu}, // 5^-42
+        {0xdf01e85f912e37a3llu, 0x6b6c46dec52f6688llu}, // 5^-41
+        {0x8b61313bbabce2c6llu, 0x2323ac4b3b3da015llu}, // 5^-40
+        {0xae397d8aa96c1b77llu, 0xabec975e0a0d081allu}, // 5^-39
+        {0xd9c7dced53c72255llu, 0x96e7bd358c904a21llu}, // 5^-38
+        {0x881cea14545c7575llu, 0x7e50d64177da2e54llu}, // 5^-37
+        {0xaa242499697392d2llu, 0xdde50bd1d5d0b9e9llu}, // 5^-36
+        {0xd4ad2dbfc3d07787llu, 0x955e4ec64b44e864llu}, // 5^-35
+        {0x84ec3c97da624ab4llu, 0xbd5af13bef0b113ellu}, // 5^-34
+        {0xa6274bbdd0fadd61llu, 0xecb1ad8aeacdd58ellu}, // 5^-33
+        {0xcfb11ead453994ballu, 0x67de18eda5814af2llu}, // 5^-32
+        {0x81ceb32c4b43fcf4llu, 0x80eacf948770ced7llu}, // 5^-31
+        {0xa2425ff75e14fc31llu, 0xa1258379a94d028dllu}, // 5^-30
+        {0xcad2f7f5359a3b3ellu, 0x096ee45813a04330llu}, // 5^-29
+        {0xfd87b5f28300ca0dllu, 0x8bca9d6e188853fcllu}, // 5^-28
+        {0x9e74d1b791e07e48llu, 0x775ea264cf55347ellu}, // 5^-27
+        {0xc612062576589ddallu, 0x95364afe032a819ellu}, // 5^-26
+        {0xf79687aed3eec551llu, 0x3a83ddbd83f52205llu}, // 5^-25
+        {0x9abe14cd44753b52llu, 0xc4926a9672793543llu}, // 5^-24
+        {0xc16d9a0095928a27llu, 0x75b7053c0f178294llu}, // 5^-23
+        {0xf1c90080baf72cb1llu, 0x5324c68b12dd6339llu}, // 5^-22
+        {0x971da05074da7beellu, 0xd3f6fc16ebca5e04llu}, // 5^-21
+        {0xbce5086492111aeallu, 0x88f4bb1ca6bcf585llu}, // 5^-20
+        {0xec1e4a7db69561a5llu, 0x2b31e9e3d06c32e6llu}, // 5^-19
+        {0x9392ee8e921d5d07llu, 0x3aff322e62439fd0llu}, // 5^-18
+        {0xb877aa3236a4b449llu, 0x09befeb9fad487c3llu}, // 5^-17
+        {0xe69594bec44de15bllu, 0x4c2ebe687989a9b4llu}, // 5^-16
+        {0x901d7cf73ab0acd9llu, 0x0f9d37014bf60a11llu}, // 5^-15
+        {0xb424dc35095cd80fllu, 0x538484c19ef38c95llu}, // 5^-14
+        {0xe12e13424bb40e13llu, 0x2865a5f206b06fballu}, // 5^-13
+        {0x8cbccc096f5088cbllu, 0xf93f87b7442e45d4llu}, // 5^-12
+        {0xafebff0bcb24aafellu, 0xf78f69a51539d749llu}, // 5^-11
+        {0xdbe6fecebdedd5bellu, 0xb573440e5a884d1cllu}, // 5^-10
+        {0x89705f4136b4a597llu, 0x31680a88f8953031llu}, // 5^-9
+        {0xabcc77118461cefcllu, 0xfdc20d2b36ba7c3ellu}, // 5^-8
+        {0xd6bf94d5e57a42bcllu, 0x3d32907604691b4dllu}, // 5^-7
+        {0x8637bd05af6c69b5llu, 0xa63f9a49c2c1b110llu}, // 5^-6
+        {0xa7c5ac471b478423llu, 0x0fcf80dc33721d54llu}, // 5^-5
+        {0xd1b71758e219652bllu, 0xd3c36113404ea4a9llu}, // 5^-4
+        {0x83126e978d4fdf3bllu, 0x645a1cac083126eallu}, // 5^-3
+        {0xa3d70a3d70a3d70allu, 0x3d70a3d70a3d70a4llu}, // 5^-2
+        {0xccccccccccccccccllu, 0xcccccccccccccccdllu}, // 5^-1
+        {0x8000000000000000llu, 0x0000000000000000llu}, // 5^0
+        {0xa000000000000000llu, 0x0000000000000000llu}, // 5^1
+        {0xc800000000000000llu, 0x0000000000000000llu}, // 5^2
+        {0xfa00000000000000llu, 0x0000000000000000llu}, // 5^3
+        {0x9c40000000000000llu, 0x0000000000000000llu}, // 5^4
+        {0xc350000000000000llu, 0x0000000000000000llu}, // 5^5
+        {0xf424000000000000llu, 0x0000000000000000llu}, // 5^6
+        {0x9896800000000000llu, 0x0000000000000000llu}, // 5^7
+        {0xbebc200000000000llu, 0x0000000000000000llu}, // 5^8
+        {0xee6b280000000000llu, 0x0000000000000000llu}, // 5^9
+        {0x9502f90000000000llu, 0x0000000000000000llu}, // 5^10
+        {0xba43b74000000000llu, 0x0000000000000000llu}, // 5^11
+        {0xe8d4a51000000000llu, 0x0000000000000000llu}, // 5^12
+        {0x9184e72a00000000llu, 0x0000000000000000llu}, // 5^13
+        {0xb5e620f480000000llu, 0x0000000000000000llu}, // 5^14
+        {0xe35fa931a0000000llu, 0x0000000000000000llu}, // 5^15
+        {0x8e1bc9bf04000000llu, 0x0000000000000000llu}, // 5^16
+        {0xb1a2bc2ec5000000llu, 0x0000000000000000llu}, // 5^17
+        {0xde0b6b3a76400000llu, 0x0000000000000000llu}, // 5^18
+        {0x8ac7230489e80000llu, 0x0000000000000000llu}, // 5^19
+        {0xad78ebc5ac620000llu, 0x0000000000000000llu}, // 5^20
+        {0xd8d726b7177a8000llu, 0x0000000000000000llu}, // 5^21
+        {0x878678326eac9000llu, 0x0000000000000000llu}, // 5^22
+        {0xa968163f0a57b400llu, 0x0000000000000000llu}, // 5^23
+        {0xd3c21bcecceda100llu, 0x0000000000000000llu}, // 5^24
+        {0x84595161401484a0llu, 0x0000000000000000llu}, // 5^25
+        {0xa56fa5b99019a5c8llu, 0x0000000000000000llu}, // 5^26
+        {0xcecb8f27f4200f3allu, 0x0000000000000000llu}, // 5^27
+        {0x813f3978f8940984llu, 0x4000000000000000llu}, // 5^28
+        {0xa18f07d736b90be5llu, 0x5000000000000000llu}, // 5^29
+        {0xc9f2c9cd04674edellu, 0xa400000000000000llu}, // 5^30
+        {0xfc6f7c4045812296llu, 0x4d00000000000000llu}, // 5^31
+        {0x9dc5ada82b70b59dllu, 0xf020000000000000llu}, // 5^32
+        {0xc5371912364ce305llu, 0x6c28000000000000llu}, // 5^33
+        {0xf684df56c3e01bc6llu, 0xc732000000000000llu}, // 5^34
+        {0x9a130b963a6c115cllu, 0x3c7f400000000000llu}, // 5^35
+        {0xc097ce7bc90715b3llu, 0x4b9f100000000000llu}, // 5^36
+        {0xf0bdc21abb48db20llu, 0x1e86d40000000000llu}, // 5^37
+        {0x96769950b50d88f4llu, 0x1314448000000000llu}, // 5^38
+};
+
+// NOTE(Felix): Computes the f32 closest to w * 10^q (Eisel-Lemire). Returns
+//   false in the (very rare) cases where the 128 bit approximation is not
+//   precise enough to decide the rounding.
+bool eisel_lemire_f32(u64 w, s64 q, bool negative, f32* out_float) {
+    const s32 mantissa_explicit_bits = 23;
+    const s32 minimum_exponent       = -127;
+    const s32 infinite_power         = 0xFF;
+
+    u64 mantissa;
+    s32 power2;
+
+    if (w == 0 || q < f32_smallest_power_of_ten) {
+        mantissa = 0;
+        power2   = 0;
+    } else if (q > f32_largest_power_of_ten) {
+        mantissa = 0;
+        power2   = infinite_power;
+    } else {
+        s32 lz = count_leading_zeros(w);
+        w <<= lz;
+
+        const u64*   power_of_five  = f32_powers_of_five[q - f32_smallest_power_of_ten];
+        const u64    precision_mask = 0xFFFFFFFFFFFFFFFFllu >> (mantissa_explicit_bits + 3);
+        Parsing_U128 product        = full_multiplication(w, power_of_five[0]);
+        if ((product.high & precision_mask) == precision_mask) {
+            Parsing_U128 second = full_multiplication(w, power_of_five[1]);
+            product.low += second.high;
+            if (second.high > product.low)
+                ++product.high;
+        }
+
+        if (product.low == 0xFFFFFFFFFFFFFFFFllu && (q < -27 || q > 55))
+            return false;
+
+        s32 upperbit = (s32)(product.high >> 63);
+        s32 shift    = upperbit + 64 - mantissa_explicit_bits - 3;
+        mantissa     = product.high >> shift;
+        power2       = (s32)((((152170 + 65536) * q) >> 16) + 63) + upperbit - lz - minimum_exponent;
+
+        if (power2 <= 0) {
+            // NOTE(Felix): subnormal
+            if (-power2 + 1 >= 64) {
+                mantissa = 0;
+                power2   = 0;
+            } else {
+                mantissa >>= -power2 + 1;
+                mantissa  += mantissa & 1;
+                mantissa >>= 1;
+                power2     = mantissa < (1llu << mantissa_explicit_bits) ? 0 : 1;
+            }
+        } else {
+            // NOTE(Felix): exactly halfway between two floats: round to even
+            if (product.low <= 1 && q >= -17 && q <= 10 && (mantissa & 3) == 1) {
+                if ((mantissa << shift) == product.high)
+                    mantissa &= ~1llu;
+            }
+
+            mantissa  += mantissa & 1;
+            mantissa >>= 1;
+            if (mantissa >= (2llu << mantissa_explicit_bits)) {
+                mantissa = 1llu << mantissa_explicit_bits;
+                ++power2;
+            }
+            mantissa &= ~(1llu << mantissa_explicit_bits);
+
+            if (power2 >= infinite_power) {
+                mantissa = 0;
+                power2   = infinite_power;
+            }
+        }
+    }
+
+    u32 bits = (u32)mantissa | ((u32)power2 << mantissa_explicit_bits) | ((u32)negative << 31);
+    memcpy(out_float, &bits, sizeof(bits));
+    return true;
+}
+
+u32 read_float(const char* str, const char* end, f32* out_float) {
+    auto in_bounds = [&](const char* p) -> bool {
+        return !end || p < end;
+    };
+
+    const char* p = str;
+    while (in_bounds(p) && is_whitespace(*p))
+        ++p;
+
+    bool negative = false;
+    if (in_bounds(p) && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    const char* digits_start = p;
+    u64 w = 0;
+    s64 q = 0;
+
+    p = accumulate_digits(p, end, &w);
+    s64 digit_count = p - digits_start;
+
+    if (in_bounds(p) && *p == '.') {
+        ++p;
+        const char* fraction_start = p;
+        p = accumulate_digits(p, end, &w);
+        digit_count += p - fraction_start;
+        q           -= p - fraction_start;
+    }
+    const char* digits_end = p;
+
+    if (digit_count == 0) {
+        // NOTE(Felix): inf, nan, hex floats and garbage
+        char* strtof_end;
+        *out_float = strtof(str, &strtof_end);
+        return (u32)(strtof_end-str);
+    }
+
+    if (in_bounds(p) && (*p == 'e' || *p == 'E')) {
+        const char* exponent_start = p;
+        ++p;
+        bool exponent_negative = false;
+        if (in_bounds(p) && (*p == '-' || *p == '+')) {
+            exponent_negative = *p == '-';
+            ++p;
+        }
+        if (in_bounds(p) && is_number_char(*p)) {
+            s64 exponent = 0;
+            while (in_bounds(p) && is_number_char(*p)) {
+                if (exponent < 100000)
+                    exponent = exponent * 10 + (*p - '0');
+                ++p;
+            }
+            q += exponent_negative ? -exponent : exponent;
+        } else {
+            // NOTE(Felix): a dangling 'e' is not part of the number
+            p = exponent_start;
+        }
+    }
+
+    bool done = false;
+    if (digit_count <= 19 || count_significant_digits(digits_start, digits_end) <= 19) {
+        // NOTE(Felix): Clinger's fast path: w and 10^|q| are exact f32s, so a
+        //   single multiplication or division rounds correctly
+        static const f32 exact_powers_of_ten[] = {
+            1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+        };
+        if (w <= (1llu << 24) && q >= -10 && q <= 10) {
+            f32 value = (f32)w;
+            if (q < 0) value /= exact_powers_of_ten[-q];
+            else       value *= exact_powers_of_ten[q];
+            *out_float = negative ? -value : value;
+            done = true;
+        } else {
+            done = eisel_lemire_f32(w, q, negative, out_float);
+        }
+    }
+
+    if (!done) {
+        char* strtof_end;
+        *out_float = strtof(str, &strtof_end);
+    }
+
+    return (u32)(p - str);
+}
+
+u32 read_float(const char* str, f32* out_float) {
+    return read_float(str, nullptr, out_float);
+}
+
+u32 read_long(const char* str, const char* end, s64* out_long) {
     u32 quotes_chars = 0;
 
     bool in_on_quotes = is_quotes_char(*str);
     if (in_on_quotes)
         quotes_chars = 1;
 
-    char* end;
-    s64 result = strtoll(str+quotes_chars, &end, 10);
-    *out_long = result;
+    const char* p = str+quotes_chars;
+    while ((!end || p < end) && is_whitespace(*p))
+        ++p;
+
+    bool negative = false;
+    if ((!end || p < end) && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    const char* digits_start = p;
+    u64 value = 0;
+    p = accumulate_digits(p, end, &value);
+
+    if (p == digits_start) {
+        // NOTE(Felix): like strtoll: nothing was read
+        *out_long = 0;
+        p = str+quotes_chars;
+    } else if (p - digits_start > 19 &&
+               count_significant_digits(digits_start, p) > 19)
+    {
+        // NOTE(Felix): does not fit, let strtoll do the clamping
+        char* strtoll_end;
+        *out_long = strtoll(str+quotes_chars, &strtoll_end, 10);
+        p = strtoll_end;
+    } else if (negative) {
+        *out_long = value > (u64)INT64_MAX + 1 ? INT64_MIN : (s64)(0 - value);
+    } else {
+        *out_long = value > (u64)INT64_MAX ? INT64_MAX : (s64)value;
+    }
+
+    const char* end_of_number = p;
 
     if (in_on_quotes) {
-        panic_if(!is_quotes_char(end[0]),
+        panic_if(!is_quotes_char(end_of_number[0]),
                  "Expected a quote here but got |%s|",
-                 end);
+                 end_of_number);
 
         quotes_chars = 2;
     }
 
-    return (u32)(end-str + quotes_chars);
+    return (u32)(end_of_number-str + quotes_chars);
 }
 
-u32 read_int(const char* str, s32* out_int) {
+u32 read_long(const char* str, s64* out_long) {
+    return read_long(str, nullptr, out_long);
+}
+
+u32 read_int(const char* str, const char* end, s32* out_int) {
     s64 l;
-    u32 read = read_long(str, &l);
+    u32 read = read_long(str, end, &l);
     *out_int = (s32)l;
     return read;
 }
 
-u32 read_float(const char* str, f32* out_float) {
-    char* end;
-    *out_float = strtof(str, &end);
-    return (u32)(end-str);
+u32 read_int(const char* str, s32* out_int) {
+    return read_int(str, nullptr, out_int);
 }
 
+
 u32 read_bool(const char* str, bool* out_bool) {
     char true_str[] = "true";
     s32  true_str_len = sizeof(true_str)-1;
@@ -31,27 +31,71 @@
 
 #ifdef FTB_LINUX
 #  include <time.h>
+#  include <errno.h>
+#  include <unistd.h>
+#  include <sys/syscall.h>
+#  include <linux/perf_event.h>
 #else
 // # include <Windows.h>
 #endif
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define FTB_PROFILER_TSC
+#  include "cpu_info.hpp"
+#  ifndef _MSC_VER
+#    include <x86intrin.h>
+#  endif
+#endif
+
 
 struct Time_Stamp {
-#ifdef FTB_WINDOWS
-    LARGE_INTEGER t;
-#else
-    struct timespec t;
-#endif
+    u64 t; // see profiler_timestamp
 };
 
 Time_Stamp start_timer();
 u64        stop_timer(Time_Stamp); // returns the elapsed time in nano-seconds
 
+// NOTE(Felix): With FTB_PROFILER_COUNTERS defined the printing Timer and the
+//   aggregating profiler also read hardware performance counters (through
+//   perf_event_open, so only on Linux) at the begin and end of every scope and
+//   report them next to the time. Reading them is a syscall of around a micro
+//   second, which the measured time of the scope itself excludes, but its
+//   parents don't. Counters that the cpu, a VM or the kernel (see
+//   /proc/sys/kernel/perf_event_paranoid) don't provide stay zero. If the
+//   kernel has to share the PMU and multiplexes the counters, the difference
+//   of two reads is scaled up by the share of time in between the counters
+//   were actually running, so it is an estimate then.
+enum struct Profile_Counter : u32 {
+    Cycles,
+    Instructions,
+    Cache_Misses,
+    Branch_Misses,
+    Dtlb_Misses,
+
+    Count
+};
+
+struct Profile_Counters {
+    u64 values[(u32)Profile_Counter::Count]; // raw, as the kernel counted them
+    u64 time_enabled;
+    u64 time_running;
+};
+
+auto profiler_read_counters(Profile_Counters* counters) -> bool; // false if none are available
+// NOTE(Felix): the counts between two reads, scaled for multiplexing
+auto profiler_counter_deltas(const Profile_Counters* start, const Profile_Counters* end,
+                             u64 out_deltas[(u32)Profile_Counter::Count]) -> void;
+auto profiler_print_counters(const Profile_Counters* start, const Profile_Counters* end) -> void;
+
 struct Timer {
     Time_Stamp start;
     const char* name;
     const char* file;
     u32   line;
+#ifdef FTB_PROFILER_COUNTERS
+    Profile_Counters counters;
+    bool             has_counters;
+#endif
     Timer(const char* p_file, const u32 p_line, const char* p_name = nullptr) {
         file   = p_file;
         line   = p_line;
@@ -63,20 +107,126 @@ struct Timer {
             println("%{color<}[PROFILE]%{>color} Block at %s:%i", console_green_bold, file, line);
         push_print_prefix("|   ");
 
-
+#ifdef FTB_PROFILER_COUNTERS
+        has_counters = profiler_read_counters(&counters);
+#endif
         start = start_timer();
     }
     ~Timer() {
         u64 nanos = stop_timer(start);
+#ifdef FTB_PROFILER_COUNTERS
+        Profile_Counters end;
+        bool counted = has_counters && profiler_read_counters(&end);
+#endif
 
         pop_print_prefix();
         println("-> took %{color<}%.2fms%{>color}", console_green_bold, nanos / 1.0e6);
+#ifdef FTB_PROFILER_COUNTERS
+        if (counted)
+            profiler_print_counters(&counters, &end);
+#endif
     }
 };
 
-#define profile_block             MPP_DECLARE(1, Timer MPI_LABEL(labid, timer)(__FILE__,__LINE__))
-#define profile_named_block(name) MPP_DECLARE(1, Timer MPI_LABEL(labid, timer)(__FILE__,__LINE__,name))
-#define profile_function          Timer MPI_LABEL(labid, timer)(__FILE__,__LINE__,__FUNCTION__)
+// NOTE(Felix): Every profiled scope gets one of these as a static, so
+//   recorded events only have to carry a pointer to it.
+struct Profile_Location {
+    const char* name; // nullptr for unnamed blocks
+    const char* file;
+    u32         line;
+};
+
+// NOTE(Felix): By default the profile_* macros print every scope and its
+//   timing as it happens. Two other modes can be enabled instead (also both at
+//   once), neither of them does IO while measuring:
+//
+//   - FTB_PROFILER_TRACE records begin and end events into a buffer per
+//     thread. profiler_write_trace writes everything recorded so far as Chrome
+//     trace-event JSON, which chrome://tracing and ui.perfetto.dev open
+//     directly. Writing the trace must not race with threads that are still
+//     recording.
+//
+//   - FTB_PROFILER_AGGREGATE keeps a call tree of scopes per thread, keyed by
+//     their location, with hit count, inclusive and exclusive time, min/max
+//     and a histogram for percentiles. profiler_report prints the call trees
+//     of all threads merged into one, profiler_write_report exports it as
+//     JSON. Both may be called while other threads keep profiling.
+//
+//   profiler_reset drops the recorded trace events, which has the same
+//   restriction as writing them, and zeroes the aggregated statistics.
+struct Profile_Node;
+
+auto profiler_timestamp() -> u64; // monotonic, in nano-seconds
+auto profiler_ticks() -> u64;     // cheapest monotonic clock, unit depends on the cpu
+auto profiler_ticks_to_nanos(u64 ticks) -> u64;
+auto profiler_uses_tsc() -> bool;
+auto profiler_trace_begin(const Profile_Location* location) -> void;
+auto profiler_trace_end() -> void;
+auto profiler_set_thread_name(const char* name) -> void;
+auto profiler_write_trace(const char* path) -> bool;
+auto profiler_aggregate_enter(const Profile_Location* location) -> Profile_Node*;
+auto profiler_aggregate_exit(Profile_Node* node, u64 elapsed_ticks) -> void;
+auto profiler_aggregate_counters(Profile_Node* node, const Profile_Counters* start) -> void;
+auto profiler_report() -> void;
+auto profiler_write_report(const char* path) -> bool;
+auto profiler_reset() -> void;
+
+struct Profile_Scope {
+#ifdef FTB_PROFILER_AGGREGATE
+    Profile_Node* node;
+    u64           start;
+#  ifdef FTB_PROFILER_COUNTERS
+    Profile_Counters counters;
+#  endif
+#endif
+    Profile_Scope(const Profile_Location* location) {
+#ifdef FTB_PROFILER_TRACE
+        profiler_trace_begin(location);
+#endif
+#ifdef FTB_PROFILER_AGGREGATE
+        node  = profiler_aggregate_enter(location);
+#  ifdef FTB_PROFILER_COUNTERS
+        profiler_read_counters(&counters);
+#  endif
+        start = profiler_ticks();
+#endif
+    }
+    ~Profile_Scope() {
+#ifdef FTB_PROFILER_AGGREGATE
+        u64 elapsed = profiler_ticks() - start;
+#  ifdef FTB_PROFILER_COUNTERS
+        profiler_aggregate_counters(node, &counters);
+#  endif
+        profiler_aggregate_exit(node, elapsed);
+#endif
+#ifdef FTB_PROFILER_TRACE
+        profiler_trace_end();
+#endif
+    }
+};
+
+// NOTE(Felix): The location is built once per scope, so a name that changes
+//   between calls (a loop variable, a formatted string) would stick with the
+//   first one. constexpr makes that a compile error: names have to be string
+//   literals or other constants.
+#define profile_location(name)                                          \
+    static constexpr Profile_Location MPI_LABEL(labid, location) = {name, __FILE__, __LINE__}
+
+#if defined(FTB_PROFILER_TRACE) || defined(FTB_PROFILER_AGGREGATE)
+#  define profile_block                                                 \
+    MPP_DECLARE(1, profile_location(nullptr))                           \
+    MPP_DECLARE(2, Profile_Scope MPI_LABEL(labid, scope)(&MPI_LABEL(labid, location)))
+#  define profile_named_block(name)                                     \
+    MPP_DECLARE(1, profile_location(name))                              \
+    MPP_DECLARE(2, Profile_Scope MPI_LABEL(labid, scope)(&MPI_LABEL(labid, location)))
+#  define profile_function                                              \
+    profile_location(__FUNCTION__);                                     \
+    Profile_Scope MPI_LABEL(labid, scope)(&MPI_LABEL(labid, location))
+#else
+#  define profile_block             MPP_DECLARE(1, Timer MPI_LABEL(labid, timer)(__FILE__,__LINE__))
+#  define profile_named_block(name) MPP_DECLARE(1, Timer MPI_LABEL(labid, timer)(__FILE__,__LINE__,name))
+#  define profile_function          Timer MPI_LABEL(labid, timer)(__FILE__,__LINE__,__FUNCTION__)
+#endif
 
 #ifdef FTB_DEBUG
 #  define debug_profile_block             profile_block
@@ -91,50 +241,828 @@ struct Timer {
 
 #ifdef FTB_PROFILER_IMPL
 #  ifdef FTB_WINDOWS
-
-Time_Stamp start_timer() {
-    Time_Stamp t {};
-    bool success = QueryPerformanceCounter(&t.t);
-    debug_assert(success);
-
-    return t;
-}
-u64   stop_timer(Time_Stamp stamp) { // returns the elapsed time in nano-seconds
-    LARGE_INTEGER freq;
-
+auto profiler_os_timestamp() -> u64 {
     // NOTE(Felix): Docs say: [QueryPerformanceFrequency] retrieves the
     //   frequency of the performance counter. The frequency of the performance
     //   counter is fixed at system boot and is consistent across all
     //   processors. Therefore, the frequency need only be queried upon
     //   application initialization, and the result can be cached.
     //   (https://docs.microsoft.com/en-us/windows/win32/api/profileapi/nf-profileapi-queryperformancefrequency)
+    static LARGE_INTEGER freq {};
+    if (!freq.QuadPart)
+        QueryPerformanceFrequency(&freq);
 
-    bool success = QueryPerformanceFrequency(&freq);
-    debug_assert(success);
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return (u64)(now.QuadPart / freq.QuadPart) * 1'000'000'000 +
+        (u64)(now.QuadPart % freq.QuadPart) * 1'000'000'000 / freq.QuadPart;
+}
+#  else
+auto profiler_os_timestamp() -> u64 {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1'000'000'000 + (u64)now.tv_nsec;
+}
+#  endif // platform
+
+// NOTE(Felix): Reading the time stamp counter is a single instruction instead
+//   of a call into the OS clock, but it only counts at a fixed rate (and can
+//   be used as a clock) if the cpu says that it is invariant. Its rate is
+//   measured once against the OS clock on first use, and the timestamps are
+//   offset to line up with the OS clock. Without an invariant TSC, or when
+//   FTB_PROFILER_NO_TSC is defined, the OS clock is used directly. The scopes
+//   record raw ticks and only convert the ones they keep to nano-seconds.
+struct Profiler_Clock {
+    bool use_tsc;
+    f64  nanos_per_tick;
+    u64  tsc_base;
+    u64  nanos_base;
+};
+
+auto profiler_calibrate_clock() -> Profiler_Clock {
+    Profiler_Clock clock {};
+#  if defined(FTB_PROFILER_TSC) && !defined(FTB_PROFILER_NO_TSC)
+    int registers[4];
+    platform_independent_cpuid(0x80000000, registers);
+    if ((u32)registers[0] < 0x80000007)
+        return clock;
+    platform_independent_cpuid(0x80000007, registers);
+    if (!(registers[3] & (int)Edx_87_Power_Management_Flags::invariant_tsc))
+        return clock;
+
+    // NOTE(Felix): Reads the TSC on both sides of the OS clock, so we know
+    //   how far apart the two readings could be, and keeps the closest of a
+    //   few tries. A single slow read (the first call into the vdso, an
+    //   interrupt) would otherwise skew the rate by tens of ppm.
+    auto sample = [](u64* nanos) -> u64 {
+        u64 best_spread = (u64)-1;
+        u64 best_tsc    = 0;
+        for (u32 i = 0; i < 16; ++i) {
+            u64 before = __rdtsc();
+            u64 os     = profiler_os_timestamp();
+            u64 after  = __rdtsc();
+            if (after - before < best_spread) {
+                best_spread = after - before;
+                best_tsc    = before + (after - before) / 2;
+                *nanos      = os;
+            }
+        }
+        return best_tsc;
+    };
 
-    Time_Stamp now = start_timer();
+    u64 start_nanos;
+    u64 start_tsc = sample(&start_nanos);
+    u64 end_nanos;
+    u64 end_tsc;
+    do {
+        end_tsc = sample(&end_nanos);
+    } while (end_nanos - start_nanos < 5'000'000);
 
-    LONGLONG diff = now.t.QuadPart - stamp.t.QuadPart;
+    if (end_tsc <= start_tsc)
+        return clock;
 
-    return diff * 1'000'000'000 / freq.QuadPart;
+    clock.use_tsc        = true;
+    clock.nanos_per_tick = (f64)(end_nanos - start_nanos) / (f64)(end_tsc - start_tsc);
+    clock.tsc_base       = start_tsc;
+    clock.nanos_base     = start_nanos;
+#  endif
+    return clock;
 }
 
-#  else
-// LINUX
+const Profiler_Clock& profiler_clock() {
+    static const Profiler_Clock clock = profiler_calibrate_clock();
+    return clock;
+}
+
+auto profiler_uses_tsc() -> bool {
+    return profiler_clock().use_tsc;
+}
+
+auto profiler_ticks() -> u64 {
+#  ifdef FTB_PROFILER_TSC
+    if (profiler_clock().use_tsc)
+        return __rdtsc();
+#  endif
+    return profiler_os_timestamp();
+}
+
+auto profiler_ticks_to_nanos(u64 ticks) -> u64 {
+    const Profiler_Clock& clock = profiler_clock();
+    if (clock.use_tsc)
+        return (u64)((f64)(s64)ticks * clock.nanos_per_tick);
+    return ticks;
+}
+
+auto profiler_timestamp() -> u64 {
+    const Profiler_Clock& clock = profiler_clock();
+    return clock.nanos_base + profiler_ticks_to_nanos(profiler_ticks() - clock.tsc_base);
+}
 
 Time_Stamp start_timer() {
-    Time_Stamp t;
-    clock_gettime(CLOCK_MONOTONIC, &t.t);
-    return t;
+    return {profiler_timestamp()};
 }
+
 u64 stop_timer(Time_Stamp then) { // returns the elapsed time in nano-seconds
-    Time_Stamp now = start_timer();
-    if ((now.t.tv_nsec-then.t.tv_nsec)<0) {
-        return 1e9 * (now.t.tv_sec-then.t.tv_sec-1) + (1e9+now.t.tv_nsec-then.t.tv_nsec);
-    } else {
-        return 1e9 * (now.t.tv_sec-then.t.tv_sec) + (now.t.tv_nsec-then.t.tv_nsec);
+    return profiler_timestamp() - then.t;
+}
+
+#  ifdef FTB_LINUX
+// NOTE(Felix): The counters of a thread are opened on its first read as one
+//   group, so they are scheduled onto the PMU together and one read gets all
+//   of them. Ones that fail to open are left out of the group.
+struct Profile_Counter_Thread {
+    enum struct State : u8 {
+        Unopened,
+        Open,
+        Unavailable
+    } state;
+    s32 fds[(u32)Profile_Counter::Count];
+    u32 slots[(u32)Profile_Counter::Count]; // counter of the n-th value in a read
+    u32 opened;
+
+    ~Profile_Counter_Thread() {
+        for (u32 i = 0; i < opened; ++i)
+            close(fds[i]);
+    }
+};
+
+thread_local Profile_Counter_Thread profile_counter_thread;
+
+auto profile_open_counters(Profile_Counter_Thread* thread) -> void {
+    struct {
+        u32 type;
+        u64 config;
+    } events[(u32)Profile_Counter::Count] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                             (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    };
+
+    thread->opened = 0;
+    s32 error = 0;
+    for (u32 i = 0; i < array_length(events); ++i) {
+        struct perf_event_attr attr {};
+        attr.size           = sizeof(attr);
+        attr.type           = events[i].type;
+        attr.config         = events[i].config;
+        attr.read_format    = PERF_FORMAT_GROUP |
+                              PERF_FORMAT_TOTAL_TIME_ENABLED |
+                              PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+
+        s32 leader = thread->opened ? thread->fds[0] : -1;
+        s32 fd = (s32)syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+        if (fd < 0) {
+            error = errno;
+            continue;
+        }
+        thread->fds[thread->opened]   = fd;
+        thread->slots[thread->opened] = i;
+        ++thread->opened;
+    }
+
+    if (thread->opened) {
+        thread->state = Profile_Counter_Thread::State::Open;
+        return;
     }
+
+    thread->state = Profile_Counter_Thread::State::Unavailable;
+    static std::atomic<bool> warned { false };
+    if (!warned.exchange(true))
+        log_warning("profiler: no hardware counters available (perf_event_open: %s)", strerror(error));
 }
 
-#  endif // platform
+auto profiler_read_counters(Profile_Counters* counters) -> bool {
+    *counters = {};
+    Profile_Counter_Thread* thread = &profile_counter_thread;
+    if (thread->state == Profile_Counter_Thread::State::Unopened)
+        profile_open_counters(thread);
+    if (thread->state != Profile_Counter_Thread::State::Open)
+        return false;
+
+    // NOTE(Felix): a group read gives the number of values, the time the
+    //   group was enabled and the time it was actually running on the PMU,
+    //   followed by the values
+    u64 values[3 + (u32)Profile_Counter::Count];
+    ssize_t bytes = read(thread->fds[0], values, sizeof(values));
+    if (bytes < 3 * (ssize_t)sizeof(u64))
+        return false;
+
+    u64 count = MIN(values[0], (u64)thread->opened);
+    counters->time_enabled = values[1];
+    counters->time_running = values[2];
+    for (u32 i = 0; i < count; ++i)
+        counters->values[thread->slots[i]] = values[3 + i];
+    return true;
+}
+#  else
+auto profiler_read_counters(Profile_Counters* counters) -> bool {
+    *counters = {};
+    return false;
+}
+#  endif // FTB_LINUX
+
+auto profiler_counter_deltas(const Profile_Counters* start, const Profile_Counters* end,
+                             u64 out_deltas[(u32)Profile_Counter::Count]) -> void
+{
+    // NOTE(Felix): Scaling each read by its own enabled/running ratio and
+    //   subtracting could go negative when the ratio changed in between, so
+    //   only the difference is scaled, by the ratio of that interval.
+    u64 enabled = end->time_enabled - start->time_enabled;
+    u64 running = end->time_running - start->time_running;
+    for (u32 i = 0; i < (u32)Profile_Counter::Count; ++i) {
+        u64 delta = end->values[i] >= start->values[i] ? end->values[i] - start->values[i] : 0;
+        if (running == 0)
+            delta = 0; // NOTE(Felix): not scheduled in between
+        else if (running != enabled)
+            delta = (u64)((f64)delta * ((f64)enabled / (f64)running));
+        out_deltas[i] = delta;
+    }
+}
+
+auto profiler_print_counters(const Profile_Counters* start, const Profile_Counters* end) -> void {
+    u64 delta[(u32)Profile_Counter::Count];
+    profiler_counter_deltas(start, end, delta);
+
+    u64 cycles       = delta[(u32)Profile_Counter::Cycles];
+    u64 instructions = delta[(u32)Profile_Counter::Instructions];
+    println("   %llu cycles, %llu instructions (%.2f IPC), %llu cache misses, "
+            "%llu branch misses, %llu dTLB misses",
+            cycles, instructions, cycles ? (f64)instructions / cycles : 0.0,
+            delta[(u32)Profile_Counter::Cache_Misses],
+            delta[(u32)Profile_Counter::Branch_Misses],
+            delta[(u32)Profile_Counter::Dtlb_Misses]);
+}
+
+struct Trace_Event {
+    const Profile_Location* location; // nullptr for end events
+    u64                     ticks;
+};
+
+const u32 trace_chunk_capacity = 4096;
+
+struct Trace_Chunk {
+    Trace_Chunk* next;
+    u32          count;
+    Trace_Event  events[trace_chunk_capacity];
+};
+
+// NOTE(Felix): One per thread that ever recorded something. They are never
+//   freed, so the events of threads that already exited can still be written,
+//   only their chunks go away in profiler_reset.
+struct Trace_Thread {
+    Trace_Thread* next;
+    Trace_Chunk*  first;
+    Trace_Chunk*  current;
+    u32           id;
+    char          name[32];
+};
+
+struct Trace_State {
+    std::atomic<Trace_Thread*> threads;
+    std::atomic<u32>           next_id;
+} trace_state;
+
+thread_local Trace_Thread* trace_thread;
+
+auto trace_register_thread() -> Trace_Thread* {
+    Trace_Thread* thread = libc_allocator->allocate_0<Trace_Thread>(1);
+    thread->id = trace_state.next_id.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    thread->next = trace_state.threads.load(std::memory_order_relaxed);
+    while (!trace_state.threads.compare_exchange_weak(thread->next, thread,
+                                                      std::memory_order_release,
+                                                      std::memory_order_relaxed));
+    trace_thread = thread;
+    return thread;
+}
+
+auto trace_current_chunk() -> Trace_Chunk* {
+    Trace_Thread* thread = trace_thread ? trace_thread : trace_register_thread();
+    Trace_Chunk*  chunk  = thread->current;
+    if (chunk && chunk->count < trace_chunk_capacity)
+        return chunk;
+
+    Trace_Chunk* new_chunk = libc_allocator->allocate<Trace_Chunk>(1);
+    new_chunk->next  = nullptr;
+    new_chunk->count = 0;
+    if (chunk)
+        chunk->next = new_chunk;
+    else
+        thread->first = new_chunk;
+    thread->current = new_chunk;
+    return new_chunk;
+}
+
+auto profiler_trace_begin(const Profile_Location* location) -> void {
+    Trace_Chunk* chunk = trace_current_chunk();
+    chunk->events[chunk->count++] = {location, profiler_ticks()};
+}
+
+auto profiler_trace_end() -> void {
+    // NOTE(Felix): take the time first, so finding the chunk is not counted
+    //   towards the scope
+    u64 now = profiler_ticks();
+    Trace_Chunk* chunk = trace_current_chunk();
+    chunk->events[chunk->count++] = {nullptr, now};
+}
+
+auto profiler_set_thread_name(const char* name) -> void {
+    Trace_Thread* thread = trace_thread ? trace_thread : trace_register_thread();
+    strncpy(thread->name, name, sizeof(thread->name)-1);
+}
+
+auto trace_reset() -> void {
+    for (Trace_Thread* thread = trace_state.threads.load(std::memory_order_acquire);
+         thread; thread = thread->next)
+    {
+        Trace_Chunk* chunk = thread->first;
+        while (chunk) {
+            Trace_Chunk* next = chunk->next;
+            libc_allocator->deallocate(chunk);
+            chunk = next;
+        }
+        thread->first   = nullptr;
+        thread->current = nullptr;
+    }
+}
+
+auto trace_write_json_string(Print_Sink* sink, const char* string) -> void {
+    for (const char* c = string; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            sink->put('\\');
+            sink->put(*c);
+        } else if ((u8)*c < 0x20) {
+            print_to_sink(sink, "\\u%04x", (u32)(u8)*c);
+        } else {
+            sink->put(*c);
+        }
+    }
+}
+
+auto profiler_write_trace(const char* path) -> bool {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        log_error("profiler: could not open '%s' for writing the trace", path);
+        return false;
+    }
+    defer { fclose(file); };
+
+    char buffer[4096];
+    Print_Sink sink;
+    sink.init_file(file, buffer, sizeof(buffer));
+
+    Trace_Thread* threads = trace_state.threads.load(std::memory_order_acquire);
+
+    // NOTE(Felix): timestamps are written relative to the earliest event, in
+    //   micro-seconds as the format wants them
+    u64 base = (u64)-1;
+    for (Trace_Thread* thread = threads; thread; thread = thread->next) {
+        if (thread->first && thread->first->count)
+            base = MIN(base, thread->first->events[0].ticks);
+    }
+
+    print_to_sink(&sink, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    bool first_event = true;
+    for (Trace_Thread* thread = threads; thread; thread = thread->next) {
+        print_to_sink(&sink, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+                      first_event ? "" : ",", thread->id);
+        if (thread->name[0])
+            trace_write_json_string(&sink, thread->name);
+        else
+            print_to_sink(&sink, "thread %u", thread->id);
+        sink.write("\"}}", 3);
+        first_event = false;
+
+        for (Trace_Chunk* chunk = thread->first; chunk; chunk = chunk->next) {
+            for (u32 i = 0; i < chunk->count; ++i) {
+                Trace_Event event = chunk->events[i];
+                u64 time = profiler_ticks_to_nanos(event.ticks - base);
+                if (!event.location) {
+                    print_to_sink(&sink, ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03llu}",
+                                  thread->id, time / 1000, time % 1000);
+                    continue;
+                }
+
+                const Profile_Location* location = event.location;
+                sink.write(",\n{\"name\":\"", 11);
+                if (location->name) {
+                    trace_write_json_string(&sink, location->name);
+                } else {
+                    trace_write_json_string(&sink, location->file);
+                    print_to_sink(&sink, ":%u", location->line);
+                }
+                print_to_sink(&sink, "\",\"ph\":\"B\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03llu,\"args\":{\"file\":\"",
+                              thread->id, time / 1000, time % 1000);
+                trace_write_json_string(&sink, location->file);
+                print_to_sink(&sink, "\",\"line\":%u}}", location->line);
+            }
+        }
+    }
+    sink.write("\n]}\n", 4);
+    sink.flush();
+
+    if (ferror(file)) {
+        log_error("profiler: could not write the trace to '%s'", path);
+        return false;
+    }
+    return true;
+}
+// NOTE(Felix): Log-linear histogram of the scope durations in nano-seconds:
+//   values below 8 get a bucket each, above that every power of two is split
+//   into 8 buckets, so a percentile is off by at most 1/16 of its value.
+//   Durations from 2^43ns (~2.4h) on share the last bucket.
+const u32 profile_histogram_sub_buckets = 8;
+const u32 profile_histogram_max_bit     = 42;
+const u32 profile_histogram_buckets     = (profile_histogram_max_bit - 1) * profile_histogram_sub_buckets;
+
+inline auto profile_histogram_bucket(u64 nanos) -> u32 {
+    if (nanos < profile_histogram_sub_buckets)
+        return (u32)nanos;
+    nanos = MIN(nanos, (2ull << profile_histogram_max_bit) - 1);
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanReverse64(&bit, nanos);
+#else
+    u32 bit = 63 - (u32)__builtin_clzll(nanos);
+#endif
+    u32 sub = (u32)(nanos >> (bit - 3)) & (profile_histogram_sub_buckets - 1);
+    return (bit - 2) * profile_histogram_sub_buckets + sub;
+}
+
+inline auto profile_histogram_bucket_middle(u32 bucket) -> u64 {
+    if (bucket < profile_histogram_sub_buckets)
+        return bucket;
+    u32 bit = bucket / profile_histogram_sub_buckets + 2;
+    u64 sub = bucket % profile_histogram_sub_buckets;
+    return ((profile_histogram_sub_buckets + sub) << (bit - 3)) + ((1ull << (bit - 3)) >> 1);
+}
+
+// NOTE(Felix): Only the owning thread writes a node, but reports may read it
+//   at any time, so the counters are atomics that are written with relaxed
+//   load/store pairs (plain moves, no locked instructions). New children are
+//   pushed to the front of the list with a release store.
+struct Profile_Node {
+    const Profile_Location*    location; // nullptr for the root of a thread
+    Profile_Node*              parent;
+    std::atomic<Profile_Node*> first_child;
+    std::atomic<Profile_Node*> next_sibling;
+
+    std::atomic<u64> count;
+    std::atomic<u64> inclusive;
+    std::atomic<u64> children; // inclusive time of all the children
+    std::atomic<u64> min;
+    std::atomic<u64> max;
+    std::atomic<u64> counters[(u32)Profile_Counter::Count];
+    std::atomic<u32> histogram[profile_histogram_buckets];
+};
+
+struct Profile_Thread {
+    Profile_Thread* next;
+    Profile_Node*   current;
+    Profile_Node    root;
+};
+
+std::atomic<Profile_Thread*> profile_threads;
+thread_local Profile_Thread* profile_thread;
+
+inline auto profile_add(std::atomic<u64>* counter, u64 amount) -> void {
+    counter->store(counter->load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+auto profile_reset_node(Profile_Node* node) -> void {
+    node->count.store(0, std::memory_order_relaxed);
+    node->inclusive.store(0, std::memory_order_relaxed);
+    node->children.store(0, std::memory_order_relaxed);
+    node->min.store((u64)-1, std::memory_order_relaxed);
+    node->max.store(0, std::memory_order_relaxed);
+    for (u32 i = 0; i < profile_histogram_buckets; ++i)
+        node->histogram[i].store(0, std::memory_order_relaxed);
+    for (u32 i = 0; i < (u32)Profile_Counter::Count; ++i)
+        node->counters[i].store(0, std::memory_order_relaxed);
+}
+
+auto profile_register_thread() -> Profile_Thread* {
+    Profile_Thread* thread = libc_allocator->allocate_0<Profile_Thread>(1);
+    profile_reset_node(&thread->root);
+    thread->current = &thread->root;
+
+    thread->next = profile_threads.load(std::memory_order_relaxed);
+    while (!profile_threads.compare_exchange_weak(thread->next, thread,
+                                                  std::memory_order_release,
+                                                  std::memory_order_relaxed));
+    profile_thread = thread;
+    return thread;
+}
+
+auto profile_add_child(Profile_Node* parent, const Profile_Location* location) -> Profile_Node* {
+    Profile_Node* node = libc_allocator->allocate_0<Profile_Node>(1);
+    node->location = location;
+    node->parent   = parent;
+    profile_reset_node(node);
+
+    node->next_sibling.store(parent->first_child.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+    parent->first_child.store(node, std::memory_order_release);
+    return node;
+}
+
+auto profiler_aggregate_enter(const Profile_Location* location) -> Profile_Node* {
+    Profile_Thread* thread = profile_thread ? profile_thread : profile_register_thread();
+    Profile_Node*   parent = thread->current;
+
+    Profile_Node* node = parent->first_child.load(std::memory_order_relaxed);
+    while (node && node->location != location)
+        node = node->next_sibling.load(std::memory_order_relaxed);
+    if (!node)
+        node = profile_add_child(parent, location);
+
+    thread->current = node;
+    return node;
+}
+
+auto profiler_aggregate_exit(Profile_Node* node, u64 elapsed_ticks) -> void {
+    u64 elapsed = profiler_ticks_to_nanos(elapsed_ticks);
+    profile_add(&node->count, 1);
+    profile_add(&node->inclusive, elapsed);
+    profile_add(&node->parent->children, elapsed);
+    if (elapsed < node->min.load(std::memory_order_relaxed))
+        node->min.store(elapsed, std::memory_order_relaxed);
+    if (elapsed > node->max.load(std::memory_order_relaxed))
+        node->max.store(elapsed, std::memory_order_relaxed);
+
+    std::atomic<u32>* bucket = &node->histogram[profile_histogram_bucket(elapsed)];
+    bucket->store(bucket->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    profile_thread->current = node->parent;
+}
+
+auto profiler_aggregate_counters(Profile_Node* node, const Profile_Counters* start) -> void {
+    Profile_Counters end;
+    if (!profiler_read_counters(&end))
+        return;
+    u64 delta[(u32)Profile_Counter::Count];
+    profiler_counter_deltas(start, &end, delta);
+    for (u32 i = 0; i < (u32)Profile_Counter::Count; ++i)
+        profile_add(&node->counters[i], delta[i]);
+}
+
+// NOTE(Felix): The reports merge the trees of all threads by location into a
+//   snapshot made of these.
+struct Profile_Report_Node {
+    const Profile_Location* location;
+    Profile_Report_Node*    first_child;
+    Profile_Report_Node*    next_sibling;
+
+    u64 count;
+    u64 inclusive;
+    u64 children;
+    u64 min;
+    u64 max;
+    u64 counters[(u32)Profile_Counter::Count];
+    u64 histogram[profile_histogram_buckets];
+};
+
+auto profile_merge(Profile_Report_Node* into, Profile_Node* node) -> void {
+    for (Profile_Node* child = node->first_child.load(std::memory_order_acquire);
+         child; child = child->next_sibling.load(std::memory_order_acquire))
+    {
+        Profile_Report_Node* target = into->first_child;
+        while (target && target->location != child->location)
+            target = target->next_sibling;
+        if (!target) {
+            target = libc_allocator->allocate_0<Profile_Report_Node>(1);
+            target->location     = child->location;
+            target->min          = (u64)-1;
+            target->next_sibling = into->first_child;
+            into->first_child    = target;
+        }
+
+        target->count     += child->count.load(std::memory_order_relaxed);
+        target->inclusive += child->inclusive.load(std::memory_order_relaxed);
+        target->children  += child->children.load(std::memory_order_relaxed);
+        target->min        = MIN(target->min, child->min.load(std::memory_order_relaxed));
+        target->max        = MAX(target->max, child->max.load(std::memory_order_relaxed));
+        for (u32 i = 0; i < profile_histogram_buckets; ++i)
+            target->histogram[i] += child->histogram[i].load(std::memory_order_relaxed);
+        for (u32 i = 0; i < (u32)Profile_Counter::Count; ++i)
+            target->counters[i] += child->counters[i].load(std::memory_order_relaxed);
+
+        profile_merge(target, child);
+    }
+}
+
+auto profile_free_report(Profile_Report_Node* node) -> void {
+    Profile_Report_Node* child = node->first_child;
+    while (child) {
+        Profile_Report_Node* next = child->next_sibling;
+        profile_free_report(child);
+        libc_allocator->deallocate(child);
+        child = next;
+    }
+}
+
+auto profile_snapshot(Profile_Report_Node* root) -> void {
+    *root = {};
+    for (Profile_Thread* thread = profile_threads.load(std::memory_order_acquire);
+         thread; thread = thread->next)
+    {
+        profile_merge(root, &thread->root);
+    }
+}
+
+auto profile_percentile(Profile_Report_Node* node, f64 percentile) -> u64 {
+    u64 rank = (u64)(percentile * node->count);
+    u64 seen = 0;
+    for (u32 i = 0; i < profile_histogram_buckets; ++i) {
+        seen += node->histogram[i];
+        if (seen > rank)
+            return MAX(node->min, MIN(node->max, profile_histogram_bucket_middle(i)));
+    }
+    return node->max;
+}
+
+// NOTE(Felix): Reads can race with the owning thread, so the children may
+//   briefly add up to more than the parent.
+inline auto profile_exclusive(Profile_Report_Node* node) -> u64 {
+    return node->inclusive > node->children ? node->inclusive - node->children : 0;
+}
+
+auto profile_has_counters(Profile_Report_Node* node) -> bool {
+    for (Profile_Report_Node* child = node->first_child; child; child = child->next_sibling) {
+        if (child->counters[(u32)Profile_Counter::Cycles] ||
+            child->counters[(u32)Profile_Counter::Instructions] ||
+            profile_has_counters(child))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+auto profile_label(Profile_Report_Node* node, char* buffer, u32 size) -> u32 {
+    const Profile_Location* location = node->location;
+    s32 length = location->name
+        ? snprintf(buffer, size, "%s", location->name)
+        : snprintf(buffer, size, "%s:%u", location->file, location->line);
+    return (u32)MIN((u32)length, size-1);
+}
+
+auto profile_label_width(Profile_Report_Node* node, u32 depth) -> u32 {
+    u32 width = 0;
+    char label[256];
+    for (Profile_Report_Node* child = node->first_child; child; child = child->next_sibling) {
+        width = MAX(width, depth * 2 + profile_label(child, label, sizeof(label)));
+        width = MAX(width, profile_label_width(child, depth + 1));
+    }
+    return width;
+}
+
+// NOTE(Felix): every row is built in a string sink first and printed with one
+//   println, so the prefixes are printed once and the row is one message
+auto profile_print_node(Profile_Report_Node* node, u32 depth, u32 width, bool with_counters) -> void {
+    char label[256];
+    for (Profile_Report_Node* child = node->first_child; child; child = child->next_sibling) {
+        char row_buffer[512];
+        Print_Sink row;
+        row.init_string(libc_allocator, row_buffer, sizeof(row_buffer));
+        defer { row.deinit(); };
+
+        u32 length = profile_label(child, label, sizeof(label));
+        f64 mean   = child->count ? (f64)child->inclusive / child->count : 0;
+        print_to_sink(&row, "%*s%{color<}%s%{>color}%*s %10llu %11.3f %11.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f",
+                depth * 2, "", console_cyan, label, width - depth * 2 - length, "",
+                child->count, child->inclusive / 1.0e6, profile_exclusive(child) / 1.0e6,
+                mean / 1.0e3,
+                child->count ? child->min / 1.0e3 : 0.0,
+                child->max / 1.0e3,
+                profile_percentile(child, 0.5) / 1.0e3,
+                profile_percentile(child, 0.9) / 1.0e3,
+                profile_percentile(child, 0.99) / 1.0e3);
+        if (with_counters) {
+            u64* counters = child->counters;
+            u64  cycles   = counters[(u32)Profile_Counter::Cycles];
+            print_to_sink(&row, " %14llu %5.2f %12llu %12llu %12llu",
+                          cycles,
+                          cycles ? (f64)counters[(u32)Profile_Counter::Instructions] / cycles : 0.0,
+                          counters[(u32)Profile_Counter::Cache_Misses],
+                          counters[(u32)Profile_Counter::Branch_Misses],
+                          counters[(u32)Profile_Counter::Dtlb_Misses]);
+        }
+        row.put('\0');
+        println("%s", row.data);
+        profile_print_node(child, depth + 1, width, with_counters);
+    }
+}
+
+auto profiler_report() -> void {
+    Profile_Report_Node root;
+    profile_snapshot(&root);
+    defer { profile_free_report(&root); };
+
+    u32  width         = MAX(5u, profile_label_width(&root, 0));
+    bool with_counters = profile_has_counters(&root);
+
+    char header_buffer[512];
+    Print_Sink header;
+    header.init_string(libc_allocator, header_buffer, sizeof(header_buffer));
+    defer { header.deinit(); };
+
+    print_to_sink(&header, "%{color<}%-*s %10s %11s %11s %10s %10s %10s %10s %10s %10s",
+                  console_green_bold, width, "scope", "count", "total ms", "self ms",
+                  "mean us", "min us", "max us", "p50 us", "p90 us", "p99 us");
+    if (with_counters) {
+        print_to_sink(&header, " %14s %5s %12s %12s %12s",
+                      "cycles", "IPC", "cache miss", "branch miss", "dTLB miss");
+    }
+    print_to_sink(&header, "%{>color}");
+    header.put('\0');
+    println("%s", header.data);
+    profile_print_node(&root, 0, width, with_counters);
+}
+
+auto profile_write_report_node(Print_Sink* sink, Profile_Report_Node* node) -> void {
+    bool first = true;
+    for (Profile_Report_Node* child = node->first_child; child; child = child->next_sibling) {
+        const Profile_Location* location = child->location;
+        sink->write(first ? "{\"name\":\"" : ",{\"name\":\"", first ? 9 : 10);
+        first = false;
+        if (location->name) {
+            trace_write_json_string(sink, location->name);
+        } else {
+            trace_write_json_string(sink, location->file);
+            print_to_sink(sink, ":%u", location->line);
+        }
+        sink->write("\",\"file\":\"", 10);
+        trace_write_json_string(sink, location->file);
+        print_to_sink(sink,
+                      "\",\"line\":%u,\"count\":%llu,\"inclusive_ns\":%llu,\"exclusive_ns\":%llu,"
+                      "\"min_ns\":%llu,\"max_ns\":%llu,\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,"
+                      "\"cycles\":%llu,\"instructions\":%llu,\"cache_misses\":%llu,"
+                      "\"branch_misses\":%llu,\"dtlb_misses\":%llu,\"children\":[",
+                      location->line, child->count, child->inclusive, profile_exclusive(child),
+                      child->count ? child->min : 0, child->max,
+                      profile_percentile(child, 0.5), profile_percentile(child, 0.9),
+                      profile_percentile(child, 0.99),
+                      child->counters[(u32)Profile_Counter::Cycles],
+                      child->counters[(u32)Profile_Counter::Instructions],
+                      child->counters[(u32)Profile_Counter::Cache_Misses],
+                      child->counters[(u32)Profile_Counter::Branch_Misses],
+                      child->counters[(u32)Profile_Counter::Dtlb_Misses]);
+        profile_write_report_node(sink, child);
+        sink->write("]}", 2);
+    }
+}
+
+auto profiler_write_report(const char* path) -> bool {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        log_error("profiler: could not open '%s' for writing the report", path);
+        return false;
+    }
+    defer { fclose(file); };
+
+    Profile_Report_Node root;
+    profile_snapshot(&root);
+    defer { profile_free_report(&root); };
+
+    char buffer[4096];
+    Print_Sink sink;
+    sink.init_file(file, buffer, sizeof(buffer));
+    sink.write("{\"scopes\":[", 11);
+    profile_write_report_node(&sink, &root);
+    sink.write("]}\n", 3);
+    sink.flush();
+
+    if (ferror(file)) {
+        log_error("profiler: could not write the report to '%s'", path);
+        return false;
+    }
+    return true;
+}
+
+auto profiler_reset() -> void {
+    trace_reset();
+
+    // NOTE(Felix): the nodes stay around as other threads might be inside of
+    //   them right now, only their statistics start over
+    auto reset_children = [](auto&& reset_children, Profile_Node* node) -> void {
+        for (Profile_Node* child = node->first_child.load(std::memory_order_acquire);
+             child; child = child->next_sibling.load(std::memory_order_acquire))
+        {
+            profile_reset_node(child);
+            reset_children(reset_children, child);
+        }
+    };
+    for (Profile_Thread* thread = profile_threads.load(std::memory_order_acquire);
+         thread; thread = thread->next)
+    {
+        reset_children(reset_children, &thread->root);
+    }
+}
 #endif // impl
@@ -0,0 +1,407 @@
+// Micro benchmarks of the containers, allocators, json, obj loading, kd tree
+// and soa sort, to compare between versions. Build with optimizations, e.g.:
+//   g++ -O2 -fpermissive benchmarks.cpp -o benchmarks --std=c++17 -lpthread
+//
+// Usage: benchmarks [--filter <part of name>] [--json <results.json>] [--quick]
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+
+#define FTB_CORE_IMPL
+#define FTB_HASHMAP_IMPL
+#define FTB_MATH_IMPL
+#define FTB_MESH_IMPL
+#define FTB_PARSING_IMPL
+#define FTB_JSON_IMPL
+#define FTB_SOA_SORT_IMPL
+#define FTB_PROFILER_IMPL
+#define FTB_BENCHMARK_IMPL
+
+#include "../math.hpp"
+#include "../core.hpp"
+#include "../hashmap.hpp"
+#include "../bucket_allocator.hpp"
+#include "../pool_allocator.hpp"
+#include "../json.hpp"
+#include "../mesh.hpp"
+#include "../kd_tree.hpp"
+#include "../soa_sort.hpp"
+#include "../profiler.hpp"
+#include "../benchmark.hpp"
+
+struct Random {
+    u64 state;
+    auto next() -> u64 {
+        state = state * 6364136223846793005llu + 1442695040888963407llu;
+        return state >> 16;
+    }
+    auto next_f32() -> f32 {
+        return (f32)(next() & 0xffffff) / (f32)0xffffff;
+    }
+};
+
+struct Object_64 {
+    u64 data[8];
+};
+
+struct Bench_Item {
+    s32 id;
+    f32 weight;
+};
+
+struct Bench_Document {
+    String                 name;
+    Array_List<Bench_Item> items;
+};
+
+auto compare_u64(const u64* a, const u64* b) -> s32 {
+    return (*a > *b) - (*a < *b);
+}
+
+auto compare_u64_void(const void* a, const void* b) -> s32 {
+    return compare_u64((const u64*)a, (const u64*)b);
+}
+
+auto benchmark_containers(Benchmark_Suite* suite) -> void {
+    suite->run("array_list/append", {1000, 100000}, [](Benchmark_State* state) {
+        for (u64 i = 0; i < state->iterations; ++i) {
+            Array_List<u64> list;
+            list.init();
+            for (u64 j = 0; j < state->parameter; ++j)
+                list.append(j);
+            do_not_optimize(list.data);
+            list.deinit();
+        }
+    });
+
+    suite->run("array_list/sort", {1000, 100000}, [](Benchmark_State* state) {
+        Array_List<u64> list;
+        list.init((u32)state->parameter);
+        defer { list.deinit(); };
+        for (u64 i = 0; i < state->iterations; ++i) {
+            state->pause();
+            Random random {i + 1};
+            list.clear();
+            for (u64 j = 0; j < state->parameter; ++j)
+                list.append(random.next());
+            state->resume();
+
+            list.sort(compare_u64);
+            clobber_memory();
+        }
+    });
+
+    suite->run("hash_map/set", {1000, 100000}, [](Benchmark_State* state) {
+        for (u64 i = 0; i < state->iterations; ++i) {
+            Hash_Map<u64, u64> map;
+            map.init();
+            for (u64 j = 0; j < state->parameter; ++j)
+                map.set_object(j * 0x9e3779b97f4a7c15llu, j);
+            do_not_optimize(map.cell_count);
+            map.deinit();
+        }
+    });
+
+    suite->run("hash_map/get", {1000, 100000}, [](Benchmark_State* state) {
+        state->pause();
+        Hash_Map<u64, u64> map;
+        map.init();
+        defer { map.deinit(); };
+        for (u64 j = 0; j < state->parameter; ++j)
+            map.set_object(j * 0x9e3779b97f4a7c15llu, j);
+        state->resume();
+
+        for (u64 i = 0; i < state->iterations; ++i) {
+            u64 sum = 0;
+            for (u64 j = 0; j < state->parameter; ++j)
+                sum += map.get_object(j * 0x9e3779b97f4a7c15llu);
+            do_not_optimize(sum);
+        }
+    });
+
+    suite->run("bucket_list/append", {1000, 100000}, [](Benchmark_State* state) {
+        for (u64 i = 0; i < state->iterations; ++i) {
+            Bucket_List<u64> list;
+            list.init();
+            for (u64 j = 0; j < state->parameter; ++j)
+                list.append(j);
+            do_not_optimize(list.next_bucket_index);
+            list.deinit();
+        }
+    });
+
+    suite->run("bucket_list/index", {1000, 100000}, [](Benchmark_State* state) {
+        state->pause();
+        Bucket_List<u64> list;
+        list.init();
+        defer { list.deinit(); };
+        for (u64 j = 0; j < state->parameter; ++j)
+            list.append(j);
+        state->resume();
+
+        for (u64 i = 0; i < state->iterations; ++i) {
+            u64 sum = 0;
+            for (u32 j = 0; j < state->parameter; ++j)
+                sum += list[j];
+            do_not_optimize(sum);
+        }
+    });
+}
+
+// NOTE(Felix): every iteration allocates `parameter` objects of 64 bytes and
+//   frees all of them again
+auto benchmark_allocators(Benchmark_Suite* suite) -> void {
+    suite->run("allocator/libc", {1000, 100000}, [](Benchmark_State* state) {
+        Object_64** objects = libc_allocator->allocate<Object_64*>((u32)state->parameter);
+        defer { libc_allocator->deallocate(objects); };
+        for (u64 i = 0; i < state->iterations; ++i) {
+            for (u64 j = 0; j < state->parameter; ++j)
+                objects[j] = libc_allocator->allocate<Object_64>(1);
+            clobber_memory();
+            for (u64 j = 0; j < state->parameter; ++j)
+                libc_allocator->deallocate(objects[j]);
+        }
+    });
+
+    suite->run("allocator/linear", {1000, 100000}, [](Benchmark_State* state) {
+        Linear_Allocator arena;
+        arena.init(1024 * 1024, libc_allocator);
+        defer { arena.deinit(); };
+        Allocator_Base* allocator = (Allocator_Base*)&arena;
+        for (u64 i = 0; i < state->iterations; ++i) {
+            for (u64 j = 0; j < state->parameter; ++j)
+                do_not_optimize(allocator->allocate<Object_64>(1));
+            arena.reset();
+        }
+    });
+
+    suite->run("allocator/pool", {1000, 100000}, [](Benchmark_State* state) {
+        Pool_Allocator<Object_64> pool;
+        pool.init((u32)state->parameter, libc_allocator);
+        defer { pool.deinit(); };
+        Object_64** objects = libc_allocator->allocate<Object_64*>((u32)state->parameter);
+        defer { libc_allocator->deallocate(objects); };
+        for (u64 i = 0; i < state->iterations; ++i) {
+            for (u64 j = 0; j < state->parameter; ++j)
+                objects[j] = pool.allocate();
+            clobber_memory();
+            for (u64 j = 0; j < state->parameter; ++j)
+                pool.deallocate(objects[j]);
+        }
+    });
+
+    suite->run("allocator/growable_pool", {1000, 100000}, [](Benchmark_State* state) {
+        Growable_Pool_Allocator<Object_64> pool;
+        pool.init(1024, libc_allocator);
+        defer { pool.deinit(); };
+        Object_64** objects = libc_allocator->allocate<Object_64*>((u32)state->parameter);
+        defer { libc_allocator->deallocate(objects); };
+        for (u64 i = 0; i < state->iterations; ++i) {
+            for (u64 j = 0; j < state->parameter; ++j)
+                objects[j] = pool.allocate();
+            clobber_memory();
+            for (u64 j = 0; j < state->parameter; ++j)
+                pool.deallocate(objects[j]);
+        }
+    });
+
+    suite->run("allocator/typed_bucket", {1000, 100000}, [](Benchmark_State* state) {
+        Typed_Bucket_Allocator<Object_64> buckets;
+        buckets.init(1024, 8, libc_allocator);
+        defer { buckets.deinit(); };
+        Object_64** objects = libc_allocator->allocate<Object_64*>((u32)state->parameter);
+        defer { libc_allocator->deallocate(objects); };
+        for (u64 i = 0; i < state->iterations; ++i) {
+            for (u64 j = 0; j < state->parameter; ++j)
+                objects[j] = buckets.allocate();
+            clobber_memory();
+            for (u64 j = 0; j < state->parameter; ++j)
+                buckets.deallocate(objects[j]);
+        }
+    });
+}
+
+auto benchmark_json(Benchmark_Suite* suite) -> void {
+    using namespace json;
+
+    suite->run("json/pattern_match", {100, 10000}, [](Benchmark_State* state) {
+        state->pause();
+        Pattern p = object({
+            {"name",  p_str(offsetof(Bench_Document, name))},
+            {"items", list(object({
+                            {"id",     p_s32(offsetof(Bench_Item, id))},
+                            {"weight", p_f32(offsetof(Bench_Item, weight))},
+                        }), {
+                        .array_list_offset = offsetof(Bench_Document, items),
+                        .element_size      = sizeof(Bench_Item),
+                    })},
+        });
+
+        Print_Sink sink;
+        sink.init_string(libc_allocator);
+        print_to_sink(&sink, "{\"name\": \"benchmark\", \"items\": [");
+        for (u64 j = 0; j < state->parameter; ++j)
+            print_to_sink(&sink, "%s{\"id\": %llu, \"weight\": %f}", j ? ", " : "", j, j * 0.5);
+        print_to_sink(&sink, "]}");
+        String text = sink.finish(libc_allocator);
+        defer { libc_allocator->deallocate(text.data); };
+
+        Linear_Allocator arena;
+        arena.init(1024 * 1024, libc_allocator);
+        defer { arena.deinit(); };
+        state->resume();
+
+        for (u64 i = 0; i < state->iterations; ++i) {
+            Bench_Document document {};
+            pattern_match(text.data, p, &document, nullptr, (Allocator_Base*)&arena);
+            do_not_optimize(document);
+            arena.reset();
+        }
+    });
+}
+
+auto benchmark_load_obj(Benchmark_Suite* suite) -> void {
+    suite->run("mesh/load_obj", {16, 256}, [](Benchmark_State* state) {
+        // NOTE(Felix): a grid of parameter x parameter vertices
+        state->pause();
+        const char* path = "benchmark_mesh.obj";
+        FILE* file = fopen(path, "wb");
+        if (!file) {
+            log_error("could not write %s", path);
+            return;
+        }
+        u32 side = (u32)state->parameter;
+        print_to_file(file, "o grid\nvn 0.0 1.0 0.0\n");
+        for (u32 y = 0; y < side; ++y) {
+            for (u32 x = 0; x < side; ++x) {
+                print_to_file(file, "v %f 0.0 %f\nvt %f %f\n",
+                              (f32)x, (f32)y, (f32)x / side, (f32)y / side);
+            }
+        }
+        for (u32 y = 0; y + 1 < side; ++y) {
+            for (u32 x = 0; x + 1 < side; ++x) {
+                u32 a = y * side + x + 1;
+                u32 b = a + 1;
+                u32 c = a + side;
+                u32 d = c + 1;
+                print_to_file(file, "f %u/%u/1 %u/%u/1 %u/%u/1\n", a, a, b, b, d, d);
+                print_to_file(file, "f %u/%u/1 %u/%u/1 %u/%u/1\n", a, a, d, d, c, c);
+            }
+        }
+        fclose(file);
+        defer { delete_file(path); };
+        state->resume();
+
+        for (u64 i = 0; i < state->iterations; ++i) {
+            Mesh_Data mesh = load_obj(path);
+            do_not_optimize(mesh.vertices.count);
+            mesh.deinit();
+        }
+    });
+}
+
+auto benchmark_kd_tree(Benchmark_Suite* suite) -> void {
+    auto random_points = [](u64 count, u64 seed) -> Array_List<V3> {
+        Random random {seed};
+        Array_List<V3> points;
+        points.init((u32)count);
+        for (u64 i = 0; i < count; ++i)
+            points.append({random.next_f32(), random.next_f32(), random.next_f32()});
+        return points;
+    };
+
+    suite->run("kd_tree/build", {1000, 100000}, [&](Benchmark_State* state) {
+        Array_List<V3> points = random_points(state->parameter, 1);
+        defer { points.deinit(); };
+        for (u64 i = 0; i < state->iterations; ++i) {
+            auto tree = Kd_Tree<u32>::build_from(points.count, points.data);
+            do_not_optimize(tree.root);
+            tree.deinit();
+        }
+    });
+
+    suite->run("kd_tree/nearest_neighbor", {1000, 100000}, [&](Benchmark_State* state) {
+        Array_List<V3> points  = random_points(state->parameter, 1);
+        Array_List<V3> queries = random_points(1000, 2);
+        auto tree = Kd_Tree<u32>::build_from(points.count, points.data);
+        defer {
+            tree.deinit();
+            queries.deinit();
+            points.deinit();
+        };
+
+        // NOTE(Felix): one iteration is 1000 queries
+        for (u64 i = 0; i < state->iterations; ++i) {
+            for (V3 query : queries) {
+                f32 distance;
+                V3  neighbor;
+                tree.find_nearest_neighbor(query, &distance, &neighbor);
+                do_not_optimize(distance);
+            }
+        }
+    });
+}
+
+auto benchmark_soa_sort(Benchmark_Suite* suite) -> void {
+    suite->run("soa_sort", {1000, 100000}, [](Benchmark_State* state) {
+        u32 count = (u32)state->parameter;
+        u64* keys     = libc_allocator->allocate<u64>(count);
+        u32* payloads = libc_allocator->allocate<u32>(count);
+        defer {
+            libc_allocator->deallocate(keys);
+            libc_allocator->deallocate(payloads);
+        };
+        Array_Description others[] {
+            {.base = payloads, .width = sizeof(payloads[0])},
+        };
+
+        for (u64 i = 0; i < state->iterations; ++i) {
+            state->pause();
+            Random random {i + 1};
+            for (u32 j = 0; j < count; ++j) {
+                keys[j]     = random.next();
+                payloads[j] = j;
+            }
+            state->resume();
+
+            soa_sort({keys, sizeof(keys[0])}, others, array_length(others), count,
+                     compare_u64_void);
+            clobber_memory();
+        }
+    });
+}
+
+int main(int argc, char** argv) {
+    Benchmark_Config config {};
+    const char* json_path = nullptr;
+    for (s32 i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            config.filter = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            config.warmup_seconds = 0.01;
+            config.sample_seconds = 0.002;
+            config.sample_count   = 7;
+        } else {
+            println("usage: %s [--filter <part of name>] [--json <results.json>] [--quick]", argv[0]);
+            return 1;
+        }
+    }
+
+    Benchmark_Suite suite;
+    suite.init(config);
+    defer { suite.deinit(); };
+
+    println("%{color<}%-40s %12s    %8s  %-24s  %s%{>color}", console_green_bold,
+            "benchmark", "median", "mad", "95% ci of median", "iterations x samples");
+    benchmark_containers(&suite);
+    benchmark_allocators(&suite);
+    benchmark_json(&suite);
+    benchmark_load_obj(&suite);
+    benchmark_kd_tree(&suite);
+    benchmark_soa_sort(&suite);
+
+    if (json_path && !suite.write_json(json_path))
+        return 1;
+    return 0;
+}
@@ -15,12 +15,16 @@ fi
 # time g++ -fpermissive src/main.cpp -g -o ./bin/slime --std=c++17 || exit 1
 time clang++ -fsanitize=undefined -rdynamic $CLANG_DEFS -D_DEBUG -D_PROFILING -fpermissive main.cpp -gdwarf-4 -o ./ftb --std=c++17 || exit 1
 # time clang++ -D_DEBUG -D_PROFILING -fpermissive cpu_info.cpp -g -o ./cpu_info --std=c++17 || exit 1
+# time clang++ -O2 -fpermissive json_binary_bench.cpp -o ./json_binary_bench --std=c++17 -lpthread || exit 1
+# time clang++ -O2 -fpermissive print_bench.cpp -o ./print_bench --std=c++17 -lpthread || exit 1
+# time clang++ -O2 -fpermissive benchmarks.cpp -o ./benchmarks --std=c++17 -lpthread || exit 1
 
 echo ""
 # time valgrind --track-origins=yes --leak-check=full --show-leak-kinds=all ./ftb
 valgrind ./ftb
 # time ./ftb || exit 1
 # time ./cpu_info
+# ./benchmarks --json benchmarks.json
 
 popd > /dev/null
 unset TIMEFORMAT
@@ -235,6 +235,18 @@ auto print_full_cpu_info() -> void {
     printf("_resv5:                 %s // (reserved)\n",                                    query_cpu_feature(&info, Ecx_81_Extended_Feature_Flags::_resv5)         ? "yes" : "no ");
     printf("_resv6:                 %s // (reserved)\n",                                    query_cpu_feature(&info, Ecx_81_Extended_Feature_Flags::_resv6)         ? "yes" : "no ");
     printf("_resv7:                 %s // (reserved)\n",                                    query_cpu_feature(&info, Ecx_81_Extended_Feature_Flags::_resv7)         ? "yes" : "no ");
+    printf("-----------------------------\n");
+    printf("Edx_87_Power_Management_Flags\n");
+    printf("-----------------------------\n");
+    printf("ts:                     %s  // Temperature sensor\n",                                 query_cpu_feature(&info, Edx_87_Power_Management_Flags::ts)            ? "yes" : "no ");
+    printf("fid:                    %s  // Frequency ID control\n",                               query_cpu_feature(&info, Edx_87_Power_Management_Flags::fid)           ? "yes" : "no ");
+    printf("vid:                    %s  // Voltage ID control\n",                                 query_cpu_feature(&info, Edx_87_Power_Management_Flags::vid)           ? "yes" : "no ");
+    printf("ttp:                    %s  // THERMTRIP\n",                                          query_cpu_feature(&info, Edx_87_Power_Management_Flags::ttp)           ? "yes" : "no ");
+    printf("tm:                     %s  // Hardware thermal control\n",                           query_cpu_feature(&info, Edx_87_Power_Management_Flags::tm)            ? "yes" : "no ");
+    printf("_resv1:                 %s  // (reserved)\n",                                         query_cpu_feature(&info, Edx_87_Power_Management_Flags::_resv1)        ? "yes" : "no ");
+    printf("mul100:                 %s  // 100 MHz multiplier control\n",                         query_cpu_feature(&info, Edx_87_Power_Management_Flags::mul100)        ? "yes" : "no ");
+    printf("hw_pstate:              %s  // Hardware P-state control\n",                           query_cpu_feature(&info, Edx_87_Power_Management_Flags::hw_pstate)     ? "yes" : "no ");
+    printf("invariant_tsc:          %s  // TSC rate is invariant across P-, C- and T-states\n",   query_cpu_feature(&info, Edx_87_Power_Management_Flags::invariant_tsc) ? "yes" : "no ");
 }
 
 int main() {
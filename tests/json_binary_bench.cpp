@@ -0,0 +1,134 @@
+// Compares the binary pattern encoding against json text for the same
+// schema. Build with optimizations, e.g.:
+//   g++ -O2 -fpermissive json_binary_bench.cpp -o json_binary_bench --std=c++17 -lpthread
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+
+#define FTB_CORE_IMPL
+#define FTB_PARSING_IMPL
+#define FTB_JSON_IMPL
+#define FTB_HASHMAP_IMPL
+#define FTB_PROFILER_IMPL
+
+#include "../core.hpp"
+#include "../json.hpp"
+#include "../profiler.hpp"
+
+struct Vertex {
+    s32 index;
+    f32 position[3];
+    f32 normal[3];
+    bool selected;
+};
+
+struct Mesh {
+    String name;
+    s64    version;
+    Array_List<Vertex> vertices;
+};
+
+template <typename Fun>
+auto run(const char* name, u32 iterations, u64 bytes_per_iteration, Fun&& fun) -> void {
+    // NOTE(Felix): one warm up round, then take the best of a few rounds
+    fun();
+    u64 best = (u64)-1;
+    for (u32 round = 0; round < 5; ++round) {
+        Time_Stamp start = start_timer();
+        for (u32 i = 0; i < iterations; ++i)
+            fun();
+        best = MIN(best, stop_timer(start));
+    }
+
+    // NOTE(Felix): `best` covers all iterations of a round, report one
+    f64 seconds = best / 1.0e9;
+    println("  %-16s %8.3f ms/iteration  %8.1f MB/s", name, best / 1.0e6 / iterations,
+            (bytes_per_iteration * (f64)iterations) / seconds / (1024.0 * 1024.0));
+}
+
+int main() {
+    using namespace json;
+
+    Pattern p = json::object({
+        {"name",     p_str(offsetof(Mesh, name))},
+        {"version",  p_s64(offsetof(Mesh, version))},
+        {"vertices", list(object({
+                        {"index",    p_s32(offsetof(Vertex, index))},
+                        {"position", p_f32_arr<3>(offsetof(Vertex, position))},
+                        {"normal",   p_f32_arr<3>(offsetof(Vertex, normal))},
+                        {"selected", p_bool(offsetof(Vertex, selected))},
+                    }), {
+                    .array_list_offset = offsetof(Mesh, vertices),
+                    .element_size      = sizeof(Vertex),
+                })},
+    });
+
+    const u32 vertex_count = 100000;
+
+    Mesh mesh {};
+    mesh.name    = string_from_literal("benchmark mesh");
+    mesh.version = 1234567;
+    mesh.vertices.init(vertex_count);
+    defer { mesh.vertices.deinit(); };
+
+    u64 state = 0x1234;
+    auto next_f32 = [&]() -> f32 {
+        state = state * 6364136223846793005llu + 1442695040888963407llu;
+        return (f32)(state >> 40) / (1 << 12) - 2048.0f;
+    };
+    for (u32 i = 0; i < vertex_count; ++i) {
+        mesh.vertices.append({
+            .index    = (s32)i,
+            .position = {next_f32(), next_f32(), next_f32()},
+            .normal   = {next_f32(), next_f32(), next_f32()},
+            .selected = i % 7 == 0,
+        });
+    }
+
+    Allocated_String text   = write_pattern_to_string(p, &mesh);
+    Allocated_String binary = write_pattern_to_binary(p, &mesh);
+    defer {
+        text.free();
+        binary.free();
+    };
+
+    println("%u vertices", vertex_count);
+    println("  json text:   %10llu bytes", text.string.length);
+    println("  binary:      %10llu bytes (%.1f%%)", binary.string.length,
+            100.0 * binary.string.length / text.string.length);
+
+    const u32 iterations = 3;
+    Linear_Allocator arena;
+    arena.init(1024 * 1024 * 64, libc_allocator);
+    defer { arena.deinit(); };
+
+    println("encode");
+    run("json text", iterations, text.string.length, [&]() {
+        Allocated_String s = write_pattern_to_string(p, &mesh);
+        s.free();
+    });
+    run("binary", iterations, binary.string.length, [&]() {
+        Allocated_String s = write_pattern_to_binary(p, &mesh);
+        s.free();
+    });
+
+    Compiled_Pattern plan = compile(p);
+    defer { plan.deinit(); };
+    println("decode");
+    run("json compiled", iterations, text.string.length, [&]() {
+        Mesh read {};
+        pattern_match(text.string.data, plan, &read, nullptr, (Allocator_Base*)&arena);
+        arena.reset();
+    });
+    run("json text", iterations, text.string.length, [&]() {
+        Mesh read {};
+        pattern_match(text.string.data, p, &read, nullptr, (Allocator_Base*)&arena);
+        arena.reset();
+    });
+    run("binary", iterations, binary.string.length, [&]() {
+        Mesh read {};
+        pattern_match_binary(binary.string.data, binary.string.length, p, &read, (Allocator_Base*)&arena);
+        arena.reset();
+    });
+
+    return 0;
+}
@@ -19,6 +19,12 @@
 #define FTB_JSON_IMPL
 #define FTB_MESH_IMPL
 #define FTB_PARSING_IMPL
+#define FTB_FILE_WATCHER_IMPL
+#define FTB_PROFILER_IMPL
+#define FTB_PROFILER_TRACE
+#define FTB_PROFILER_AGGREGATE
+#define FTB_PROFILER_COUNTERS
+#define FTB_BENCHMARK_IMPL
 
 #include "../math.hpp"
 #include "../core.hpp"
@@ -37,6 +43,9 @@ inline bool hm_objects_match(Key a, Key b);
 #include "../hooks.hpp"
 #include "../ringbuffer.hpp"
 #include "../hashmap.hpp"
+#include "../file_watcher.hpp"
+#include "../profiler.hpp"
+#include "../benchmark.hpp"
 #include "../scheduler.hpp"
 #include "../soa_sort.hpp"
 #include "../kd_tree.hpp"
@@ -138,12 +147,12 @@ auto test_obj_to_json_str() -> testresult {
 
                     return length;
                 },
-                .custom_writer = [](FILE* out_file, void* color_to_write) -> u32 {
+                .custom_writer = [](Print_Sink* sink, void* color_to_write) -> u32 {
                     Color* out_color = (Color*)color_to_write;
                     switch (*out_color) {
-                        case Color::Red:   return print_to_file(out_file, "\"red\"");
-                        case Color::Green: return print_to_file(out_file, "\"green\"");
-                        case Color::Blue:  return print_to_file(out_file, "\"blue\"");
+                        case Color::Red:   return print_to_sink(sink, "\"red\"");
+                        case Color::Green: return print_to_sink(sink, "\"green\"");
+                        case Color::Blue:  return print_to_sink(sink, "\"blue\"");
                         default: panic("Unknown color %d", *out_color);
                     }
                 }
@@ -217,8 +226,583 @@ auto test_obj_to_json_str() -> testresult {
     return pass;
 }
 
-auto print_dots(FILE* f) -> u32 {
-    return print_to_file(f, "...");
+auto print_dots(Print_Sink* f) -> u32 {
+    return print_to_sink(f, "...");
+}
+
+auto test_print_to_string() -> testresult {
+    register_printer("dots", print_dots, Printer_Function_Type::_void);
+
+    String name = string_from_literal("ftb");
+    String str;
+    s32 printed = print_to_string(&str, nullptr, "%{u32} %{dots} %{->Str} %d|%5.2f|%{bool}",
+                                  42, &name, 7, 1.5, true);
+    defer { str.free(); };
+
+    assert_equal_int(printed, str.length);
+    assert_equal_int(str.data[str.length], '\0');
+    assert_equal_string(str, string_from_literal("42 ... ftb 7| 1.50|true"));
+
+    // NOTE(Felix): longer than the sink's stack buffer, even a single
+    //   conversion, so it has to grow
+    char long_arg[3000];
+    memset(long_arg, 'x', sizeof(long_arg)-1);
+    long_arg[sizeof(long_arg)-1] = '\0';
+
+    String long_str;
+    printed = print_to_string(&long_str, nullptr, "[%s]%{u32}", long_arg, 5);
+    defer { long_str.free(); };
+
+    assert_equal_int(printed, 3002);
+    assert_equal_int(long_str.length, 3002);
+    assert_equal_int(long_str.data[0],    '[');
+    assert_equal_int(long_str.data[2999], 'x');
+    assert_equal_int(long_str.data[3000], ']');
+    assert_equal_int(long_str.data[3001], '5');
+    assert_equal_int(long_str.data[3002], '\0');
+
+    return pass;
+}
+
+auto test_print_to_file() -> testresult {
+    const char* path = "print_to_file_test.txt";
+    FILE* file = fopen(path, "wb");
+    assert_true(file != nullptr);
+    defer { delete_file(path); };
+
+    // NOTE(Felix): the file sinks buffer 1024 bytes, this has conversions
+    //   that fit, ones that overflow the rest of the buffer and ones bigger
+    //   than the buffer
+    char long_arg[3000];
+    memset(long_arg, 'x', sizeof(long_arg)-1);
+    long_arg[sizeof(long_arg)-1] = '\0';
+
+    Print_Sink sink;
+    sink.init_string();
+    for (u32 i = 0; i < 40; ++i)
+        print_to_sink(&sink, "line %{u32}: %.*s|%d%%\n", i, i * 50, long_arg, -(s32)i);
+    String expected = sink.finish();
+    defer { expected.free(); };
+
+    s32 printed = 0;
+    for (u32 i = 0; i < 40; ++i)
+        printed += print_to_file(file, "line %{u32}: %.*s|%d%%\n", i, i * 50, long_arg, -(s32)i);
+    fclose(file);
+
+    assert_equal_int(printed, expected.length);
+
+    File_Read written = read_entire_file(path);
+    defer { written.contents.free(); };
+    assert_true(written.success);
+    assert_equal_string(written.contents.string, expected);
+
+    return pass;
+}
+
+auto test_profiler_clock() -> testresult {
+    // NOTE(Felix): with the TSC the timestamps are calibrated to line up
+    //   with the OS clock, they should stay within a few micro seconds
+    u64 os_before = profiler_os_timestamp();
+    u64 timestamp = profiler_timestamp();
+    u64 os_after  = profiler_os_timestamp();
+    assert_true(timestamp + 50'000 >= os_before);
+    assert_true(timestamp <= os_after + 50'000);
+
+    Time_Stamp start    = start_timer();
+    u64        os_start = profiler_os_timestamp();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    u64 elapsed    = stop_timer(start);
+    u64 os_elapsed = profiler_os_timestamp() - os_start;
+    assert_true(elapsed >= os_elapsed - os_elapsed / 100);
+    assert_true(elapsed <= os_elapsed + os_elapsed / 100);
+
+    return pass;
+}
+
+auto test_profiler_counters() -> testresult {
+    Profile_Counters start;
+    bool available;
+    ignore_stdout {
+        available = profiler_read_counters(&start);
+    }
+    if (!available) {
+        // NOTE(Felix): no PMU in VMs, containers or with a strict
+        //   perf_event_paranoid
+        for (u64 value : start.values)
+            assert_equal_int(value, 0);
+        return skipped;
+    }
+
+    volatile u32 sum = 0;
+    for (u32 i = 0; i < 100000; ++i)
+        sum += i;
+
+    Profile_Counters end;
+    assert_true(profiler_read_counters(&end));
+    u32 instructions = (u32)Profile_Counter::Instructions;
+    assert_true(end.values[instructions] - start.values[instructions] >= 100000);
+
+    return pass;
+}
+
+auto test_profiler_trace() -> testresult {
+    const char* path = "profiler_trace_test.json";
+    profiler_reset();
+    defer {
+        profiler_reset();
+        delete_file(path);
+    };
+
+    profiler_set_thread_name("main \"thread\"");
+    profile_named_block("outer") {
+        for (u32 i = 0; i < 3; ++i) {
+            profile_block {}
+        }
+    }
+
+    // NOTE(Felix): more events than fit into one chunk
+    std::thread worker([] {
+        profiler_set_thread_name("worker");
+        for (u32 i = 0; i < 5000; ++i) {
+            profile_named_block("step") {}
+        }
+    });
+    worker.join();
+
+    assert_true(profiler_write_trace(path));
+
+    File_Read written = read_entire_file(path);
+    defer { written.contents.free(); };
+    assert_true(written.success);
+
+    auto count = [&](const char* needle) -> u32 {
+        u32 result = 0;
+        for (const char* at = strstr(written.contents.string.data, needle); at; at = strstr(at+1, needle))
+            ++result;
+        return result;
+    };
+    assert_equal_int(count("\"ph\":\"B\""), 5004);
+    assert_equal_int(count("\"ph\":\"E\""), 5004);
+    assert_equal_int(count("\"name\":\"step\""), 5000);
+    assert_equal_int(count("\"name\":\"outer\""), 1);
+    assert_equal_int(count("\"main \\\"thread\\\"\""), 1);
+    assert_equal_int(count("\"ph\":\"M\""), 2);
+
+    return pass;
+}
+
+auto test_profiler_aggregate() -> testresult {
+    const char* path = "profiler_report_test.json";
+    profiler_reset();
+    defer {
+        profiler_reset();
+        delete_file(path);
+    };
+
+    auto work = [] {
+        profile_named_block("aggregate outer") {
+            for (u32 i = 0; i < 10; ++i) {
+                profile_named_block("aggregate inner") {}
+            }
+        }
+    };
+    work();
+    std::thread worker(work);
+    worker.join();
+
+    Profile_Report_Node root;
+    profile_snapshot(&root);
+    defer { profile_free_report(&root); };
+
+    // NOTE(Felix): both threads are merged into one tree
+    Profile_Report_Node* outer = root.first_child;
+    while (outer && strcmp(outer->location->name, "aggregate outer") != 0)
+        outer = outer->next_sibling;
+    assert_true(outer != nullptr);
+    assert_equal_int(outer->count, 2);
+
+    Profile_Report_Node* inner = outer->first_child;
+    assert_true(inner != nullptr);
+    assert_true(inner->next_sibling == nullptr);
+    assert_equal_int(strcmp(inner->location->name, "aggregate inner"), 0);
+    assert_equal_int(inner->count, 20);
+    assert_equal_int(outer->children, inner->inclusive);
+    assert_true(inner->min <= profile_percentile(inner, 0.5));
+    assert_true(profile_percentile(inner, 0.5) <= profile_percentile(inner, 0.99));
+    assert_true(profile_percentile(inner, 0.99) <= inner->max);
+
+    // NOTE(Felix): percentiles come from the middle of a histogram bucket
+    for (u64 nanos : {0ull, 7ull, 8ull, 100ull, 12345ull, 987654321ull}) {
+        u64 middle = profile_histogram_bucket_middle(profile_histogram_bucket(nanos));
+        assert_true((middle > nanos ? middle - nanos : nanos - middle) <= nanos / 16);
+    }
+
+    // NOTE(Felix): every row of the report is one message, so the prefix is
+    //   printed once per line, at its start
+    const char* report_path = "profiler_report_test.txt";
+    FILE* report_file = fopen(report_path, "wb");
+    assert_true(report_file != nullptr);
+    defer { delete_file(report_path); };
+    FILE* old_stdout = ftb_stdout;
+    ftb_stdout = report_file;
+    with_print_prefix("P> ") {
+        profiler_report();
+    }
+    ftb_stdout = old_stdout;
+    fclose(report_file);
+    {
+        File_Read report = read_entire_file(report_path);
+        defer { report.contents.free(); };
+        assert_true(report.success);
+
+        u32 lines = 0;
+        u32 bad   = 0;
+        for (char* line = report.contents.string.data; *line;) {
+            char* line_end = strchr(line, '\n');
+            if (!line_end)
+                break;
+            *line_end = '\0';
+            bad += strncmp(line, "P> ", 3) != 0 || strstr(line+3, "P> ") != nullptr;
+            ++lines;
+            line = line_end + 1;
+        }
+        assert_true(lines >= 3);
+        assert_equal_int(bad, 0);
+    }
+
+    // NOTE(Felix): multiplexed counters: only the difference is scaled, by
+    //   the enabled/running ratio of the interval in between
+    {
+        Profile_Counters start {};
+        Profile_Counters end {};
+        u64 delta[(u32)Profile_Counter::Count];
+
+        start.values[0] = 100;  start.time_enabled = 1000; start.time_running = 500;
+        end.values[0]   = 300;  end.time_enabled   = 2000; end.time_running   = 1000;
+        profiler_counter_deltas(&start, &end, delta);
+        assert_equal_int(delta[0], 400);
+
+        // NOTE(Felix): scaling the reads themselves would give 10000 and
+        //   2000 here, and the difference would wrap around
+        start.values[0] = 1000; start.time_enabled = 1000; start.time_running = 100;
+        end.values[0]   = 1100; end.time_enabled   = 2000; end.time_running   = 1100;
+        profiler_counter_deltas(&start, &end, delta);
+        assert_equal_int(delta[0], 100);
+
+        // NOTE(Felix): not running in between
+        end.values[0] = 1000; end.time_running = 100;
+        profiler_counter_deltas(&start, &end, delta);
+        assert_equal_int(delta[0], 0);
+    }
+
+    assert_true(profiler_write_report(path));
+    File_Read written = read_entire_file(path);
+    defer { written.contents.free(); };
+    assert_true(written.success);
+    assert_true(strstr(written.contents.string.data, "\"name\":\"aggregate inner\",") != nullptr);
+
+    profiler_reset();
+    Profile_Report_Node after_reset;
+    profile_snapshot(&after_reset);
+    defer { profile_free_report(&after_reset); };
+    for (Profile_Report_Node* node = after_reset.first_child; node; node = node->next_sibling)
+        assert_equal_int(node->count, 0);
+
+    return pass;
+}
+
+auto test_benchmark() -> testresult {
+    f64 samples[] = {5, 1, 4, 2, 3, 100};
+    Benchmark_Result summary {};
+    benchmark_summarize(samples, array_length(samples), &summary);
+    assert_equal_f64(summary.median, 3.5);
+    assert_equal_f64(summary.mad, 1.5);
+    assert_equal_f64(summary.mean, 115.0 / 6);
+    assert_equal_f64(summary.min, 1);
+    assert_equal_f64(summary.max, 100);
+    assert_equal_f64(summary.ci_low, 1);
+    assert_equal_f64(summary.ci_high, 100);
+
+    const char* path = "benchmark_test.json";
+    defer { delete_file(path); };
+
+    Benchmark_Suite suite;
+    suite.init({
+        .warmup_seconds = 0,
+        .sample_seconds = 0.0001,
+        .sample_count   = 3,
+        .filter         = "sum",
+    });
+    defer { suite.deinit(); };
+
+    ignore_stdout {
+        suite.run("sum", {10, 1000}, [](Benchmark_State* state) {
+            for (u64 i = 0; i < state->iterations; ++i) {
+                u64 sum = 0;
+                for (u64 j = 0; j < state->parameter; ++j)
+                    sum += j;
+                do_not_optimize(sum);
+            }
+        });
+        suite.run("filtered out", [](Benchmark_State* state) {});
+    }
+
+    assert_equal_int(suite.results.count, 2);
+    assert_equal_int(suite.results[1].parameter, 1000);
+    for (Benchmark_Result& result : suite.results) {
+        assert_true(result.iterations > 1);
+        assert_equal_int(result.samples, 3);
+        assert_true(result.min <= result.median);
+        assert_true(result.median <= result.max);
+    }
+
+    assert_true(suite.write_json(path));
+    File_Read written = read_entire_file(path);
+    defer { written.contents.free(); };
+    assert_true(written.success);
+    assert_true(strstr(written.contents.string.data, "\"name\":\"sum\",\"parameter\":1000,") != nullptr);
+
+    // NOTE(Felix): a body that takes no time stops growing at the cap
+    Benchmark_Suite capped;
+    capped.init({
+        .warmup_seconds = 0,
+        .sample_seconds = 0.0001,
+        .sample_count   = 3,
+        .max_iterations = 1000,
+    });
+    defer { capped.deinit(); };
+
+    ignore_stdout {
+        capped.run("empty", [](Benchmark_State*) {});
+    }
+    assert_equal_int(capped.results.count, 1);
+    assert_equal_int(capped.results[0].iterations, 1000);
+
+    return pass;
+}
+
+auto test_print_from_threads() -> testresult {
+    const char* path = "print_from_threads_test.txt";
+    FILE* file = fopen(path, "wb");
+    assert_true(file != nullptr);
+    defer { delete_file(path); };
+
+    const u32 thread_count     = 4;
+    const u32 lines_per_thread = 500;
+    const char* prefixes[thread_count] = { "a> ", "b> ", "c> ", "d> " };
+    const char* colors[thread_count]   = { console_red, console_green, console_blue, console_cyan };
+
+    // NOTE(Felix): every thread has its own prefix and color and logs every
+    //   other line; the long argument does not fit the sinks' buffers, so
+    //   these lines only stay whole because of the file lock
+    char long_arg[1500];
+    memset(long_arg, 'x', sizeof(long_arg)-1);
+    long_arg[sizeof(long_arg)-1] = '\0';
+
+    FILE* old_stdout = ftb_stdout;
+    ftb_stdout = file;
+    {
+        std::thread threads[thread_count];
+        for (u32 t = 0; t < thread_count; ++t) {
+            threads[t] = std::thread([&, t]() {
+                with_print_prefix(prefixes[t]) {
+                    for (u32 i = 0; i < lines_per_thread; ++i) {
+                        const char* arg = i % 25 == 0 ? long_arg : "";
+                        if (i % 2)
+                            log_info("%u %u %s", t, i, arg);
+                        else
+                            println("%{color<}%u %{u32}%{>color} %s", colors[t], t, i, arg);
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+    ftb_stdout = old_stdout;
+    fclose(file);
+
+    File_Read written = read_entire_file(path);
+    defer { written.contents.free(); };
+    assert_true(written.success);
+
+    u32 next_line[thread_count] {};
+    u32 lines    = 0;
+    u32 bad      = 0;
+    char* cursor = written.contents.string.data;
+    char* end    = cursor + written.contents.string.length;
+    while (cursor < end) {
+        char* line_end = (char*)memchr(cursor, '\n', end - cursor);
+        if (!line_end)
+            break;
+        *line_end = '\0';
+
+        u32 t = cursor[0] - 'a';
+        char expected[2048];
+        if (t < thread_count) {
+            u32 i = next_line[t];
+            const char* arg = i % 25 == 0 ? long_arg : "";
+            if (i % 2)
+                snprintf(expected, sizeof(expected), "%s%s[  INFO ] %u %u %s%s",
+                         prefixes[t], console_green, t, i, arg, console_normal);
+            else
+                snprintf(expected, sizeof(expected), "%s%s%u %u%s %s",
+                         prefixes[t], colors[t], t, i, console_normal, arg);
+            bad += strcmp(cursor, expected) != 0;
+            ++next_line[t];
+        } else {
+            ++bad;
+        }
+
+        ++lines;
+        cursor = line_end + 1;
+    }
+
+    assert_equal_int(lines, thread_count * lines_per_thread);
+    assert_equal_int(bad, 0);
+
+    return pass;
+}
+
+auto print_twice(Print_Sink* sink, u32 value) -> s32 {
+    return print_to_sink(sink, "%u%u", value, value);
+}
+
+auto test_static_print() -> testresult {
+    register_printer("twice", print_twice, Printer_Function_Type::_32b);
+
+    String name   = string_from_literal("ftb");
+    s32    list[] = {3, -4, 5};
+
+    Print_Sink sink;
+    sink.init_string();
+    s32 printed = static_print_to_sink(
+        &sink, "%{u32} %{->Str} %d|%5.2f|%{bool}|%s|%lld|%u|%-4s|%*d|%x|%{u32,2}|%{s32[*]}|%{twice}|100%%",
+        42, &name, -7, 1.5, true, "str", (s64)-5, -1, "ab", 3, 9, 255, 1, 2, list, 3, 6);
+    String str = sink.finish();
+    defer { str.free(); };
+
+    // NOTE(Felix): has to print exactly what the runtime parsed printer does
+    String expected;
+    print_to_string(&expected, nullptr,
+        "%{u32} %{->Str} %d|%5.2f|%{bool}|%s|%lld|%u|%-4s|%*d|%x|%{u32,2}|%{s32[*]}|%{twice}|100%%",
+        42, &name, -7, 1.5, true, "str", (s64)-5, -1, "ab", 3, 9, 255, 1, 2, list, 3, 6);
+    defer { expected.free(); };
+
+    assert_equal_string(str, expected);
+    assert_equal_string(str, string_from_literal(
+        "42 ftb -7| 1.50|true|str|-5|4294967295|ab  |  9|ff|[1, 2]|[3, -4, 5]|66|100%"));
+    assert_equal_int(printed, str.length);
+
+    // NOTE(Felix): a format without arguments is a single literal
+    sink.init_string();
+    printed = static_print_to_sink(&sink, "just text");
+    String text = sink.finish();
+    defer { text.free(); };
+    assert_equal_string(text, string_from_literal("just text"));
+    assert_equal_int(printed, 9);
+
+    return pass;
+}
+
+auto test_async_log() -> testresult {
+    const char* path = "async_log_test.txt";
+    FILE* file = fopen(path, "wb");
+    assert_true(file != nullptr);
+    defer { delete_file(path); };
+
+    const u32 thread_count      = 4;
+    const u32 lines_per_thread  = 2000;
+
+    // NOTE(Felix): small buffers, so the producers have to wait and wrap
+    start_async_log(file, 4096);
+    {
+        std::thread threads[thread_count];
+        for (u32 t = 0; t < thread_count; ++t) {
+            threads[t] = std::thread([t]() {
+                for (u32 i = 0; i < lines_per_thread; ++i) {
+                    // NOTE(Felix): the strings are gone before they are printed
+                    char prefix[16];
+                    char name[16];
+                    snprintf(prefix, sizeof(prefix), "[%u] ", t);
+                    snprintf(name, sizeof(name), "thread-%u", t);
+                    with_print_prefix(prefix) {
+                        async_log("%s line %{u32} %.1f\n", name, i, 0.5);
+                    }
+                    memset(prefix, 0, sizeof(prefix));
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+
+        // NOTE(Felix): follows a pointer, so it is formatted right away
+        String name = string_from_literal("ftb");
+        async_log("last %{->Str}\n", &name);
+    }
+    stop_async_log();
+    fclose(file);
+
+    file = fopen(path, "rb");
+    assert_true(file != nullptr);
+    defer { fclose(file); };
+
+    u32  next_line[thread_count] {};
+    u32  lines    = 0;
+    bool in_order = true;
+    char line[128];
+    char last[128] {};
+    while (fgets(line, sizeof(line), file)) {
+        u32 p, t, i;
+        if (sscanf(line, "[%u] thread-%u line %u 0.5", &p, &t, &i) == 3 && t < thread_count) {
+            in_order &= next_line[t] == i && p == t;
+            next_line[t] = i + 1;
+            ++lines;
+        } else {
+            strcpy(last, line);
+        }
+    }
+
+    assert_equal_int(lines, thread_count * lines_per_thread);
+    assert_equal_int(in_order, true);
+    assert_equal_int(strcmp(last, "last ftb\n"), 0);
+
+    // NOTE(Felix): stopping while other threads still log loses nothing,
+    //   their messages are either drained or printed right away
+    const char* racing_path = "async_log_race_test.txt";
+    FILE* racing_file = fopen(racing_path, "wb");
+    assert_true(racing_file != nullptr);
+    defer { delete_file(racing_path); };
+
+    start_async_log(racing_file, 4096);
+    {
+        std::atomic<u32> started { 0 };
+        std::thread threads[thread_count];
+        for (u32 t = 0; t < thread_count; ++t) {
+            threads[t] = std::thread([&started, t]() {
+                ++started;
+                for (u32 i = 0; i < lines_per_thread; ++i)
+                    async_log("racing %{u32} %{u32}\n", t, i);
+            });
+        }
+        while (started.load() != thread_count)
+            std::this_thread::yield();
+        stop_async_log();
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+    fclose(racing_file);
+
+    racing_file = fopen(racing_path, "rb");
+    assert_true(racing_file != nullptr);
+    defer { fclose(racing_file); };
+
+    u32 racing_lines = 0;
+    while (fgets(line, sizeof(line), racing_file))
+        racing_lines += strncmp(line, "racing ", 7) == 0;
+    assert_equal_int(racing_lines, thread_count * lines_per_thread);
+
+    return pass;
 }
 
 auto test_scratch_arena_can_realloc_last_alloc() -> testresult {
@@ -379,6 +963,37 @@ auto test_hashmap() -> testresult {
     return pass;
 }
 
+auto test_string_interner() -> testresult {
+    String_Interner interner;
+    interner.init(4);
+    defer { interner.deinit(); };
+
+    Interned_Id hello = interner.intern("hello");
+    Interned_Id world = interner.intern("world");
+
+    assert_true(hello != world);
+    assert_equal_int(interner.intern("hello"), hello);
+    assert_equal_int(interner.lookup("world", 5), world);
+    assert_equal_int(interner.lookup("hello world", 5), hello);
+    assert_equal_int(interner.lookup("nope", 4), INTERNED_ID_INVALID);
+    assert_equal_string(interner.get_string(world), string_from_literal("world"));
+
+    // NOTE(Felix): enough strings to grow the table and span several chunks
+    char buffer[32];
+    for (u32 i = 0; i < 1000; ++i) {
+        u32 length = snprintf(buffer, sizeof(buffer), "key_%u", i);
+        assert_equal_int(interner.intern(buffer, length), i+2);
+    }
+    for (u32 i = 0; i < 1000; ++i) {
+        u32 length = snprintf(buffer, sizeof(buffer), "key_%u", i);
+        assert_equal_int(interner.lookup(buffer, length), i+2);
+        assert_equal_string(interner.get_string(i+2), String::over(buffer));
+    }
+    assert_equal_int(interner.lookup("hello", 5), hello);
+
+    return pass;
+}
+
 auto test_array_lists_adding_and_removing() -> testresult {
     // test adding and removing
     Array_List<s32> list;
@@ -702,6 +1317,112 @@ auto test_array_list_sort_many() -> testresult {
     return pass;
 }
 
+auto test_number_parsing() -> testresult {
+    const char* floats[] = {
+        "0", "-0", "1", "0.1", "3.14159", "-2.5e-3", "1E10", "6.02214076e23",
+        "3.4028234e38", "3.4028236e38", "1e39", "1.17549435e-38", "1.4e-45",
+        "7e-46", "1e-50", "0.000000000000000000000000000000123",
+        "16777217", "9007199254740993", "123456789012345678901234567890",
+        "0.10000000149011611938", "1.00000005960464477539062499",
+        "1.000000059604644775390625", "4.7019774e-38", "2.",
+    };
+    for (const char* f : floats) {
+        u32 length = (u32)strlen(f);
+        char* strtof_end;
+        f32 expected = strtof(f, &strtof_end);
+        f32 read;
+        assert_equal_int(read_float(f, &read), strtof_end-f);
+        assert_equal_int(memcmp(&read, &expected, sizeof(f32)), 0);
+        assert_equal_int(read_float(f, f+length, &read), strtof_end-f);
+        assert_equal_int(memcmp(&read, &expected, sizeof(f32)), 0);
+    }
+
+    // NOTE(Felix): random decimals of all lengths and magnitudes
+    u64 state = 0x1234567;
+    auto next = [&]() -> u64 {
+        state = state * 6364136223846793005llu + 1442695040888963407llu;
+        return state >> 33;
+    };
+    char buffer[64];
+    for (u32 i = 0; i < 100000; ++i) {
+        u32 length = snprintf(buffer, sizeof(buffer), "%s%llu.%llue%d",
+                              next() & 1 ? "-" : "",
+                              (unsigned long long)(next() % (1llu << (next() % 31))),
+                              (unsigned long long)next(),
+                              (s32)(next() % 90) - 50);
+        f32 expected = strtof(buffer, nullptr);
+        f32 read;
+        assert_equal_int(read_float(buffer, buffer+length, &read), length);
+        assert_equal_int(memcmp(&read, &expected, sizeof(f32)), 0);
+    }
+
+    const char* longs[] = {
+        "0", "-1", "+42", "  17", "12345678", "-123456789012",
+        "9223372036854775807", "-9223372036854775808",
+        "9223372036854775808", "-99999999999999999999", "00000000000000000000001",
+    };
+    for (const char* l : longs) {
+        char* strtoll_end;
+        s64 expected = strtoll(l, &strtoll_end, 10);
+        s64 read;
+        assert_equal_int(read_long(l, &read), strtoll_end-l);
+        assert_equal_int(read, expected);
+        assert_equal_int(read_long(l, l+strlen(l), &read), strtoll_end-l);
+        assert_equal_int(read, expected);
+
+        s32 read_s32;
+        assert_equal_int(read_int(l, l+strlen(l), &read_s32), strtoll_end-l);
+        assert_equal_int(read_s32, (s32)expected);
+    }
+
+    assert_equal_int(eat_number("1.5e-3,"),   6);
+    assert_equal_int(eat_number("-2E+10]"),   6);
+    assert_equal_int(eat_number("7e5 "),      3);
+    assert_equal_int(eat_number("3.25"),      4);
+
+    return pass;
+}
+
+auto test_number_formatting() -> testresult {
+    char buffer[32];
+    auto formatted = [&](u32 length) -> String {
+        return String{.data = buffer, .length = length};
+    };
+
+    assert_equal_string(formatted(format_u64(0, buffer)),          string_from_literal("0"));
+    assert_equal_string(formatted(format_u64(1234567, buffer)),    string_from_literal("1234567"));
+    assert_equal_string(formatted(format_s64(-90, buffer)),        string_from_literal("-90"));
+    assert_equal_string(formatted(format_s64(INT64_MIN, buffer)),  string_from_literal("-9223372036854775808"));
+    assert_equal_string(formatted(format_u64(UINT64_MAX, buffer)), string_from_literal("18446744073709551615"));
+
+    assert_equal_string(formatted(format_f32(0.0f, buffer)),        string_from_literal("0"));
+    assert_equal_string(formatted(format_f32(0.1f, buffer)),        string_from_literal("0.1"));
+    assert_equal_string(formatted(format_f32(-2.5f, buffer)),       string_from_literal("-2.5"));
+    assert_equal_string(formatted(format_f32(100.0f, buffer)),      string_from_literal("100"));
+    assert_equal_string(formatted(format_f32(3.14159265f, buffer)), string_from_literal("3.1415927"));
+    assert_equal_string(formatted(format_f32(1e-7f, buffer)),       string_from_literal("1e-7"));
+    assert_equal_string(formatted(format_f32(3.4028235e38f, buffer)), string_from_literal("3.4028235e38"));
+    assert_equal_string(formatted(format_f32(1.4e-45f, buffer)),    string_from_literal("1e-45"));
+
+    // NOTE(Felix): everything has to read back to the same float
+    u64 state = 0x9e3779b9;
+    for (u32 i = 0; i < 100000; ++i) {
+        state = state * 6364136223846793005llu + 1442695040888963407llu;
+        u32 bits = (u32)(state >> 32);
+        f32 value;
+        memcpy(&value, &bits, sizeof(value));
+        if (value != value)
+            continue;
+
+        u32 length = format_f32(value, buffer);
+        buffer[length] = '\0';
+        f32 read_back = strtof(buffer, nullptr);
+        assert_equal_int(memcmp(&read_back, &value, sizeof(value)), 0);
+    }
+
+    return pass;
+}
+
 auto test_string_split() -> testresult {
     {
         String s = {
@@ -2013,6 +2734,819 @@ auto test_json_simple_object_new_syntax() -> testresult {
 }
 
 
+auto test_json_wide_object_member_lookup() -> testresult {
+    using namespace json;
+    const char* json_object = R"JSON(
+        {
+          "k11": 11, "k10": 10, "k9": 9, "k8": 8,
+          "unknown": [1, 2, {"k1": 100}],
+          "k7": 7, "k6": 6, "k5": 5, "k4": 4,
+          "value": "text",
+          "k3": 3, "k2": 2, "k1": 1, "k0": 0,
+          "value": 42
+        }
+)JSON";
+
+    struct Test {
+        s32    k[12];
+        s32    value_int;
+        String value_str;
+    };
+
+    Pattern p = json::object({
+        {"k0",    p_s32(offsetof(Test, k[0]))},
+        {"k1",    p_s32(offsetof(Test, k[1]))},
+        {"k2",    p_s32(offsetof(Test, k[2]))},
+        {"k3",    p_s32(offsetof(Test, k[3]))},
+        {"k4",    p_s32(offsetof(Test, k[4]))},
+        {"k5",    p_s32(offsetof(Test, k[5]))},
+        {"value", p_s32(offsetof(Test, value_int))},
+        {"k6",    p_s32(offsetof(Test, k[6]))},
+        {"k7",    p_s32(offsetof(Test, k[7]))},
+        {"k8",    p_s32(offsetof(Test, k[8]))},
+        {"k9",    p_s32(offsetof(Test, k[9]))},
+        {"k10",   p_s32(offsetof(Test, k[10]))},
+        {"value", p_str(offsetof(Test, value_str))},
+        {"k11",   p_s32(offsetof(Test, k[11]))},
+    });
+
+    Test t {};
+    Pattern_Match_Result result = pattern_match(json_object, p, &t);
+    defer {
+        t.value_str.free();
+    };
+
+    assert_equal_int(result, Pattern_Match_Result::OK_CONTINUE);
+    for (s32 i = 0; i < 12; ++i) {
+        assert_equal_int(t.k[i], i);
+    }
+    assert_equal_int(t.value_int, 42);
+    assert_equal_string(t.value_str, string_from_literal("text"));
+
+    // NOTE(Felix): a hand built object without key ids or member index,
+    //   "hand_built" is not interned by any pattern
+    Object_Member members[] = {
+        {"k1",         p_s32(offsetof(Test, k[1]))},
+        {"hand_built", p_s32(offsetof(Test, value_int))},
+    };
+    Pattern hand_built {};
+    hand_built.type                = Json_Type::Object;
+    hand_built.object.members      = members;
+    hand_built.object.member_count = array_length(members);
+
+    Test h {};
+    result = pattern_match(R"({"k1": 5, "hand_built": 7})", hand_built, &h);
+    assert_equal_int(result, Pattern_Match_Result::OK_CONTINUE);
+    assert_equal_int(h.k[1], 5);
+    assert_equal_int(h.value_int, 7);
+
+    Compiled_Pattern plan = compile(hand_built);
+    defer { plan.deinit(); };
+    Test c {};
+    result = pattern_match(R"({"hand_built": 8, "k1": 6})", plan, &c);
+    assert_equal_int(result, Pattern_Match_Result::OK_CONTINUE);
+    assert_equal_int(c.k[1], 6);
+    assert_equal_int(c.value_int, 8);
+
+    return pass;
+}
+
+auto test_json_structural_index() -> testresult {
+    using namespace json;
+    // NOTE(Felix): long enough to span several 64 byte blocks, with escaped
+    //   quotes and backslashes in and around the block boundaries
+    const char* json_object = R"JSON({
+        "skipped": {"a": [1, 2, {"b": "}]\"{["}], "c": "\\", "d": "x\\\"y"},
+        "also skipped": ["\\\\", "[[[", {"}": "{"}, [[], [[]]], "\"\"\""],
+        "value": 42,
+        "tail": "------------------------------------------------------------\\"
+    })JSON";
+
+    Structural_Index index;
+    index.init(json_object, strlen(json_object));
+    defer { index.deinit(); };
+
+    assert_true(index.valid);
+
+    // NOTE(Felix): every structural the index found must be skipped to the
+    //   same place the char by char eaters end up
+    for (u32 i = 0; i < index.count; ++i) {
+        const char* at = json_object + index.positions[i];
+        if (*at == '{' || *at == '[' || (*at == '"' && index.matching[i] != i)) {
+            index.cursor = 0;
+            assert_equal_int(structural_skip_construct(&index, at), eat_thing(at));
+        }
+    }
+
+    struct Test {
+        s32 value;
+    };
+    Pattern p = json::object({
+        {"value", p_s32(offsetof(Test, value))},
+    });
+
+    Test t {};
+    assert_equal_int(pattern_match(json_object, p, &t), Pattern_Match_Result::OK_CONTINUE);
+    assert_equal_int(t.value, 42);
+
+    // NOTE(Felix): the index is gone after matching, nothing of it is left
+    //   in an arena that is matched into
+    Linear_Allocator arena;
+    arena.init(4096, grab_current_allocator());
+    defer { arena.deinit(); };
+
+    t = {};
+    assert_equal_int(pattern_match(json_object, p, &t, nullptr, (Allocator_Base*)&arena),
+                     Pattern_Match_Result::OK_CONTINUE);
+    assert_equal_int(t.value, 42);
+    assert_equal_int(arena.last_segment->count, 0);
+
+    // NOTE(Felix): comments are not supported by the index, so it must bail
+    Structural_Index commented;
+    const char* with_comment = "{ // {\n \"a\": 1 }";
+    commented.init(with_comment, strlen(with_comment));
+    defer { commented.deinit(); };
+    assert_true(!commented.valid);
+
+    return pass;
+}
+
+auto test_json_stream() -> testresult {
+    using namespace json;
+
+    struct Record {
+        s32    id;
+        String name;
+    };
+
+    struct Stream_Test {
+        s32  id_sum;
+        u32  records_seen;
+        bool names_ok;
+    };
+
+    Pattern p = json::object({
+        {"id",   p_s32(offsetof(Record, id))},
+        {"name", p_str(offsetof(Record, name))},
+    });
+
+    auto on_record = [](void* record, u64 record_index, void* callback_data) -> Pattern_Match_Result {
+        Record*      r = (Record*)record;
+        Stream_Test* t = (Stream_Test*)callback_data;
+
+        t->id_sum += r->id;
+        t->names_ok &= r->name.length >= 3 && r->name.data[0] == 'n';
+        ++t->records_seen;
+        r->name.free();
+
+        return Pattern_Match_Result::OK_CONTINUE;
+    };
+
+    // NOTE(Felix): hand out the input a few bytes at a time, so that records,
+    //   strings and comments are split across chunks
+    struct Trickle {
+        const char* input;
+        u64         pos;
+    };
+    auto trickle = [](void* reader_data, char* buffer, u64 buffer_size) -> u64 {
+        Trickle* t = (Trickle*)reader_data;
+        u64 n = MIN(MIN(buffer_size, (u64)7), strlen(t->input + t->pos));
+        memcpy(buffer, t->input + t->pos, n);
+        t->pos += n;
+        return n;
+    };
+
+    {
+        const char* ndjson =
+            "{\"id\": 1, \"name\": \"n}1\"}\n"
+            "{\"name\": \"n\\\"2\", \"ignored\": [{}, \"]\"], \"id\": 2}\n"
+            "// {\"id\": 100, \"name\": \"nop\"}\n"
+            "{\"id\": 3, \"name\": \"n{3\"}\n";
+
+        Trickle input { ndjson, 0 };
+        Stream_Test t { .names_ok = true };
+        Pattern_Match_Result result = pattern_match_stream(trickle, &input, p, sizeof(Record), on_record, &t);
+
+        assert_equal_int(result, Pattern_Match_Result::OK_CONTINUE);
+        assert_equal_int(t.records_seen, 3);
+        assert_equal_int(t.id_sum, 6);
+        assert_true(t.names_ok);
+    }
+    {
+        FILE* file = tmpfile();
+        defer { fclose(file); };
+        fprintf(file, "[\n");
+        for (u32 i = 0; i < 10000; ++i) {
+            fprintf(file, "  {\"id\": %u, \"name\": \"n%02u\"},\n", i, i % 100);
+        }
+        fprintf(file, "]\n");
+        rewind(file);
+
+        Stream_Test t { .names_ok = true };
+        Pattern_Match_Result result = pattern_match_stream(file, p, sizeof(Record), on_record, &t);
+
+        assert_equal_int(result, Pattern_Match_Result::OK_CONTINUE);
+        assert_equal_int(t.records_seen, 10000);
+        assert_equal_int(t.id_sum, 10000 * 9999 / 2);
+        assert_true(t.names_ok);
+    }
+    {
+        // NOTE(Felix): the hooks of the top level list run around the records
+        struct List_Events {
+            u32 entered;
+            u32 left;
+            u32 records_when_left;
+            Stream_Test* test;
+        };
+
+        Stream_Test  t { .names_ok = true };
+        List_Events  events { .test = &t };
+        Hooks hooks {
+            .callback_data = &events,
+            .enter_hook = [](void*, void* data, Hook_Context, Parser_Context p_ctx) -> Pattern_Match_Result {
+                List_Events* events = (List_Events*)data;
+                events->entered += p_ctx.position_in_string[0] == '[' && events->test->records_seen == 0;
+                return Pattern_Match_Result::OK_CONTINUE;
+            },
+            .leave_hook = [](void*, void* data, Hook_Context, Parser_Context p_ctx) -> Pattern_Match_Result {
+                List_Events* events = (List_Events*)data;
+                events->left += p_ctx.position_in_string[0] == ']';
+                events->records_when_left = events->test->records_seen;
+                return Pattern_Match_Result::OK_CONTINUE;
+            },
+        };
+
+        Trickle input { " [{\"id\": 1, \"name\": \"n1\"}, {\"id\": 2, \"name\": \"n2\"}] ", 0 };
+        Pattern_Match_Result result = pattern_match_stream(trickle, &input, p, sizeof(Record), on_record, &t,
+                                                           nullptr, hooks);
+        assert_equal_int(result, Pattern_Match_Result::OK_CONTINUE);
+        assert_equal_int(events.entered, 1);
+        assert_equal_int(events.left, 1);
+        assert_equal_int(events.records_when_left, 2);
+    }
+    {
+        // NOTE(Felix): a '/' that does not start a comment, and a failing read
+        Stream_Test t { .names_ok = true };
+        Trickle input { "{\"id\": 1, \"name\": \"n1\"}\n/ {\"id\": 2, \"name\": \"n2\"}", 0 };
+        Pattern_Match_Result result;
+        ignore_stdout {
+            result = pattern_match_stream(trickle, &input, p, sizeof(Record), on_record, &t);
+        }
+        assert_equal_int(result, Pattern_Match_Result::MATCHING_ERROR);
+        assert_equal_int(t.records_seen, 1);
+
+        auto failing = [](void*, char*, u64) -> u64 {
+            return STREAM_READ_ERROR;
+        };
+        ignore_stdout {
+            result = pattern_match_stream(failing, nullptr, p, sizeof(Record), on_record, &t);
+        }
+        assert_equal_int(result, Pattern_Match_Result::MATCHING_ERROR);
+
+        // NOTE(Felix): records have to be objects or lists, so a top level
+        //   list of scalars and newline delimited lists are rejected
+        const char* rejected[] = {
+            "[1, 2, 3]",
+            "[{\"id\": 1, \"name\": \"n1\"}]\n[{\"id\": 2, \"name\": \"n2\"}]\n",
+            "{\"id\": 1, \"name\": \"n1\"}\n4\n",
+        };
+        for (const char* r : rejected) {
+            Stream_Test rejected_t { .names_ok = true };
+            Trickle rejected_input { r, 0 };
+            ignore_stdout {
+                result = pattern_match_stream(trickle, &rejected_input, p, sizeof(Record), on_record, &rejected_t);
+            }
+            assert_equal_int(result, Pattern_Match_Result::MATCHING_ERROR);
+            assert_true(rejected_t.records_seen <= 1);
+        }
+
+        // NOTE(Felix): reading from a write only stream fails
+        FILE* file = fopen("json_stream_test.txt", "wb");
+        defer {
+            fclose(file);
+            delete_file("json_stream_test.txt");
+        };
+        ignore_stdout {
+            result = pattern_match_stream(file, p, sizeof(Record), on_record, &t);
+        }
+        assert_equal_int(result, Pattern_Match_Result::MATCHING_ERROR);
+    }
+
+    return pass;
+}
+
+auto test_json_string_views() -> testresult {
+    using namespace json;
+    const char* json_object = R"JSON({
+        "plain":   "no escapes here",
+        "escaped": "tab\tquote\"\u00e4\ud83d\ude00",
+        "number":  12.5
+    })JSON";
+
+    struct Test {
+        String plain;
+        String escaped;
+        String number;
+    };
+
+    Pattern p = json::object({
+        {"plain",   p_str_view(offsetof(Test, plain))},
+        {"escaped", p_str_view(offsetof(Test, escaped))},
+        {"number",  p_str_view(offsetof(Test, number))},
+    });
+
+    Scratch_Arena scratch = scratch_arena_start();
+    defer { scratch_arena_end(scratch); };
+
+    Test t {};
+    assert_equal_int(pattern_match(json_object, p, &t, nullptr, scratch.arena),
+                     Pattern_Match_Result::OK_CONTINUE);
+
+    // NOTE(Felix): strings without escapes point into the input
+    assert_true(t.plain.data  > json_object && t.plain.data  < json_object + strlen(json_object));
+    assert_true(t.number.data > json_object && t.number.data < json_object + strlen(json_object));
+    assert_equal_string(t.plain,  string_from_literal("no escapes here"));
+    assert_equal_string(t.number, string_from_literal("12.5"));
+
+    assert_true(t.escaped.data < json_object || t.escaped.data > json_object + strlen(json_object));
+    assert_equal_string(t.escaped, string_from_literal("tab\tquote\"\xc3\xa4\xf0\x9f\x98\x80"));
+
+    // NOTE(Felix): copied strings are unescaped just the same
+    Test copied {};
+    Pattern p_copy = json::object({
+        {"escaped", p_str(offsetof(Test, escaped))},
+    });
+    assert_equal_int(pattern_match(json_object, p_copy, &copied, nullptr, scratch.arena),
+                     Pattern_Match_Result::OK_CONTINUE);
+    assert_equal_string(copied.escaped, t.escaped);
+
+    // NOTE(Felix): and escaped again when they are written
+    Allocated_String written = write_pattern_to_string(p_copy, &copied, scratch.arena);
+    Test reread {};
+    assert_equal_int(pattern_match(written.string.data, p_copy, &reread, nullptr, scratch.arena),
+                     Pattern_Match_Result::OK_CONTINUE);
+    assert_equal_string(reread.escaped, t.escaped);
+
+    return pass;
+}
+
+auto test_json_binary() -> testresult {
+    using namespace json;
+
+    struct Point {
+        s32 id;
+        f32 position[3];
+        bool visible;
+    };
+
+    struct Scene {
+        s64    timestamp;
+        f32    scale;
+        String name;
+        String note; // only written if not empty
+        Array_List<Point> points;
+        Array_List<String> tags;
+    };
+
+    Pattern p = json::object({
+        {"timestamp", p_s64(offsetof(Scene, timestamp))},
+        {"scale",     p_f32(offsetof(Scene, scale))},
+        {"name",      p_str(offsetof(Scene, name))},
+        {"note",      p_str(offsetof(Scene, note), {
+                    .custom_writer_selection = [](void* note) -> bool {
+                        return ((String*)note)->length != 0;
+                    }
+                })},
+        {"points", list(object({
+                        {"id",       p_s32(offsetof(Point, id))},
+                        {"position", p_f32_arr<3>(offsetof(Point, position))},
+                        {"visible",  p_bool(offsetof(Point, visible))},
+                    }), {
+                    .array_list_offset = offsetof(Scene, points),
+                    .element_size      = sizeof(Point),
+                })},
+        {"tags", list(p_str_view(0), {
+                    .array_list_offset = offsetof(Scene, tags),
+                    .element_size      = sizeof(String),
+                })},
+    });
+
+    Scene scene {};
+    scene.timestamp = -1234567890123ll;
+    scene.scale     = 0.1f;
+    scene.name      = string_from_literal("binary scene");
+    scene.points.init();
+    scene.tags.init();
+    defer {
+        scene.points.deinit();
+        scene.tags.deinit();
+    };
+    for (s32 i = 0; i < 100; ++i) {
+        scene.points.append({ .id = i - 50, .position = {i * 0.5f, -1.0f * i, 1e-7f}, .visible = i % 3 == 0 });
+    }
+    scene.tags.append(string_from_literal("first"));
+    scene.tags.append(string_from_literal("second"));
+
+    Allocated_String binary = write_pattern_to_binary(p, &scene);
+    defer { binary.free(); };
+
+    Allocated_String text = write_pattern_to_string(p, &scene);
+    defer { text.free(); };
+    assert_true(binary.string.length < text.string.length / 2);
+
+    Scratch_Arena scratch = scratch_arena_start();
+    defer { scratch_arena_end(scratch); };
+
+    Scene read {};
+    u64 bytes_read;
+    assert_equal_int(pattern_match_binary(binary.string.data, binary.string.length, p, &read,
+                                          scratch.arena, &bytes_read),
+                     Pattern_Match_Result::OK_CONTINUE);
+    assert_equal_int(bytes_read, binary.string.length);
+
+    assert_equal_int(read.timestamp, scene.timestamp);
+    assert_equal_f32(read.scale, scene.scale);
+    assert_equal_string(read.name, scene.name);
+    assert_equal_int(read.note.length, 0);
+    assert_equal_int(read.points.count, 100);
+    for (u32 i = 0; i < 100; ++i) {
+        assert_equal_int(read.points[i].id,      scene.points[i].id);
+        assert_equal_int(read.points[i].visible, scene.points[i].visible);
+        assert_equal_int(memcmp(read.points[i].position, scene.points[i].position, sizeof(f32)*3), 0);
+    }
+    assert_equal_int(read.tags.count, 2);
+    assert_equal_string(read.tags[1], string_from_literal("second"));
+    // NOTE(Felix): views point into the binary data
+    assert_true(read.tags[1].data > binary.string.data &&
+                read.tags[1].data < binary.string.data + binary.string.length);
+
+    // NOTE(Felix): truncated input is an error, not a crash
+    Scene truncated {};
+    assert_equal_int(pattern_match_binary(binary.string.data, binary.string.length / 2, p, &truncated,
+                                          scratch.arena),
+                     Pattern_Match_Result::MATCHING_ERROR);
+
+    // NOTE(Felix): hash map objects have no binary encoding
+    Pattern hash_map = json::object(0);
+    ignore_stdout {
+        assert_equal_int(pattern_match_binary(binary.string.data, binary.string.length, hash_map, &truncated,
+                                              scratch.arena),
+                         Pattern_Match_Result::MATCHING_ERROR);
+    }
+
+    return pass;
+}
+
+auto test_json_compiled() -> testresult {
+    using namespace json;
+    const char* json_str = R"JSON({
+        "name":    "compiled",
+        "unknown": {"a": [1, 2, {"b": 3}], "name": "not me"},
+        "count":   17,
+        "ratio":   0.25,
+        // comments are fine too
+        "items": [
+            {"id": 1, "tags": ["a", "b"], "weight": 1.5},
+            {"weight": 2.5, "id": 2, "extra": null},
+            {"id": 3, "tags": []},
+        ],
+        "entries": [
+            {"value": 10},
+            {"value": 20},
+        ],
+    })JSON";
+
+    struct Item {
+        s32 id;
+        f32 weight;
+        Array_List<String> tags;
+    };
+
+    struct Entry {
+        s32 index;
+        s32 value;
+    };
+
+    struct Test {
+        String name;
+        s64    count;
+        f32    ratio;
+        Array_List<Item>  items;
+        Array_List<Entry> entries;
+    };
+
+    // NOTE(Felix): the entries use a parser hook, so they are interpreted
+    //   inside of the compiled plan, and still see their parser context
+    Hooks entry_hooks = {
+        .leave_hook = [](void* matched_obj, void* callback_data,
+                         Hook_Context h_context, Parser_Context p_context)
+        -> Pattern_Match_Result
+        {
+            ((Entry*)matched_obj)->index = p_context.context_stack.parent.list_entry.index;
+            return Pattern_Match_Result::OK_CONTINUE;
+        }
+    };
+
+    Pattern p = json::object({
+        {"name",  p_str(offsetof(Test, name))},
+        {"count", p_s64(offsetof(Test, count))},
+        {"ratio", p_f32(offsetof(Test, ratio))},
+        {"items", list(object({
+                        {"id",     p_s32(offsetof(Item, id))},
+                        {"weight", p_f32(offsetof(Item, weight))},
+                        {"tags",   list(p_str(0), {
+                                    .array_list_offset = offsetof(Item, tags),
+                                    .element_size      = sizeof(String),
+                                })},
+                    }), {
+                    .array_list_offset = offsetof(Test, items),
+                    .element_size      = sizeof(Item),
+                })},
+        {"entries", list(object({
+                        {"value", p_s32(offsetof(Entry, value))},
+                    }, {}, entry_hooks), {
+                    .array_list_offset = offsetof(Test, entries),
+                    .element_size      = sizeof(Entry),
+                })},
+    });
+
+    Scratch_Arena scratch = scratch_arena_start();
+    defer { scratch_arena_end(scratch); };
+
+    Compiled_Pattern plan = compile(p, scratch.arena);
+    defer { plan.deinit(); };
+
+    Test interpreted {};
+    Test compiled {};
+    assert_equal_int(pattern_match(json_str, p, &interpreted, nullptr, scratch.arena),
+                     Pattern_Match_Result::OK_CONTINUE);
+    assert_equal_int(pattern_match(json_str, plan, &compiled, nullptr, scratch.arena),
+                     Pattern_Match_Result::OK_CONTINUE);
+
+    assert_equal_string(compiled.name, string_from_literal("compiled"));
+    assert_equal_string(compiled.name, interpreted.name);
+    assert_equal_int(compiled.count, 17);
+    assert_equal_f32(compiled.ratio, 0.25f);
+
+    assert_equal_int(compiled.items.count, 3);
+    assert_equal_int(compiled.items.count, interpreted.items.count);
+    for (u32 i = 0; i < compiled.items.count; ++i) {
+        assert_equal_int(compiled.items[i].id, (s32)i+1);
+        assert_equal_int(compiled.items[i].id, interpreted.items[i].id);
+        assert_equal_f32(compiled.items[i].weight, interpreted.items[i].weight);
+        assert_equal_int(compiled.items[i].tags.count, interpreted.items[i].tags.count);
+    }
+    assert_equal_f32(compiled.items[1].weight, 2.5f);
+    assert_equal_int(compiled.items[0].tags.count, 2);
+    assert_equal_string(compiled.items[0].tags[1], string_from_literal("b"));
+
+    assert_equal_int(compiled.entries.count, 2);
+    assert_equal_int(compiled.entries[1].index, 1);
+    assert_equal_int(compiled.entries[1].value, 20);
+    assert_equal_int(compiled.entries[1].index, interpreted.entries[1].index);
+
+    return pass;
+}
+
+auto test_json_parallel() -> testresult {
+    using namespace json;
+
+    struct Record {
+        s32    id;
+        f32    value;
+        String name;
+        Array_List<s32> parts;
+    };
+
+    struct Records {
+        Array_List<Record> records;
+    };
+
+    Pattern p = list(object({
+                {"id",    p_s32(offsetof(Record, id))},
+                {"value", p_f32(offsetof(Record, value))},
+                {"name",  p_str(offsetof(Record, name))},
+                {"parts", list(p_s32(0), {
+                            .array_list_offset = offsetof(Record, parts),
+                            .element_size      = sizeof(s32),
+                        })},
+            }), {
+            .array_list_offset = offsetof(Records, records),
+            .element_size      = sizeof(Record),
+        });
+
+    Scratch_Arena scratch = scratch_arena_start();
+    defer { scratch_arena_end(scratch); };
+
+    Print_Sink sink;
+    sink.init_string(scratch.arena);
+    sink.put('[');
+    const u32 record_count = 5000;
+    for (u32 i = 0; i < record_count; ++i) {
+        // NOTE(Felix): brackets in strings must not confuse the splitting
+        char record[128];
+        u32 length = snprintf(record, sizeof(record),
+                              "  {\"name\": \"r[%u]{\", \"parts\": [%u, %u], \"id\": %u, \"value\": %u.5},\n",
+                              i, i, i+1, i, i);
+        sink.write(record, length);
+    }
+    sink.put(']');
+    String input = sink.finish(scratch.arena);
+
+    Locking_Allocator locking;
+    locking.init(scratch.arena);
+
+    Records sequential {};
+    Records parallel {};
+    assert_equal_int(pattern_match(input.data, p, &sequential, nullptr, scratch.arena),
+                     Pattern_Match_Result::OK_CONTINUE);
+    assert_equal_int(pattern_match_parallel(input.data, p, &parallel, 4, nullptr, (Allocator_Base*)&locking),
+                     Pattern_Match_Result::OK_CONTINUE);
+
+    assert_equal_int(parallel.records.count, record_count);
+    assert_equal_int(parallel.records.count, sequential.records.count);
+
+    // NOTE(Felix): the threads start their cursors at their first record,
+    //   where walking from the start would have ended up as well
+    {
+        Structural_Index index;
+        index.init(input.data, input.length, libc_allocator);
+        defer { index.deinit(); };
+        assert_true(index.valid);
+
+        u32 checked = 0;
+        for (const char* record = strstr(input.data, "{\"name\""); record;
+             record = strstr(record+1, "{\"name\""))
+        {
+            u32 offset = (u32)(record - input.data);
+            Structural_Index thread_index = structural_index_for_thread(&index, offset);
+            assert_equal_int(thread_index.positions[thread_index.cursor], offset);
+
+            // NOTE(Felix): the linear walk is slow, only compare some
+            if (checked % 97 == 0) {
+                index.cursor = 0;
+                assert_equal_int(thread_index.cursor, structural_seek(&index, offset));
+            }
+            ++checked;
+        }
+        assert_equal_int(checked, record_count);
+    }
+    for (u32 i = 0; i < record_count; ++i) {
+        Record& a = parallel.records[i];
+        Record& b = sequential.records[i];
+        assert_equal_int(a.id, (s32)i);
+        assert_equal_int(a.id, b.id);
+        assert_equal_f32(a.value, b.value);
+        assert_equal_string(a.name, b.name);
+        assert_equal_int(a.parts.count, 2);
+        assert_equal_int(a.parts[1], b.parts[1]);
+    }
+
+    // NOTE(Felix): element patterns with hooks are matched serially, so the
+    //   hooks see the records in order
+    struct Hook_Order {
+        s32  next;
+        bool in_order;
+    } order { 0, true };
+    Pattern hooked_element = object({
+            {"id", p_s32(offsetof(Record, id))},
+        }, {}, {
+            .callback_data = &order,
+            .enter_hook = [](void*, void* data, Hook_Context, Parser_Context p_ctx) -> Pattern_Match_Result {
+                Hook_Order* order = (Hook_Order*)data;
+                order->in_order &= p_ctx.context_stack.parent.list_entry.index == order->next++;
+                return Pattern_Match_Result::OK_CONTINUE;
+            },
+        });
+    Pattern hooked = list(hooked_element, {
+            .array_list_offset = offsetof(Records, records),
+            .element_size      = sizeof(Record),
+        });
+    Records with_hooks {};
+    assert_equal_int(pattern_match_parallel(input.data, hooked, &with_hooks, 4, nullptr, scratch.arena),
+                     Pattern_Match_Result::OK_CONTINUE);
+    assert_equal_int(order.next, (s32)record_count);
+    assert_true(order.in_order);
+
+    // NOTE(Felix): malformed input is an error, not a crash
+    Records malformed {};
+    Pattern_Match_Result result;
+    ignore_stdout {
+        result = pattern_match_parallel(R"([{"id": 1} {"id": 2}])", p, &malformed, 4, nullptr, scratch.arena);
+    }
+    assert_equal_int(result, Pattern_Match_Result::MATCHING_ERROR);
+
+    // NOTE(Felix): what is freed of records that are dropped
+    Record single {};
+    assert_equal_int(pattern_match(R"({"name": "n", "parts": [1, 2]})", *p.list.child_pattern, &single),
+                     Pattern_Match_Result::OK_CONTINUE);
+    free_matched_value(*p.list.child_pattern, &single, grab_current_allocator());
+    assert_true(single.name.data == nullptr);
+    assert_true(single.parts.data == nullptr);
+
+    return pass;
+}
+
+auto test_json_on_demand() -> testresult {
+    using namespace json;
+    const char* json_str = R"JSON({
+        "name":    "on demand",
+        "skipped": {"deep": [[1, 2], {"x": "}]"}], "more": null},
+        "scale":   0.5,
+        "count":   -42,
+        "big":     12345678901,
+        "visible": true,
+        "escaped": "a\"b",
+        // a comment
+        "points":  [ {"x": 1.5, "y": 2}, {"x": 3.5, "y": 4}, {"x": 5.5, "y": 6}, ],
+        "empty":   [],
+    })JSON";
+
+    Scratch_Arena scratch = scratch_arena_start();
+    defer { scratch_arena_end(scratch); };
+
+    for (bool with_index : {false, true}) {
+        Doc doc;
+        doc.init(json_str, with_index, scratch.arena);
+        defer { doc.deinit(); };
+
+        Value root = doc.root();
+        assert_equal_int(root.type(), Json_Type::Object);
+        assert_equal_int(root.count(), 9);
+
+        String name;
+        assert_true(root.find_field("name").get_string(&name));
+        assert_equal_string(name, string_from_literal("on demand"));
+        // NOTE(Felix): not copied
+        assert_true(name.data > json_str && name.data < json_str + strlen(json_str));
+
+        String escaped;
+        assert_true(root.find_field("escaped").get_string(&escaped, scratch.arena));
+        assert_equal_string(escaped, string_from_literal("a\"b"));
+
+        f32  scale;
+        s32  count;
+        s64  big;
+        bool visible;
+        assert_true(root.find_field("scale").get_f32(&scale));
+        assert_true(root.find_field("count").get_s32(&count));
+        assert_true(root.find_field("big").get_s64(&big));
+        assert_true(root.find_field("visible").get_bool(&visible));
+        assert_equal_f32(scale, 0.5f);
+        assert_equal_int(count, -42);
+        assert_equal_int(big, 12345678901ll);
+        assert_true(visible);
+
+        // NOTE(Felix): missing values and wrong types
+        f32 untouched = 7.0f;
+        assert_true(!root.find_field("missing").exists());
+        assert_true(!root.find_field("missing").find_field("deeper").get_f32(&untouched));
+        assert_true(!root.find_field("name").get_f32(&untouched));
+        assert_equal_f32(untouched, 7.0f);
+        assert_equal_int(root.find_field("skipped").find_field("more").type(), Json_Type::Null);
+
+        Value points = root.find_field("points");
+        assert_equal_int(points.count(), 3);
+        f32 x_sum = 0;
+        points.iterate_array([&](Value point) {
+            f32 x;
+            if (point.find_field("x").get_f32(&x))
+                x_sum += x;
+        });
+        assert_equal_f32(x_sum, 10.5f);
+
+        s32 y;
+        assert_true(points.at(2).find_field("y").get_s32(&y));
+        assert_equal_int(y, 6);
+        assert_true(!points.at(3).exists());
+        assert_equal_int(root.find_field("empty").count(), 0);
+
+        String raw = root.find_field("skipped").find_field("deep").at(1).get_raw();
+        assert_equal_string(raw, string_from_literal("{\"x\": \"}]\"}"));
+
+        u32    members = 0;
+        String first_key {};
+        root.iterate_object([&](String key, Value value) {
+            if (members++ == 0)
+                first_key = key;
+        });
+        assert_equal_int(members, 9);
+        assert_equal_string(first_key, string_from_literal("name"));
+    }
+
+    // NOTE(Felix): a member without a colon ends the object
+    Doc malformed;
+    malformed.init(R"({"a": 1, "b" 2, "c": 3})");
+    defer { malformed.deinit(); };
+    s32 a;
+    assert_true(malformed.root().find_field("a").get_s32(&a));
+    assert_equal_int(a, 1);
+    assert_true(!malformed.root().find_field("c").exists());
+    assert_equal_int(malformed.root().count(), 1);
+
+    return pass;
+}
+
 auto test_json_wildcard_match_and_parser_context() -> testresult {
     using namespace json;
     const char* json_str = R"JSON({
@@ -3234,6 +4768,402 @@ testresult test_join_paths() {
     return pass;
 }
 
+testresult test_map_entire_file() {
+    const char* path = "map_entire_file_test.json";
+    defer { delete_file(path); };
+
+    // NOTE(Felix): exactly one page, so there is no slack behind the file
+    //   contents that would be zero anyway
+    const u32 size = 4096;
+    u32 padding_start;
+    {
+        FILE* file = fopen(path, "wb");
+        assert_true(file != nullptr);
+        fprintf(file, "{\"id\": 17, \"padding\": \"");
+        padding_start = (u32)ftell(file);
+        for (u32 written = padding_start; written < size - 2; ++written)
+            fputc('x', file);
+        fprintf(file, "\"}");
+        fclose(file);
+    }
+
+    Mapped_File mapped = map_entire_file(path);
+    defer { unmap_file(&mapped); };
+    assert_true(mapped.success);
+    assert_equal_int(mapped.contents.length, size);
+    assert_equal_int(mapped.contents.data[size-1], '}');
+    assert_equal_int(mapped.contents.data[size], '\0');
+
+    struct Test {
+        s32    id;
+        String padding;
+    };
+    json::Pattern p = json::object({
+        {"id",      json::p_s32(offsetof(Test, id))},
+        {"padding", json::p_str_view(offsetof(Test, padding))},
+    });
+
+    Test t {};
+    assert_equal_int(json::pattern_match(mapped.contents, p, &t),
+                     json::Pattern_Match_Result::OK_CONTINUE);
+    assert_equal_int(t.id, 17);
+    assert_equal_int(t.padding.length, size - 2 - padding_start);
+    // NOTE(Felix): matched in place
+    assert_true(t.padding.data > mapped.contents.data &&
+                t.padding.data < mapped.contents.data + size);
+
+    Mapped_File missing = map_entire_file("this file does not exist");
+    assert_true(!missing.success);
+
+    return pass;
+}
+
+testresult test_io_queue() {
+    const u32 file_count = 64;
+    char paths[file_count][32];
+    for (u32 i = 0; i < file_count; ++i)
+        snprintf(paths[i], sizeof(paths[i]), "io_queue_test_%u.txt", i);
+    defer {
+        for (u32 i = 0; i < file_count; ++i)
+            delete_file(paths[i]);
+    };
+
+    struct Counts {
+        u32 written;
+        u32 read;
+        u32 correct;
+    };
+
+    for (bool force_thread_pool : {false, true}) {
+        IO_Queue queue;
+        queue.init(libc_allocator, force_thread_pool);
+        defer { queue.deinit(); };
+
+        Counts counts {};
+        IO_Request requests[file_count];
+        char       contents[file_count][64];
+
+        for (u32 i = 0; i < file_count; ++i) {
+            u32 length = snprintf(contents[i], sizeof(contents[i]), "file %u of the io queue test", i);
+            requests[i] = {
+                .op        = IO_Op::Write_File,
+                .path      = paths[i],
+                .data      = { contents[i], length },
+                .callback  = [](IO_Request* request) {
+                    ((Counts*)request->user_data)->written += request->success;
+                },
+                .user_data = &counts,
+            };
+            queue.submit(&requests[i]);
+        }
+        queue.wait_all();
+        assert_equal_int(counts.written, file_count);
+
+        for (u32 i = 0; i < file_count; ++i) {
+            requests[i] = {
+                .op        = IO_Op::Read_File,
+                .path      = paths[i],
+                .callback  = [](IO_Request* request) {
+                    Counts* counts = (Counts*)request->user_data;
+                    counts->read += request->success;
+                    counts->correct += request->contents.string.length > 0 &&
+                        memcmp(request->contents.string.data, "file ", 5) == 0 &&
+                        request->contents.string.data[request->contents.string.length] == '\0';
+                },
+                .user_data = &counts,
+            };
+            queue.submit(&requests[i]);
+        }
+
+        IO_Request missing {
+            .op   = IO_Op::Read_File,
+            .path = "this file does not exist",
+        };
+        queue.submit(&missing);
+
+        // NOTE(Felix): polling never blocks, so spin until everything is here
+        u32 completed = 0;
+        while (completed < file_count + 1)
+            completed += queue.poll();
+
+        assert_equal_int(counts.read, file_count);
+        assert_equal_int(counts.correct, file_count);
+        assert_true(!missing.success);
+        assert_equal_int(requests[7].contents.string.length, strlen(contents[7]));
+        assert_equal_int(memcmp(requests[7].contents.string.data, contents[7], strlen(contents[7])), 0);
+
+        for (u32 i = 0; i < file_count; ++i)
+            requests[i].contents.free();
+    }
+
+    return pass;
+}
+
+testresult test_walk_files_parallel() {
+    // NOTE(Felix): 8 directories with 2 subdirectories each, every directory
+    //   holding 10 files
+    const char* root = "walk_files_parallel_test";
+    char path[128];
+    auto for_each_dir = [&](auto fun) {
+        fun(root);
+        for (u32 i = 0; i < 8; ++i) {
+            snprintf(path, sizeof(path), "%s/d%u", root, i);
+            fun(path);
+            for (u32 j = 0; j < 2; ++j) {
+                snprintf(path, sizeof(path), "%s/d%u/s%u", root, i, j);
+                fun(path);
+            }
+        }
+    };
+
+    u32 dir_count = 0;
+    for_each_dir([&](const char* dir) {
+        create_directory_if_not_exists(dir);
+        for (u32 f = 0; f < 10; ++f) {
+            char file_path[160];
+            snprintf(file_path, sizeof(file_path), "%s/file_%u.txt", dir, f);
+            FILE* file = fopen(file_path, "wb");
+            if (file) {
+                fprintf(file, "%u", f);
+                fclose(file);
+            }
+        }
+        ++dir_count;
+    });
+    defer {
+        // NOTE(Felix): deepest directories first
+        char dirs[32][128];
+        u32 count = 0;
+        for_each_dir([&](const char* dir) { strcpy(dirs[count++], dir); });
+        while (count--) {
+            for (u32 f = 0; f < 10; ++f) {
+                char file_path[160];
+                snprintf(file_path, sizeof(file_path), "%s/file_%u.txt", dirs[count], f);
+                delete_file(file_path);
+            }
+            delete_file(dirs[count]);
+        }
+    };
+
+    struct Counts {
+        std::atomic<u32> files;
+        std::atomic<u32> dirs;
+        std::atomic<u64> bytes;
+        std::atomic<u32> bad_names;
+    };
+
+    auto count_entry = [](Path_Info pi, Walk_Status* status, void* user_data) -> void {
+        Counts* counts = (Counts*)user_data;
+        if (pi.file_info.is_directory) {
+            ++counts->dirs;
+        } else {
+            ++counts->files;
+            counts->bytes += pi.file_info.size;
+            if (pi.get_file_extension() != string_from_literal("txt"))
+                ++counts->bad_names;
+        }
+    };
+
+    const u32 expected_dirs  = dir_count - 1; // the root is not reported
+    const u32 expected_files = dir_count * 10;
+
+    for (u32 thread_count : {1u, 4u}) {
+        for (bool skip_stat : {false, true}) {
+            Counts counts {};
+            walk_files(root, {
+                    .recursive        = true,
+                    .with_files       = true,
+                    .with_directories = true,
+                    .skip_stat        = skip_stat,
+                    .thread_count     = thread_count,
+                }, count_entry, &counts);
+
+            assert_equal_int(counts.dirs,  expected_dirs);
+            assert_equal_int(counts.files, expected_files);
+            assert_equal_int(counts.bad_names, 0);
+            // NOTE(Felix): each file holds one digit
+            assert_equal_int(counts.bytes, skip_stat ? 0 : expected_files);
+        }
+    }
+
+    // NOTE(Felix): stopping early
+    Counts counts {};
+    walk_files(root, {
+            .recursive        = true,
+            .with_files       = true,
+            .thread_count     = 4,
+        }, [](Path_Info pi, Walk_Status* status, void* user_data) -> void {
+            ++((Counts*)user_data)->files;
+            *status = Walk_Status::Done;
+        }, &counts);
+    assert_true(counts.files >= 1 && counts.files <= 4);
+
+    // NOTE(Felix): linked directories are followed, even when they form a
+    //   cycle
+    const char* link_root = "walk_files_link_test";
+    create_directory_if_not_exists(link_root);
+    create_directory_if_not_exists("walk_files_link_test/real");
+    defer {
+        delete_file("walk_files_link_test/real/up");
+        delete_file("walk_files_link_test/link");
+        delete_file("walk_files_link_test/real/file.txt");
+        delete_file("walk_files_link_test/real");
+        delete_file(link_root);
+    };
+    FILE* file = fopen("walk_files_link_test/real/file.txt", "wb");
+    if (file)
+        fclose(file);
+    assert_true(symlink("real", "walk_files_link_test/link") == 0);
+    assert_true(symlink("..",   "walk_files_link_test/real/up") == 0);
+
+    for (u32 thread_count : {1u, 4u}) {
+        Counts link_counts {};
+        walk_files(link_root, {
+                .recursive        = true,
+                .with_files       = true,
+                .with_directories = true,
+                .thread_count     = thread_count,
+            }, count_entry, &link_counts);
+        // NOTE(Felix): real and link are the same directory, so only one of
+        //   them is walked: the entries are real, link, one file.txt and
+        //   one up, which leads back to the already walked root
+        assert_equal_int(link_counts.dirs,  3);
+        assert_equal_int(link_counts.files, 1);
+    }
+
+    return pass;
+}
+
+testresult test_file_watcher() {
+    const char* root = "file_watcher_test";
+    create_directory_if_not_exists(root);
+    create_directory_if_not_exists("file_watcher_test/sub");
+
+    auto write_file = [](const char* path, const char* contents) {
+        FILE* file = fopen(path, "wb");
+        if (file) {
+            fputs(contents, file);
+            fclose(file);
+        }
+    };
+    defer {
+        delete_file("file_watcher_test/a.txt");
+        delete_file("file_watcher_test/c.txt");
+        delete_file("file_watcher_test/sub/b.txt");
+        delete_file("file_watcher_test/new/d.txt");
+        delete_file("file_watcher_test/new");
+        delete_file("file_watcher_test/sub/e.txt");
+        delete_file("file_watcher_test/sub/f.txt");
+        delete_file("file_watcher_test/sub");
+        delete_file(root);
+    };
+
+    struct Seen {
+        u32 created;
+        u32 modified;
+        u32 deleted;
+        u32 batches;
+        char last_created[64];
+    };
+    auto record = [](File_Change_Event* events, u32 count, void* user_data) -> void {
+        Seen* seen = (Seen*)user_data;
+        ++seen->batches;
+        for (u32 i = 0; i < count; ++i) {
+            switch (events[i].change) {
+            case File_Change::Created: {
+                ++seen->created;
+                snprintf(seen->last_created, sizeof(seen->last_created), "%s", events[i].path.data);
+            } break;
+            case File_Change::Modified: ++seen->modified; break;
+            case File_Change::Deleted:  ++seen->deleted;  break;
+            }
+        }
+    };
+
+    // NOTE(Felix): the same changes have to come out of inotify and out of
+    //   the rescan fallback
+    for (bool use_inotify : {true, false}) {
+        write_file("file_watcher_test/a.txt", "a");
+        write_file("file_watcher_test/sub/b.txt", "b");
+
+        File_Watcher watcher;
+        watcher.init("file_watcher_test/");
+        defer { watcher.deinit(); };
+        if (!use_inotify && watcher.inotify_fd >= 0) {
+            close(watcher.inotify_fd);
+            watcher.inotify_fd = -1;
+        }
+
+        assert_equal_int(watcher.file_count(), 3);
+        assert_true(watcher.lookup("file_watcher_test/sub/b.txt") != nullptr);
+
+        Seen seen {};
+        assert_equal_int(watcher.poll(record, &seen), 0);
+        assert_equal_int(seen.batches, 0);
+
+        write_file("file_watcher_test/c.txt", "c");
+        assert_equal_int(watcher.poll(record, &seen), 1);
+        assert_equal_int(seen.created, 1);
+        assert_equal_int(strcmp(seen.last_created, "file_watcher_test/c.txt"), 0);
+
+        // NOTE(Felix): changes the size, so the fallback sees it as well
+        write_file("file_watcher_test/a.txt", "a longer a");
+        delete_file("file_watcher_test/sub/b.txt");
+        watcher.poll(record, &seen);
+        assert_equal_int(seen.modified, 1);
+        assert_equal_int(seen.deleted, 1);
+        assert_equal_int(seen.batches, 2);
+
+        // NOTE(Felix): a new directory with a file in it is picked up as well
+        create_directory_if_not_exists("file_watcher_test/new");
+        write_file("file_watcher_test/new/d.txt", "d");
+        watcher.poll(record, &seen);
+        assert_equal_int(seen.created, 3);
+        assert_equal_int(watcher.file_count(), 5);
+
+        write_file("file_watcher_test/new/d.txt", "dd");
+        watcher.poll(record, &seen);
+        assert_equal_int(seen.modified, 2);
+
+        delete_file("file_watcher_test/new/d.txt");
+        delete_file("file_watcher_test/new");
+        delete_file("file_watcher_test/c.txt");
+        write_file("file_watcher_test/sub/b.txt", "b");
+        watcher.poll(record, &seen);
+        assert_equal_int(seen.deleted, 4);
+        assert_equal_int(seen.created, 4);
+        assert_equal_int(watcher.file_count(), 3);
+
+        // NOTE(Felix): a directory deleted and created again between two
+        //   polls is still watched afterwards
+        delete_file("file_watcher_test/sub/b.txt");
+        delete_file("file_watcher_test/sub");
+        create_directory_if_not_exists("file_watcher_test/sub");
+        write_file("file_watcher_test/sub/e.txt", "e");
+        watcher.poll(record, &seen);
+        assert_equal_int(seen.deleted, 5);
+        assert_equal_int(seen.created, 5);
+        assert_equal_int(strcmp(seen.last_created, "file_watcher_test/sub/e.txt"), 0);
+
+        write_file("file_watcher_test/sub/f.txt", "f");
+        watcher.poll(record, &seen);
+        assert_equal_int(seen.created, 6);
+        assert_equal_int(strcmp(seen.last_created, "file_watcher_test/sub/f.txt"), 0);
+
+        // NOTE(Felix): back to how the next round starts
+        delete_file("file_watcher_test/sub/e.txt");
+        delete_file("file_watcher_test/sub/f.txt");
+        write_file("file_watcher_test/sub/b.txt", "b");
+        watcher.poll(record, &seen);
+        assert_equal_int(seen.deleted, 7);
+        assert_equal_int(seen.created, 7);
+        assert_equal_int(seen.modified, 2);
+        assert_equal_int(watcher.file_count(), 3);
+    }
+
+    return pass;
+}
+
 testresult test_walk_files() {
     Scratch_Arena scratch = scratch_arena_start();
     defer { scratch_arena_end(scratch); };
@@ -3375,6 +5305,10 @@ s32 main(s32, char**) {
             test_group("Path and Files") {
                 invoke_test(test_join_paths);
                 invoke_test(test_walk_files);
+                invoke_test(test_walk_files_parallel);
+                invoke_test(test_map_entire_file);
+                invoke_test(test_io_queue);
+                invoke_test(test_file_watcher);
                 invoke_test(test_path_components);
             }
 
@@ -3382,6 +5316,14 @@ s32 main(s32, char**) {
                 invoke_test(test_obj_to_json_str);
                 invoke_test(test_json_simple_object_json5);
                 invoke_test(test_json_simple_object_new_syntax);
+                invoke_test(test_json_wide_object_member_lookup);
+                invoke_test(test_json_structural_index);
+                invoke_test(test_json_stream);
+                invoke_test(test_json_string_views);
+                invoke_test(test_json_binary);
+                invoke_test(test_json_compiled);
+                invoke_test(test_json_parallel);
+                invoke_test(test_json_on_demand);
                 invoke_test(test_json_mvg);
                 invoke_test(test_json_bug);
                 invoke_test(test_json_extract_value_from_list);
@@ -3420,6 +5362,19 @@ s32 main(s32, char**) {
             invoke_test(test_math);
             invoke_test(test_math_matrix_compose);
             invoke_test(test_hashmap);
+            invoke_test(test_string_interner);
+            invoke_test(test_print_to_string);
+            invoke_test(test_print_to_file);
+            invoke_test(test_print_from_threads);
+            invoke_test(test_static_print);
+            invoke_test(test_async_log);
+            invoke_test(test_profiler_clock);
+            invoke_test(test_profiler_counters);
+            invoke_test(test_profiler_trace);
+            invoke_test(test_profiler_aggregate);
+            invoke_test(test_benchmark);
+            invoke_test(test_number_parsing);
+            invoke_test(test_number_formatting);
             invoke_test(test_sort);
             invoke_test(test_kd_tree);
             invoke_test(test_string_split);
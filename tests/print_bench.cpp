@@ -0,0 +1,83 @@
+// Times millions of println calls with typical formats, written to /dev/null,
+// next to plain printf as a reference. Build with optimizations, e.g.:
+//   g++ -O2 -fpermissive print_bench.cpp -o print_bench --std=c++17 -lpthread
+// and once more with -DFTB_PRINT_UNBUFFERED for the old unbuffered printer
+// that copies format strings char by char, to compare against.
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+
+#define FTB_CORE_IMPL
+#define FTB_PROFILER_IMPL
+
+#include "../core.hpp"
+#include "../profiler.hpp"
+
+template <typename Fun>
+auto run(const char* name, u32 iterations, Fun&& fun) -> void {
+    // NOTE(Felix): one warm up round, then take the best of a few rounds
+    fun(iterations / 10);
+    u64 best = (u64)-1;
+    for (u32 round = 0; round < 3; ++round) {
+        Time_Stamp start = start_timer();
+        fun(iterations);
+        best = MIN(best, stop_timer(start));
+    }
+    println("  %-24s %8.2f ms  %6.1f ns/call", name, best / 1.0e6, (f64)best / iterations);
+}
+
+int main() {
+    FILE* null_file = fopen("/dev/null", "w");
+    if (!null_file) {
+        log_error("could not open /dev/null");
+        return 1;
+    }
+    defer { fclose(null_file); };
+
+    FILE* console = ftb_stdout;
+    const u32 iterations = 2000000;
+
+#ifdef FTB_PRINT_UNBUFFERED
+    println("%u calls each, unbuffered printer", iterations);
+#else
+    println("%u calls each", iterations);
+#endif
+
+    auto to_null = [&](auto&& fun) {
+        return [&, fun](u32 count) {
+            ftb_stdout = null_file;
+            fun(count);
+            ftb_stdout = console;
+        };
+    };
+
+    run("printf literal", iterations, [&](u32 count) {
+        for (u32 i = 0; i < count; ++i)
+            fprintf(null_file, "the quick brown fox jumps over the lazy dog\n");
+    });
+    run("println literal", iterations, to_null([](u32 count) {
+        for (u32 i = 0; i < count; ++i)
+            println("the quick brown fox jumps over the lazy dog");
+    }));
+
+    run("printf mixed", iterations, [&](u32 count) {
+        for (u32 i = 0; i < count; ++i)
+            fprintf(null_file, "request %u of %d took %.3f ms (%s)\n", i, count, 1.25, "ok");
+    });
+    run("println mixed", iterations, to_null([](u32 count) {
+        for (u32 i = 0; i < count; ++i)
+            println("request %{u32} of %d took %.3f ms (%s)", i, count, 1.25, "ok");
+    }));
+    run("static_println mixed", iterations, to_null([](u32 count) {
+        for (u32 i = 0; i < count; ++i)
+            static_println("request %{u32} of %d took %.3f ms (%s)", i, count, 1.25, "ok");
+    }));
+
+    run("println prefix+color", iterations, to_null([](u32 count) {
+        with_print_prefix("  | ") {
+            for (u32 i = 0; i < count; ++i)
+                println("%{color<}item%{>color} %{u32}", console_green, i);
+        }
+    }));
+
+    return 0;
+}